@@ -34,6 +34,7 @@
 // Action definitions:
 #include "aboutaction.h"
 #include "aboutqtaction.h"
+#include "bounceaction.h"
 #include "clearrecentfilesaction.h"
 #include "clearundoaction.h"
 #include "closealldocumentsaction.h"
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    bounceaction.cpp
+///\ingroup bruo
+///\brief   Bounce action implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "bounceaction.h"
+#include "../mainframe.h"
+#include <sndfile.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceAction::BounceAction()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this action.
+///\param   [in] parent: Parent object for this action.
+///\remarks Initializes the action states, strings, events and icons.
+////////////////////////////////////////////////////////////////////////////////
+BounceAction::BounceAction(MainFrame* parent) :
+  ActiveDocumentAction(QIcon(":/images/speaker.png"), tr("&Bounce rack to new document"), parent)
+{
+  setStatusTip(tr("Render the selection through the effect rack into a new document"));
+  connect(this, SIGNAL(triggered()), this, SLOT(fired()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceAction::fired()
+////////////////////////////////////////////////////////////////////////////////
+///\brief The function where the action happens.
+////////////////////////////////////////////////////////////////////////////////
+void BounceAction::fired()
+{
+  // Get current document:
+  Document* doc = m_parent->manager()->activeDocument();
+  if (doc == 0 || doc->bouncing())
+    return;
+
+  // Render the selection or everything:
+  qint64 start  = doc->selectionStart();
+  qint64 length = doc->selectionLength();
+  if (length <= 0)
+  {
+    start  = 0;
+    length = doc->sampleCount();
+  }
+
+  // Render into a temporary float file, the new document reads from it:
+  QTemporaryFile file(QDir::temp().filePath("bruo_bounce_XXXXXX.w64"));
+  file.setAutoRemove(false);
+  if (!file.open())
+  {
+    QMessageBox::critical(m_parent, tr("Bounce error"), file.errorString());
+    return;
+  }
+  const QString fileName = file.fileName();
+  file.close();
+  if (!doc->bounce(fileName, SF_FORMAT_W64 | SF_FORMAT_FLOAT, start, length))
+  {
+    QFile::remove(fileName);
+    QMessageBox::critical(m_parent, tr("Bounce error"), doc->lastError());
+    return;
+  }
+  connect(doc, SIGNAL(bounceFinished(bool)), this, SLOT(bounceFinished(bool)), Qt::UniqueConnection);
+
+  // Show the progress (only if it takes a while):
+  QProgressDialog* progress = new QProgressDialog(tr("Bouncing %1...").arg(doc->composeTitle()), tr("Cancel"), 0, 100, m_parent);
+  progress->setMinimumDuration(500);
+  connect(doc, SIGNAL(bounceProgress(int)), progress, SLOT(setValue(int)));
+  connect(doc, SIGNAL(bounceFinished(bool)), progress, SLOT(deleteLater()));
+  connect(progress, SIGNAL(canceled()), doc, SLOT(cancelBounce()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceAction::bounceFinished()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Handler for the end of an offline render.
+///\param   [in] success: Was the file written?
+////////////////////////////////////////////////////////////////////////////////
+void BounceAction::bounceFinished(bool success)
+{
+  // Get document:
+  Document* doc = qobject_cast<Document*>(sender());
+  if (doc == 0)
+    return;
+
+  // Show the failure reason (the target was never written then, the user
+  // knows why a canceled render stopped):
+  const QString fileName = doc->bounceThread().fileName();
+  if (!success)
+  {
+    QFile::remove(fileName);
+    if (doc->bounceThread().canceled())
+      return;
+    QMessageBox::critical(m_parent, tr("Bounce error"), doc->lastError());
+    return;
+  }
+
+  // Open the result (the file is removed with the last piece):
+  double sampleRate = 0.0;
+  QSharedPointer<AudioSnippet> source = Document::openSpillFile(fileName, sampleRate);
+  if (source.isNull())
+  {
+    QMessageBox::critical(m_parent, tr("Bounce error"), tr("The rendered file can't be read."));
+    return;
+  }
+
+  // Create a new document with it:
+  Document* result = m_parent->manager()->newDocument();
+  result->create(source->channelCount(), sampleRate);
+  QList<SubSnippet*> snippets;
+  snippets.append(new SubSnippet(source, 0, source->sampleCount()));
+  if (!result->insertSnippets(0, snippets))
+    qDeleteAll(snippets);
+  result->setDirty();
+
+  // Create a view and activate it:
+  m_parent->showDocument(result);
+  result->emitPeaksChanged();
+
+  // Tell how fast it was:
+  m_parent->statusBar()->showMessage(tr("Bounced at %1x realtime").arg(doc->bounceThread().realtimeFactor(), 0, 'f', 1), 5000);
+}
+
+///////////////////////////////// End of File //////////////////////////////////
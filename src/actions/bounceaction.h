@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    bounceaction.h
+///\ingroup bruo
+///\brief   Bounce action definition.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __BOUNCEACTION_H_INCLUDED__
+#define __BOUNCEACTION_H_INCLUDED__
+
+#include "../bruo.h"
+#include "activedocumentaction.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class BounceAction bounceaction.h
+///\brief Bounce action definition.
+/// Renders the selection (or the whole document) through the effect rack
+/// into a new document, much faster than playing it.
+////////////////////////////////////////////////////////////////////////////////
+class BounceAction :
+  public ActiveDocumentAction
+{
+  Q_OBJECT // Qt magic...
+
+public:
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceAction::BounceAction()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this action.
+  ///\param   [in] parent: Parent object for this action.
+  ///\remarks Initializes the action states, strings, events and icons.
+  //////////////////////////////////////////////////////////////////////////////
+  BounceAction(class MainFrame* parent);
+
+private slots:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceAction::fired()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief The function where the action happens.
+  //////////////////////////////////////////////////////////////////////////////
+  void fired();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceAction::bounceFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Handler for the end of an offline render.
+  ///\param   [in] success: Was the file written?
+  //////////////////////////////////////////////////////////////////////////////
+  void bounceFinished(bool success);
+};
+
+#endif // __BOUNCEACTION_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
@@ -51,10 +51,12 @@ void CopyAction::fired()
 {
   // Get current document:
   Document* doc = m_parent->manager()->activeDocument();
-  if (doc == 0)
+  if (doc == 0 || doc->selectionLength() <= 0)
     return;
 
-  // Do the action...
+  // Put references to the selected range on the clipboard:
+  QList<SubSnippet*> snippets = doc->copySnippets(doc->selectionStart(), doc->selectionLength());
+  m_parent->manager()->clipboard().setContents(snippets, doc->channelCount(), doc->sampleRate());
 }
 
 ///////////////////////////////// End of File //////////////////////////////////
@@ -26,6 +26,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "cutaction.h"
 #include "../mainframe.h"
+#include "../commands/editcommand.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // CutAction::CutAction()
@@ -51,10 +52,16 @@ void CutAction::fired()
 {
   // Get current document:
   Document* doc = m_parent->manager()->activeDocument();
-  if (doc == 0)
+  if (doc == 0 || doc->selectionLength() <= 0)
     return;
 
-  // Do the action...
+  // Put references to the selected pieces to the clipboard:
+  QList<SubSnippet*> snippets = doc->copySnippets(doc->selectionStart(), doc->selectionLength());
+  m_parent->manager()->clipboard().setContents(snippets, doc->channelCount(), doc->sampleRate());
+
+  // Cut the selection out of the play list:
+  EditCommand* cmd = new EditCommand(doc, tr("cut"), doc->selectionStart(), doc->selectionLength(), QList<SubSnippet*>());
+  doc->undoStack()->push(cmd);
 }
 
 ///////////////////////////////// End of File //////////////////////////////////
@@ -26,6 +26,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "deleteaction.h"
 #include "../mainframe.h"
+#include "../commands/editcommand.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // DeleteAction::DeleteAction()
@@ -51,10 +52,12 @@ void DeleteAction::fired()
 {
   // Get current document:
   Document* doc = m_parent->manager()->activeDocument();
-  if (doc == 0)
+  if (doc == 0 || doc->selectionLength() <= 0)
     return;
 
-  // Do the action...
+  // Cut the selection out of the play list:
+  EditCommand* cmd = new EditCommand(doc, tr("delete"), doc->selectionStart(), doc->selectionLength(), QList<SubSnippet*>());
+  doc->undoStack()->push(cmd);
 }
 
 ///////////////////////////////// End of File //////////////////////////////////
@@ -65,7 +65,27 @@ void NewFromClipboardAction::clipboardChanged(QClipboard::Mode /* mode */)
 //////////////////////////////////////////////////////////////////////////////
 void NewFromClipboardAction::fired()
 {
-  // Create doc...
+  // Get the clipboard contents, audio of other applications is imported:
+  AudioClipboard& clipboard = m_parent->manager()->clipboard();
+  if (!clipboard.isCurrent() && !clipboard.importSystemClipboard())
+  {
+    QMessageBox::warning(m_parent, tr("New from clipboard"), tr("The clipboard contents can't be read."));
+    return;
+  }
+
+  // Create an empty document with the clipboard's format:
+  Document* doc = m_parent->manager()->newDocument();
+  doc->create(clipboard.channelCount(), clipboard.sampleRate());
+
+  // Fill it with references to the clipboard's sources:
+  QList<SubSnippet*> snippets = clipboard.copySnippets();
+  if (!doc->insertSnippets(0, snippets))
+    qDeleteAll(snippets);
+  doc->setDirty();
+
+  // Create a view and activate it:
+  m_parent->showDocument(doc);
+  doc->emitPeaksChanged();
 }
 
 ///////////////////////////////// End of File //////////////////////////////////
@@ -53,11 +53,14 @@ void OpenDocumentAction::fired()
   // Show open dialog:
   QFileDialog dialog;
   dialog.setNameFilters(getOpenFilters());
+  dialog.setFileMode(QFileDialog::ExistingFiles);
   dialog.setParent(m_parent);
   if (dialog.exec())
   {
-    // Load the file:
-    m_parent->loadFile(dialog.selectedFiles()[0]);
+    // Load the files (they are opened in the background):
+    const QStringList files = dialog.selectedFiles();
+    for (int i = 0; i < files.size(); i++)
+      m_parent->loadFile(files[i]);
   }
 }
 
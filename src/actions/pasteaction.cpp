@@ -26,6 +26,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "pasteaction.h"
 #include "../mainframe.h"
+#include "../commands/editcommand.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // PasteAction::PasteAction()
@@ -84,7 +85,33 @@ void PasteAction::fired()
   if (doc == 0)
     return;
 
-  // Do the paste...
+  // Get the clipboard contents, audio of other applications is imported:
+  AudioClipboard& clipboard = m_parent->manager()->clipboard();
+  if (!clipboard.isCurrent() && !clipboard.importSystemClipboard())
+  {
+    QMessageBox::warning(m_parent, tr("Paste"), tr("The clipboard contents can't be read."));
+    return;
+  }
+
+  // Sanity check:
+  if (clipboard.channelCount() != doc->channelCount())
+  {
+    QMessageBox::warning(m_parent, tr("Paste"), tr("The clipboard contents have a different number of channels."));
+    return;
+  }
+
+  // Replace the selection or insert at the cursor:
+  qint64 start  = doc->cursorPosition();
+  qint64 length = 0;
+  if (doc->selectionLength() > 0)
+  {
+    start  = doc->selectionStart();
+    length = doc->selectionLength();
+  }
+
+  // Insert references to the clipboard's sources:
+  EditCommand* cmd = new EditCommand(doc, tr("paste"), start, length, clipboard.copySnippets());
+  doc->undoStack()->push(cmd);
 }
 
 ///////////////////////////////// End of File //////////////////////////////////
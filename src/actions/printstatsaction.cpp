@@ -54,7 +54,27 @@ void PrintStatsAction::fired()
   if (doc == 0)
     return;
 
-  //TODO the action...
+  // Print document properties:
+  qInfo() << "Stats for" << doc->fileName();
+  qInfo() << " Channels:       " << doc->channelCount();
+  qInfo() << " Samplerate:     " << doc->sampleRate() << "Hz";
+  qInfo() << " Sample frames:  " << doc->sampleCount();
+  qInfo() << " Play list items:" << doc->snippetCount();
+
+  // Print playback streaming stats:
+  const PlaybackStream& stream = doc->playbackStream();
+  qInfo() << "Playback stream:";
+  qInfo() << " Underruns:      " << stream.underrunCount() << "(" << stream.underrunFrames() << "frames )";
+  qInfo() << " Seeks:          " << stream.seekCount();
+  qInfo() << " Buffered frames:" << stream.bufferedFrames();
+
+  // Print sample cache stats:
+  const BlockCache& cache = m_parent->manager()->blockCache();
+  qInfo() << "Sample cache:";
+  qInfo() << " Hits:           " << cache.hits();
+  qInfo() << " Misses:         " << cache.misses();
+  qInfo() << " Blocks:         " << cache.blockCount();
+  qInfo() << " Memory:         " << cache.memoryUsage() / 1024 << "of" << cache.budget() / 1024 << "KB";
 }
 
 ///////////////////////////////// End of File //////////////////////////////////
@@ -58,6 +58,7 @@ void SaveDocumentAction::documentCreated(Document* doc)
 {
   // Connect to the document's dirty slot:
   connect(doc, SIGNAL(dirtyChanged()), this, SLOT(dirtyChanged()));
+  connect(doc, SIGNAL(saveFinished(bool)), this, SLOT(saveFinished(bool)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,6 +76,32 @@ void SaveDocumentAction::dirtyChanged()
   setEnabled(doc != 0 && doc->dirty());
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// SaveDocumentAction::saveFinished()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Handler for the end of a background save.
+///\param   [in] success: Was the file written?
+////////////////////////////////////////////////////////////////////////////////
+void SaveDocumentAction::saveFinished(bool success)
+{
+  // Get document:
+  Document* doc = qobject_cast<Document*>(sender());
+  if (doc == 0)
+    return;
+
+  // Show the failure reason (the user knows why a canceled save stopped):
+  if (!success)
+  {
+    if (doc->saveThread().canceled())
+      return;
+    QMessageBox::critical(m_parent, tr("File save error"), doc->lastError());
+    return;
+  }
+
+  // Move file to the top of the recent file list:
+  m_parent->manager()->addRecentFile(doc->fileName());
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // SaveDocumentAction::fired()
 //////////////////////////////////////////////////////////////////////////////
@@ -84,10 +111,31 @@ void SaveDocumentAction::fired()
 {
   // Get document:
   Document* doc = m_parent->manager()->activeDocument();
-  if (doc == 0)
+  if (doc == 0 || doc->saving())
+    return;
+
+  // New documents need a name first:
+  QString fileName = doc->fileName();
+  if (fileName.isEmpty())
+  {
+    fileName = QFileDialog::getSaveFileName(m_parent, tr("Save document"), QString(), tr("Wave files (*.wav)"));
+    if (fileName.isEmpty())
+      return;
+  }
+
+  // Start saving in the background:
+  if (!doc->save(fileName))
+  {
+    QMessageBox::critical(m_parent, tr("File save error"), doc->lastError());
     return;
+  }
 
-  // Save the document...
+  // Show the progress (only if it takes a while):
+  QProgressDialog* progress = new QProgressDialog(tr("Saving %1...").arg(doc->composeTitle()), tr("Cancel"), 0, 100, m_parent);
+  progress->setMinimumDuration(500);
+  connect(doc, SIGNAL(saveProgress(int)), progress, SLOT(setValue(int)));
+  connect(doc, SIGNAL(saveFinished(bool)), progress, SLOT(deleteLater()));
+  connect(progress, SIGNAL(canceled()), doc, SLOT(cancelSave()));
 }
 
 ///////////////////////////////// End of File //////////////////////////////////
@@ -68,6 +68,14 @@ private slots:
   //////////////////////////////////////////////////////////////////////////////
   void dirtyChanged();
 
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveDocumentAction::saveFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Handler for the end of a background save.
+  ///\param   [in] success: Was the file written?
+  //////////////////////////////////////////////////////////////////////////////
+  void saveFinished(bool success);
+
   //////////////////////////////////////////////////////////////////////////////
   // SaveDocumentAction::fired()
   //////////////////////////////////////////////////////////////////////////////
@@ -26,6 +26,15 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "audiosnippet.h"
 
+////////////////////////////////////////////////////////////////////////////////
+// Next free snippet id:
+static QAtomicInt s_nextId(1);
+
+////////////////////////////////////////////////////////////////////////////////
+// The file backed snippets (guarded by s_fileMutex, like their file names):
+static QList<AudioSnippet*> s_fileSnippets;
+static QMutex s_fileMutex;
+
 ////////////////////////////////////////////////////////////////////////////////
 // AudioSnippet::AudioSnippet()
 ////////////////////////////////////////////////////////////////////////////////
@@ -35,7 +44,8 @@
 ////////////////////////////////////////////////////////////////////////////////
 AudioSnippet::AudioSnippet(int numChannels, qint64 numSamples) :
   m_sampleCount(numSamples),
-  m_channelCount(numChannels)
+  m_channelCount(numChannels),
+  m_id(s_nextId.fetchAndAddRelaxed(1))
 {
   // Nothing to do here.
 }
@@ -48,7 +58,13 @@ AudioSnippet::AudioSnippet(int numChannels, qint64 numSamples) :
 ////////////////////////////////////////////////////////////////////////////////
 AudioSnippet::~AudioSnippet()
 {
-  // Nothing to do here.
+  // Unregister (a kept file is removed with the last snippet that reads it,
+  // after the derived class closed its handles):
+  if (!m_fileName.isEmpty())
+  {
+    QMutexLocker lock(&s_fileMutex);
+    s_fileSnippets.removeOne(this);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -77,6 +93,19 @@ int AudioSnippet::channelCount() const
   return m_channelCount;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::id()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the unique id of this snippet.
+///\return  The id.
+///\remarks Ids are never reused, so caches can use them as keys.
+////////////////////////////////////////////////////////////////////////////////
+int AudioSnippet::id() const
+{
+  // Return our id:
+  return m_id;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // AudioSnippet::readSamples()
 ////////////////////////////////////////////////////////////////////////////////
@@ -84,13 +113,295 @@ int AudioSnippet::channelCount() const
 ///\param   [in]  offset: Position where to start reading.
 ///\param   [in]  count:  Number of sample frames to read.
 ///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 AudioSnippet::readSamples(const qint64 /* offset */, const qint64 /* count */, SampleBuffer& /* buffer */, Reader /* reader */)
+{
+  // Returns always zero:
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from this snippet, float version.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned. Use this
+///         version whenever single precision is enough (peaks, display).
+////////////////////////////////////////////////////////////////////////////////
+qint64 AudioSnippet::readSamples(const qint64 /* offset */, const qint64 /* count */, FloatSampleBuffer& /* buffer */, Reader /* reader */)
+{
+  // Returns always zero:
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::nativeFormat()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the format that this snippet can read without conversion.
+///\return  The native sample format.
+///\remarks Use the matching readRaw() version for the fastest reads.
+////////////////////////////////////////////////////////////////////////////////
+AudioSnippet::SampleFormat AudioSnippet::nativeFormat() const
+{
+  // Float by default:
+  return FloatSamples;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::memorySize()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the amount of RAM that holds the samples of this snippet.
+///\return  The size in bytes.
+///\remarks File based snippets return zero, their samples can be read
+///         again at any time.
+////////////////////////////////////////////////////////////////////////////////
+qint64 AudioSnippet::memorySize() const
+{
+  // Nothing in memory by default:
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::pageOut()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move the samples of this snippet from RAM to a swap file.
+///\param   [in] store: The swap file to use.
+///\return  true if the samples are not in RAM anymore.
+///\remarks Reads keep working while and after paging out.
+////////////////////////////////////////////////////////////////////////////////
+bool AudioSnippet::pageOut(const QSharedPointer<SwapStore>& /* store */)
+{
+  // Nothing in memory by default:
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::releaseReader()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Free the resources of a reader that is not needed for a while.
+///\param   [in] reader: The reader to release.
+///\remarks The reader opens its files again on its next read. Must not be
+///         called while the reader reads.
+////////////////////////////////////////////////////////////////////////////////
+void AudioSnippet::releaseReader(Reader /* reader */)
+{
+  // Nothing to release by default.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved 16 bit sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
 ///\return  The number of samples frames read.
 ///\remarks If there are no more samples to read zero is returned.
 ////////////////////////////////////////////////////////////////////////////////
-qint64 AudioSnippet::readSamples(const qint64 /* offset */, const qint64 /* count */, SampleBuffer& /* buffer */)
+qint64 AudioSnippet::readRaw(const qint64 /* offset */, const qint64 /* count */, qint16* /* frames */, Reader /* reader */)
 {
   // Returns always zero:
   return 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved 32 bit sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 AudioSnippet::readRaw(const qint64 /* offset */, const qint64 /* count */, qint32* /* frames */, Reader /* reader */)
+{
+  // Returns always zero:
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved float sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 AudioSnippet::readRaw(const qint64 /* offset */, const qint64 /* count */, float* /* frames */, Reader /* reader */)
+{
+  // Returns always zero:
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved double sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 AudioSnippet::readRaw(const qint64 /* offset */, const qint64 /* count */, double* /* frames */, Reader /* reader */)
+{
+  // Returns always zero:
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::keepFile()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move a file out of the way before it's replaced.
+///\param   [in]  fileName: Name of the file that is about to be replaced.
+///\param   [out] kept:     The moved file or null if nothing was moved.
+///\return  true if the file may be replaced now.
+///\remarks Snippets that still read the file (undo steps, the clipboard,
+///         other documents) would read the new content after a reopen. If
+///         there are such snippets the file is renamed in its directory and
+///         they are pointed at the new name. The moved file is removed with
+///         the last snippet (and the returned pointer). Fails if the file
+///         can't be renamed, e.g. while it's open on Windows.
+////////////////////////////////////////////////////////////////////////////////
+bool AudioSnippet::keepFile(const QString& fileName, QSharedPointer<QFile>& kept)
+{
+  kept.clear();
+
+  // Nothing to keep if the file doesn't exist yet:
+  QFileInfo info(fileName);
+  const QString path = info.canonicalFilePath();
+  if (path.isEmpty())
+    return true;
+
+  // Find the snippets that read the file:
+  QMutexLocker lock(&s_fileMutex);
+  QList<AudioSnippet*> readers;
+  for (int i = 0; i < s_fileSnippets.size(); i++)
+  {
+    if (s_fileSnippets[i]->m_fileName == path)
+      readers.append(s_fileSnippets[i]);
+  }
+  if (readers.isEmpty())
+    return true;
+
+  // Find a free name next to the file (renames don't cross file systems):
+  QTemporaryFile temp(info.absolutePath() + QLatin1String("/.") + info.fileName() + QLatin1String(".XXXXXX"));
+  if (!temp.open())
+    return false;
+  const QString keptName = temp.fileName();
+  temp.close();
+  temp.remove();
+
+  // Move the file:
+  if (!QFile::rename(path, keptName))
+    return false;
+  kept = QSharedPointer<QFile>(new QFile(keptName), removeKeptFile);
+
+  // Point the snippets at it:
+  for (int i = 0; i < readers.size(); i++)
+  {
+    readers[i]->m_fileName = keptName;
+    readers[i]->m_keptFile = kept;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::restoreFile()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move a kept file back if it wasn't replaced after all.
+///\param   [in] kept:     The moved file from keepFile().
+///\param   [in] fileName: The original name of the file.
+///\return  true if the file has its original name again.
+////////////////////////////////////////////////////////////////////////////////
+bool AudioSnippet::restoreFile(const QSharedPointer<QFile>& kept, const QString& fileName)
+{
+  // Sanity check:
+  if (kept.isNull())
+    return true;
+
+  // Move the file back:
+  QMutexLocker lock(&s_fileMutex);
+  const QString keptName = kept->fileName();
+  if (!QFile::rename(keptName, fileName))
+    return false;
+  kept->setFileName(QString());
+
+  // Point the snippets at the original name again (it's canonical, since the
+  // kept file is in the same directory):
+  const QString path = QFileInfo(fileName).canonicalFilePath();
+  for (int i = 0; i < s_fileSnippets.size(); i++)
+  {
+    AudioSnippet* snippet = s_fileSnippets[i];
+    if (snippet->m_keptFile == kept)
+    {
+      snippet->m_fileName = path;
+      snippet->m_keptFile.clear();
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::setFileName()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Set the name of the file this snippet reads from.
+///\param   [in] fileName: Name of the file.
+///\remarks Only file backed snippets call this (once, when constructed), so
+///         keepFile() can find them.
+////////////////////////////////////////////////////////////////////////////////
+void AudioSnippet::setFileName(const QString& fileName)
+{
+  // Names are compared canonical:
+  QString path = QFileInfo(fileName).canonicalFilePath();
+  if (path.isEmpty())
+    return;
+
+  // Register:
+  QMutexLocker lock(&s_fileMutex);
+  if (m_fileName.isEmpty())
+    s_fileSnippets.append(this);
+  m_fileName = path;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::fileName()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the name of the file this snippet reads from.
+///\return  The name (it changes if the file is kept by keepFile()).
+////////////////////////////////////////////////////////////////////////////////
+QString AudioSnippet::fileName() const
+{
+  QMutexLocker lock(&s_fileMutex);
+  return m_fileName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioSnippet::removeKeptFile()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Deleter of kept files.
+///\param   [in] file: The kept file to remove.
+////////////////////////////////////////////////////////////////////////////////
+void AudioSnippet::removeKeptFile(QFile* file)
+{
+  // Restored files have no name anymore:
+  if (!file->fileName().isEmpty())
+    file->remove();
+  delete file;
+}
+
 ///////////////////////////////// End of File //////////////////////////////////
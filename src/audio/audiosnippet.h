@@ -28,9 +28,14 @@
 #define __AUDIOSNIPPET_H_INCLUDED__
 
 #include <qglobal.h>
+#include <QAtomicInt>
 #include "bruo.h"
 #include "samplebuffer.h"
 
+////////////////////////////////////////////////////////////////////////////////
+// Foward declarations:
+class SwapStore;
+
 ////////////////////////////////////////////////////////////////////////////////
 ///\class AudioSnippet audiosnippet.h
 ///\brief Base class for all audio snippets in a document's play list.
@@ -38,6 +43,42 @@
 class AudioSnippet
 {
 public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // enum AudioSnippet::Reader
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   The consumers that read from a snippet.
+  ///\remarks Every reader except the shared one has its own read state (file
+  ///         handle, temp buffers etc), so the consumers never wait for each
+  ///         other. Each of these readers must only be used by one thread.
+  //////////////////////////////////////////////////////////////////////////////
+  typedef enum Reader
+  {
+    SharedReader     = 0,  ///> Everyone else, serialized by a mutex.
+    PeakReader       = 1,  ///> The peak building thread (first peak worker).
+    DisplayReader    = 2,  ///> Raw sample reads of the views (GUI thread).
+    PlaybackReader   = 3,  ///> The audio callback.
+    SaveReader       = 4,  ///> The background save.
+    BounceReader     = 5,  ///> The offline rack render.
+    PeakWorkerReader = 6,  ///> The other peak workers (one reader per worker).
+    ReaderCount      = 21  ///> Number of readers.
+  } Reader;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // enum AudioSnippet::SampleFormat
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   The native sample formats for raw reads.
+  ///\remarks Integer samples are left aligned, so 8 bit data comes as 16 bit
+  ///         and 24 bit data as 32 bit (the same as libsndfile does).
+  //////////////////////////////////////////////////////////////////////////////
+  typedef enum SampleFormat
+  {
+    Int16Samples  = 0, ///> 16 bit integer (and less).
+    Int32Samples  = 1, ///> 32 bit integer (and 24 bit).
+    FloatSamples  = 2, ///> Single precision float.
+    DoubleSamples = 3  ///> Double precision float.
+  } SampleFormat;
+
   //////////////////////////////////////////////////////////////////////////////
   // AudioSnippet::AudioSnippet()
   //////////////////////////////////////////////////////////////////////////////
@@ -73,6 +114,15 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   virtual int channelCount() const;
 
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::id()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the unique id of this snippet.
+  ///\return  The id.
+  ///\remarks Ids are never reused, so caches can use them as keys.
+  //////////////////////////////////////////////////////////////////////////////
+  int id() const;
+
   //////////////////////////////////////////////////////////////////////////////
   // AudioSnippet::readSamples()
   //////////////////////////////////////////////////////////////////////////////
@@ -80,17 +130,180 @@ public:
   ///\param   [in]  offset: Position where to start reading.
   ///\param   [in]  count:  Number of sample frames to read.
   ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads.
   ///\return  The number of samples frames read.
   ///\remarks If there are no more samples to read zero is returned.
   //////////////////////////////////////////////////////////////////////////////
-  virtual qint64 readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer);
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from this snippet, float version.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned. Use this
+  ///         version whenever single precision is enough (peaks, display).
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::nativeFormat()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the format that this snippet can read without conversion.
+  ///\return  The native sample format.
+  ///\remarks Use the matching readRaw() version for the fastest reads.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual SampleFormat nativeFormat() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::memorySize()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the amount of RAM that holds the samples of this snippet.
+  ///\return  The size in bytes.
+  ///\remarks File based snippets return zero, their samples can be read
+  ///         again at any time.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 memorySize() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::pageOut()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move the samples of this snippet from RAM to a swap file.
+  ///\param   [in] store: The swap file to use.
+  ///\return  true if the samples are not in RAM anymore.
+  ///\remarks Reads keep working while and after paging out.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual bool pageOut(const QSharedPointer<SwapStore>& store);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::releaseReader()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Free the resources of a reader that is not needed for a while.
+  ///\param   [in] reader: The reader to release.
+  ///\remarks The reader opens its files again on its next read. Must not be
+  ///         called while the reader reads.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual void releaseReader(Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved 16 bit sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, qint16* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved 32 bit sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, qint32* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved float sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, float* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved double sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, double* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::keepFile()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move a file out of the way before it's replaced.
+  ///\param   [in]  fileName: Name of the file that is about to be replaced.
+  ///\param   [out] kept:     The moved file or null if nothing was moved.
+  ///\return  true if the file may be replaced now.
+  ///\remarks Snippets that still read the file (undo steps, the clipboard,
+  ///         other documents) would read the new content after a reopen. If
+  ///         there are such snippets the file is renamed in its directory and
+  ///         they are pointed at the new name. The moved file is removed with
+  ///         the last snippet (and the returned pointer). Fails if the file
+  ///         can't be renamed, e.g. while it's open on Windows.
+  //////////////////////////////////////////////////////////////////////////////
+  static bool keepFile(const QString& fileName, QSharedPointer<QFile>& kept);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::restoreFile()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move a kept file back if it wasn't replaced after all.
+  ///\param   [in] kept:     The moved file from keepFile().
+  ///\param   [in] fileName: The original name of the file.
+  ///\return  true if the file has its original name again.
+  //////////////////////////////////////////////////////////////////////////////
+  static bool restoreFile(const QSharedPointer<QFile>& kept, const QString& fileName);
+
+protected:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::setFileName()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Set the name of the file this snippet reads from.
+  ///\param   [in] fileName: Name of the file.
+  ///\remarks Only file backed snippets call this (once, when constructed), so
+  ///         keepFile() can find them.
+  //////////////////////////////////////////////////////////////////////////////
+  void setFileName(const QString& fileName);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::fileName()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the name of the file this snippet reads from.
+  ///\return  The name (it changes if the file is kept by keepFile()).
+  //////////////////////////////////////////////////////////////////////////////
+  QString fileName() const;
 
 private:
 
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioSnippet::removeKeptFile()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Deleter of kept files.
+  ///\param   [in] file: The kept file to remove.
+  //////////////////////////////////////////////////////////////////////////////
+  static void removeKeptFile(QFile* file);
+
   //////////////////////////////////////////////////////////////////////////////
   // Member:
-  qint64 m_sampleCount; ///> Number of samples.
-  int m_channelCount;   ///> Number of channels.
+  qint64                m_sampleCount;  ///> Number of samples.
+  int                   m_channelCount; ///> Number of channels.
+  int                   m_id;           ///> Unique id of this snippet.
+  QString               m_fileName;     ///> The file read from (if any).
+  QSharedPointer<QFile> m_keptFile;     ///> Kept file to remove when done.
 };
 
 #endif // #ifndef __AUDIOSNIPPET_H_INCLUDED__
@@ -39,11 +39,7 @@ void Generator::fillOutputBuffer()
   if (doc == 0)
     return;
 
-  // Init input data:
-  m_inputBuffer.makeSilence();
-  m_outputBuffer.makeSilence();
-
-  // Get samples:
+  // Get samples (the input buffer stays silent, the rack clears the output):
   doc->rack().process(m_inputBuffer, m_outputBuffer, m_blockSize, 0.0);
 
   // Copy output data:
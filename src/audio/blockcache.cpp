@@ -0,0 +1,361 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    blockcache.cpp
+///\ingroup bruo
+///\brief   Decoded sample block cache class implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "blockcache.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::BlockCache()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] budget: Maximum memory used by the cache in bytes.
+////////////////////////////////////////////////////////////////////////////////
+BlockCache::BlockCache(qint64 budget) :
+  m_first(0),
+  m_last(0),
+  m_budget(budget),
+  m_usage(0),
+  m_hits(0),
+  m_misses(0)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::~BlockCache()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Does final cleanup.
+////////////////////////////////////////////////////////////////////////////////
+BlockCache::~BlockCache()
+{
+  clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from a snippet through the cache.
+///\param   [in]  snippet: The snippet to read from.
+///\param   [in]  offset:  Position where to start reading.
+///\param   [in]  count:   Number of sample frames to read.
+///\param   [out] buffer:  The target buffer for the samples.
+///\param   [in]  reader:  The consumer that reads (used on cache misses).
+///\param   [in]  target:  First frame of the buffer to write to.
+///\return  The number of samples frames read.
+///\remarks Missing blocks are decoded without holding the cache lock. With
+///         a target offset several reads can fill one buffer.
+////////////////////////////////////////////////////////////////////////////////
+qint64 BlockCache::readSamples(AudioSnippet* snippet, qint64 offset, qint64 count, FloatSampleBuffer& buffer, AudioSnippet::Reader reader, qint64 target)
+{
+  // Sanity check:
+  if (snippet == 0 || offset < 0 || offset >= snippet->sampleCount() || count <= 0)
+    return 0;
+
+  // Clip to the end of the snippet:
+  count = qMin(count, snippet->sampleCount() - offset);
+  const int numChannels = qMin(buffer.channelCount(), snippet->channelCount());
+
+  // Copy block by block:
+  qint64 done = 0;
+  while (done < count)
+  {
+    // Find the block:
+    const qint64 pos     = offset + done;
+    const qint64 index   = pos / BlockSize;
+    const qint64 inBlock = pos % BlockSize;
+    const quint64 key    = blockKey(snippet->id(), index);
+    m_mutex.lock();
+    Block* block = m_blocks.value(key, 0);
+    if (block != 0)
+    {
+      // Hit, make it the most recent one:
+      m_hits++;
+      unlink(block);
+      pushFront(block);
+    }
+    else
+    {
+      // Miss, decode the block without the lock:
+      m_misses++;
+      m_mutex.unlock();
+      const qint64 start = index * BlockSize;
+      Block* newBlock = new Block;
+      newBlock->key    = key;
+      newBlock->samples.createBuffers(snippet->channelCount(), static_cast<int>(qMin(qint64(BlockSize), snippet->sampleCount() - start)));
+      newBlock->frames = snippet->readSamples(start, newBlock->samples.sampleCount(), newBlock->samples, reader);
+      newBlock->prev   = 0;
+      newBlock->next   = 0;
+
+      // Don't cache failed reads:
+      if (newBlock->frames <= inBlock)
+      {
+        delete newBlock;
+        break;
+      }
+      m_mutex.lock();
+
+      // Somebody else might have been faster:
+      block = m_blocks.value(key, 0);
+      if (block != 0)
+        delete newBlock;
+      else
+      {
+        block = newBlock;
+        m_blocks.insert(key, block);
+        m_usage += blockBytes(block);
+      }
+      unlink(block);
+      pushFront(block);
+    }
+
+    // Copy the samples:
+    const qint64 numFrames = qMin(count - done, block->frames - inBlock);
+    for (int i = 0; numFrames > 0 && i < numChannels; i++)
+      memcpy(buffer.sampleBuffer(i) + target + done, block->samples.sampleBuffer(i) + inBlock, numFrames * sizeof(float));
+
+    // Keep the budget:
+    evict();
+    m_mutex.unlock();
+
+    // Failed read?
+    if (numFrames <= 0)
+      break;
+    done += numFrames;
+  }
+
+  // Return number of frames read:
+  return done;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::purge()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Drop all blocks of a snippet.
+///\param   [in] snippet: The snippet that goes away.
+////////////////////////////////////////////////////////////////////////////////
+void BlockCache::purge(const AudioSnippet* snippet)
+{
+  // Sanity check:
+  if (snippet == 0)
+    return;
+
+  // Remove all blocks of this snippet:
+  QMutexLocker locker(&m_mutex);
+  const qint64 numBlocks = (snippet->sampleCount() + BlockSize - 1) / BlockSize;
+  for (qint64 i = 0; i < numBlocks; i++)
+  {
+    Block* block = m_blocks.value(blockKey(snippet->id(), i), 0);
+    if (block != 0)
+      remove(block);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::clear()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Drop all blocks.
+////////////////////////////////////////////////////////////////////////////////
+void BlockCache::clear()
+{
+  QMutexLocker locker(&m_mutex);
+  while (m_last != 0)
+    remove(m_last);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::budget()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the memory budget of this cache.
+///\return  The maximum memory used by the cache in bytes.
+////////////////////////////////////////////////////////////////////////////////
+qint64 BlockCache::budget() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_budget;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::setBudget()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Set the memory budget of this cache.
+///\param   [in] budget: Maximum memory used by the cache in bytes.
+///\remarks Blocks are dropped right away if the cache is too big now.
+////////////////////////////////////////////////////////////////////////////////
+void BlockCache::setBudget(qint64 budget)
+{
+  QMutexLocker locker(&m_mutex);
+  m_budget = budget;
+  evict();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::memoryUsage()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the memory currently used by the cached blocks.
+///\return  The used memory in bytes.
+////////////////////////////////////////////////////////////////////////////////
+qint64 BlockCache::memoryUsage() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_usage;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::blockCount()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the number of cached blocks.
+///\return  The block count.
+////////////////////////////////////////////////////////////////////////////////
+int BlockCache::blockCount() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_blocks.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::hits()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Number of block accesses that were served from the cache.
+///\return  The hit count.
+////////////////////////////////////////////////////////////////////////////////
+qint64 BlockCache::hits() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_hits;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::misses()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Number of block accesses that had to decode the block.
+///\return  The miss count.
+////////////////////////////////////////////////////////////////////////////////
+qint64 BlockCache::misses() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_misses;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::resetStatistics()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Reset the hit and miss counters.
+////////////////////////////////////////////////////////////////////////////////
+void BlockCache::resetStatistics()
+{
+  QMutexLocker locker(&m_mutex);
+  m_hits   = 0;
+  m_misses = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::blockKey()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Build the hash key of a block.
+///\param   [in] snippetId: Id of the snippet.
+///\param   [in] index:     Index of the block in the snippet.
+///\return  The key.
+////////////////////////////////////////////////////////////////////////////////
+quint64 BlockCache::blockKey(int snippetId, qint64 index)
+{
+  return (static_cast<quint64>(static_cast<unsigned int>(snippetId)) << 32) | static_cast<quint64>(index & 0xFFFFFFFF);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::blockBytes()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Memory used by a block.
+///\param   [in] block: The block.
+///\return  The size in bytes.
+////////////////////////////////////////////////////////////////////////////////
+qint64 BlockCache::blockBytes(const Block* block)
+{
+  return qint64(block->samples.channelCount()) * block->samples.sampleCount() * sizeof(float) + sizeof(Block);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::unlink()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Remove a block from the LRU list.
+///\param   [in] block: The block.
+////////////////////////////////////////////////////////////////////////////////
+void BlockCache::unlink(Block* block)
+{
+  if (block->prev != 0)
+    block->prev->next = block->next;
+  else if (m_first == block)
+    m_first = block->next;
+  if (block->next != 0)
+    block->next->prev = block->prev;
+  else if (m_last == block)
+    m_last = block->prev;
+  block->prev = 0;
+  block->next = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::pushFront()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Insert a block at the front (most recently used) of the list.
+///\param   [in] block: The block.
+////////////////////////////////////////////////////////////////////////////////
+void BlockCache::pushFront(Block* block)
+{
+  block->prev = 0;
+  block->next = m_first;
+  if (m_first != 0)
+    m_first->prev = block;
+  m_first = block;
+  if (m_last == 0)
+    m_last = block;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::remove()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Remove a block from the cache and delete it.
+///\param   [in] block: The block.
+////////////////////////////////////////////////////////////////////////////////
+void BlockCache::remove(Block* block)
+{
+  unlink(block);
+  m_blocks.remove(block->key);
+  m_usage -= blockBytes(block);
+  delete block;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BlockCache::evict()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Drop least recently used blocks until the budget fits.
+////////////////////////////////////////////////////////////////////////////////
+void BlockCache::evict()
+{
+  while (m_usage > m_budget && m_last != 0)
+    remove(m_last);
+}
+
+///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    blockcache.h
+///\ingroup bruo
+///\brief   Decoded sample block cache class definition.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __BLOCKCACHE_H_INCLUDED__
+#define __BLOCKCACHE_H_INCLUDED__
+
+#include "bruo.h"
+#include "audiosnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   BlockCache blockcache.h
+///\brief   LRU cache for decoded sample blocks of audio snippets.
+///\remarks Snippets are split into fixed size blocks. A block is decoded on
+///         the first access and stays in the cache until the memory budget
+///         is used up, then the least recently used blocks are dropped. One
+///         cache is shared by all documents (see DocumentManager).
+////////////////////////////////////////////////////////////////////////////////
+class BlockCache
+{
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Size of a cache block in sample frames.
+  static const int BlockSize = 65536;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::BlockCache()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] budget: Maximum memory used by the cache in bytes.
+  //////////////////////////////////////////////////////////////////////////////
+  BlockCache(qint64 budget = 64 * 1024 * 1024);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::~BlockCache()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Does final cleanup.
+  //////////////////////////////////////////////////////////////////////////////
+  ~BlockCache();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from a snippet through the cache.
+  ///\param   [in]  snippet: The snippet to read from.
+  ///\param   [in]  offset:  Position where to start reading.
+  ///\param   [in]  count:   Number of sample frames to read.
+  ///\param   [out] buffer:  The target buffer for the samples.
+  ///\param   [in]  reader:  The consumer that reads (used on cache misses).
+  ///\param   [in]  target:  First frame of the buffer to write to.
+  ///\return  The number of samples frames read.
+  ///\remarks Missing blocks are decoded without holding the cache lock. With
+  ///         a target offset several reads can fill one buffer.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 readSamples(AudioSnippet* snippet, qint64 offset, qint64 count, FloatSampleBuffer& buffer, AudioSnippet::Reader reader, qint64 target = 0);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::purge()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Drop all blocks of a snippet.
+  ///\param   [in] snippet: The snippet that goes away.
+  //////////////////////////////////////////////////////////////////////////////
+  void purge(const AudioSnippet* snippet);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::clear()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Drop all blocks.
+  //////////////////////////////////////////////////////////////////////////////
+  void clear();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::budget()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the memory budget of this cache.
+  ///\return  The maximum memory used by the cache in bytes.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 budget() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::setBudget()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Set the memory budget of this cache.
+  ///\param   [in] budget: Maximum memory used by the cache in bytes.
+  ///\remarks Blocks are dropped right away if the cache is too big now.
+  //////////////////////////////////////////////////////////////////////////////
+  void setBudget(qint64 budget);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::memoryUsage()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the memory currently used by the cached blocks.
+  ///\return  The used memory in bytes.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 memoryUsage() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::blockCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the number of cached blocks.
+  ///\return  The block count.
+  //////////////////////////////////////////////////////////////////////////////
+  int blockCount() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::hits()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Number of block accesses that were served from the cache.
+  ///\return  The hit count.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 hits() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::misses()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Number of block accesses that had to decode the block.
+  ///\return  The miss count.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 misses() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::resetStatistics()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Reset the hit and miss counters.
+  //////////////////////////////////////////////////////////////////////////////
+  void resetStatistics();
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // struct BlockCache::Block
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief One decoded block, linked into the LRU list.
+  //////////////////////////////////////////////////////////////////////////////
+  struct Block
+  {
+    quint64           key;     ///> Snippet id and block index.
+    FloatSampleBuffer samples; ///> The decoded samples.
+    qint64            frames;  ///> Valid frames (last block may be short).
+    Block*            prev;    ///> More recently used block.
+    Block*            next;    ///> Less recently used block.
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::blockKey()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Build the hash key of a block.
+  ///\param   [in] snippetId: Id of the snippet.
+  ///\param   [in] index:     Index of the block in the snippet.
+  ///\return  The key.
+  //////////////////////////////////////////////////////////////////////////////
+  static quint64 blockKey(int snippetId, qint64 index);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::blockBytes()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Memory used by a block.
+  ///\param   [in] block: The block.
+  ///\return  The size in bytes.
+  //////////////////////////////////////////////////////////////////////////////
+  static qint64 blockBytes(const Block* block);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::unlink()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Remove a block from the LRU list.
+  ///\param   [in] block: The block.
+  //////////////////////////////////////////////////////////////////////////////
+  void unlink(Block* block);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::pushFront()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Insert a block at the front (most recently used) of the list.
+  ///\param   [in] block: The block.
+  //////////////////////////////////////////////////////////////////////////////
+  void pushFront(Block* block);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::remove()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Remove a block from the cache and delete it.
+  ///\param   [in] block: The block.
+  //////////////////////////////////////////////////////////////////////////////
+  void remove(Block* block);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BlockCache::evict()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Drop least recently used blocks until the budget fits.
+  //////////////////////////////////////////////////////////////////////////////
+  void evict();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  QHash<quint64, Block*> m_blocks;  ///> The cached blocks.
+  Block*                 m_first;   ///> Most recently used block.
+  Block*                 m_last;    ///> Least recently used block.
+  qint64                 m_budget;  ///> Maximum memory usage.
+  qint64                 m_usage;   ///> Current memory usage.
+  qint64                 m_hits;    ///> Number of cache hits.
+  qint64                 m_misses;  ///> Number of cache misses.
+  mutable QMutex         m_mutex;   ///> Protects everything above.
+};
+
+#endif // #ifndef __BLOCKCACHE_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
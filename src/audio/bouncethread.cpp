@@ -0,0 +1,397 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    bouncethread.cpp
+///\ingroup bruo
+///\brief   Offline rack render thread implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "bouncethread.h"
+#include "sndfileio.h"
+#include "../rack/rack.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Frames per render block (much larger than a realtime block, so the devices
+// run long inner loops and the file is written in big chunks):
+static const int s_blockFrames = 65536;
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::BounceThread()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] parent: Parent for this instance.
+////////////////////////////////////////////////////////////////////////////////
+BounceThread::BounceThread(QObject* parent) :
+  QThread(parent),
+  m_rack(0),
+  m_format(0),
+  m_numChannels(0),
+  m_sampleRate(0.0),
+  m_sampleCount(0),
+  m_canceled(0),
+  m_succeeded(false),
+  m_wasCanceled(false),
+  m_realtimeFactor(0.0)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::~BounceThread()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Cancels a running render.
+////////////////////////////////////////////////////////////////////////////////
+BounceThread::~BounceThread()
+{
+  // Stop rendering:
+  cancel();
+  wait();
+
+  // Release pieces:
+  qDeleteAll(m_snippets);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::startBounce()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Start rendering pieces through a rack.
+///\param   [in] rack:        The rack to render through.
+///\param   [in] snippets:    The input pieces, the thread takes them over.
+///\param   [in] fileName:    The target file.
+///\param   [in] format:      Id of the file format.
+///\param   [in] numChannels: Number of channels of the pieces.
+///\param   [in] sampleRate:  Samples per second of the pieces.
+///\return  true if the render was started or false if one is still running.
+///\remarks The finished() signal is emitted when done.
+////////////////////////////////////////////////////////////////////////////////
+bool BounceThread::startBounce(Rack* rack, const QList<SubSnippet*>& snippets, const QString& fileName, int format, int numChannels, double sampleRate)
+{
+  // Only one render at a time:
+  if (isRunning())
+    return false;
+
+  // Take the new job:
+  qDeleteAll(m_snippets);
+  m_rack        = rack;
+  m_snippets    = snippets;
+  m_fileName    = fileName;
+  m_format      = format;
+  m_numChannels = numChannels;
+  m_sampleRate  = sampleRate;
+  m_sampleCount = 0;
+  for (int i = 0; i < m_snippets.size(); i++)
+    m_sampleCount += m_snippets[i]->sampleCount();
+
+  // Reset state:
+  m_canceled.store(0);
+  m_succeeded      = false;
+  m_wasCanceled    = false;
+  m_lastError      = "";
+  m_realtimeFactor = 0.0;
+
+  // Go:
+  start();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::cancel()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Abort the current render.
+////////////////////////////////////////////////////////////////////////////////
+void BounceThread::cancel()
+{
+  // Flag abort, the render checks it after every block:
+  m_canceled.store(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::succeeded()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Check the result of the last render.
+///\return  true if the file was written completely.
+////////////////////////////////////////////////////////////////////////////////
+bool BounceThread::succeeded() const
+{
+  // Return result:
+  return m_succeeded;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::canceled()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Check if the last render was stopped by cancel().
+///\return  true if canceled, false if it succeeded or failed.
+////////////////////////////////////////////////////////////////////////////////
+bool BounceThread::canceled() const
+{
+  // Return result:
+  return m_wasCanceled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::fileName()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the target of the last render.
+///\return  The file name.
+////////////////////////////////////////////////////////////////////////////////
+const QString& BounceThread::fileName() const
+{
+  // Return target:
+  return m_fileName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::lastError()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the reason why the last render failed.
+///\return  The error as string.
+////////////////////////////////////////////////////////////////////////////////
+const QString& BounceThread::lastError() const
+{
+  // Return reason:
+  return m_lastError;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::realtimeFactor()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the speed of the last render.
+///\return  Seconds of audio rendered per second of wall time.
+////////////////////////////////////////////////////////////////////////////////
+double BounceThread::realtimeFactor() const
+{
+  // Return speed:
+  return m_realtimeFactor;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::run()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   The actual thread function.
+////////////////////////////////////////////////////////////////////////////////
+void BounceThread::run()
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  // Check format:
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  info.channels   = m_numChannels;
+  info.samplerate = qRound(m_sampleRate);
+  info.format     = m_format;
+  if (!sf_format_check(&info))
+  {
+    m_lastError = tr("This file format can't be written.");
+    return;
+  }
+
+  // Open the target, it's written to a temporary file first:
+  QSaveFile file(m_fileName);
+  if (!file.open(QIODevice::WriteOnly))
+  {
+    m_lastError = file.errorString();
+    return;
+  }
+  SNDFILE* handle = openSndFile(&file, SFM_WRITE, &info);
+  if (handle == 0)
+  {
+    m_lastError = QString(sf_strerror(0));
+    file.cancelWriting();
+    return;
+  }
+
+  // Float samples beyond full scale clip in integer files instead of wrapping:
+  sf_command(handle, SFC_SET_CLIPPING, 0, SF_TRUE);
+
+  // Take the rack away from the audio callback and set it up for big blocks:
+  m_rack->beginOffline();
+  const int oldBlockSize = m_rack->blockSize();
+  const double oldSampleRate = m_rack->sampleRate();
+  m_rack->setBlockSize(s_blockFrames);
+  m_rack->setSampleRate(m_sampleRate);
+
+  // Render:
+  bool ok = render(handle);
+
+  // Hand the rack back:
+  m_rack->setSampleRate(oldSampleRate);
+  m_rack->setBlockSize(oldBlockSize);
+  m_rack->endOffline();
+
+  // Finish the header:
+  sf_close(handle);
+
+  // Leave the target alone on errors:
+  if (!ok)
+  {
+    if (m_lastError.isEmpty())
+    {
+      m_lastError = tr("The bounce was canceled.");
+      m_wasCanceled = true;
+    }
+    file.cancelWriting();
+    return;
+  }
+
+  // Snippets that still read the target keep the old file:
+  QSharedPointer<QFile> kept;
+  if (!AudioSnippet::keepFile(m_fileName, kept))
+  {
+    m_lastError = tr("The file is still in use and can't be replaced.");
+    file.cancelWriting();
+    return;
+  }
+
+  // Replace the target:
+  if (!file.commit())
+  {
+    m_lastError = file.errorString();
+    AudioSnippet::restoreFile(kept, m_fileName);
+    return;
+  }
+  m_succeeded = true;
+
+  // Log speed:
+  const qint64 ms = qMax(timer.elapsed(), qint64(1));
+  const double seconds = m_sampleCount / qMax(m_sampleRate, 1.0);
+  m_realtimeFactor = seconds * 1000.0 / ms;
+  qInfo() << "Bounced" << seconds << "s of audio in" << ms << "ms (" << m_realtimeFactor << "x realtime)";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::render()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Render all pieces into an open file.
+///\param   [in] handle: The libsndfile handle of the file.
+///\return  true if successful or false otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool BounceThread::render(void* handle)
+{
+  // The rack always renders at least stereo, only the channels of the
+  // document are written:
+  SampleBuffer inputs(m_numChannels, s_blockFrames);
+  SampleBuffer outputs(qMax(m_numChannels, 2), s_blockFrames);
+  QVector<double> frames(s_blockFrames * m_numChannels);
+
+  // Loop through the pieces:
+  int piece = 0;
+  qint64 position = 0;
+  qint64 rendered = 0;
+  int lastPercent = -1;
+  while (rendered < m_sampleCount)
+  {
+    if (m_canceled.load())
+      return false;
+
+    // Read the next block (the tail of the last one is padded with silence):
+    qint64 count = qMin(qint64(s_blockFrames), m_sampleCount - rendered);
+    inputs.makeSilence();
+    if (readBlock(piece, position, count, inputs) != count)
+    {
+      m_lastError = tr("The samples could not be read.");
+      return false;
+    }
+
+    // Run it through the rack:
+    const double streamTime = rendered / m_sampleRate;
+    m_rack->processOffline(inputs, outputs, static_cast<int>(count), streamTime);
+
+    // Interleave and write:
+    double* dest = frames.data();
+    for (qint64 i = 0; i < count; i++)
+    {
+      for (int j = 0; j < m_numChannels; j++)
+        *dest++ = outputs.sampleBuffer(j)[i];
+    }
+    if (sf_writef_double(static_cast<SNDFILE*>(handle), frames.constData(), count) != count)
+    {
+      m_lastError = QString(sf_strerror(static_cast<SNDFILE*>(handle)));
+      return false;
+    }
+
+    // Report progress:
+    rendered += count;
+    int percent = static_cast<int>(rendered * 100 / qMax(m_sampleCount, qint64(1)));
+    if (percent != lastPercent)
+    {
+      lastPercent = percent;
+      emit progress(percent);
+    }
+  }
+
+  // Done:
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BounceThread::readBlock()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read the next block of the pieces.
+///\param   [in,out] piece:    Index of the current piece.
+///\param   [in,out] position: Read position in the current piece.
+///\param   [in]     count:    Number of frames to read.
+///\param   [out]    buffer:   The target buffer.
+///\return  The number of frames read, less at the end of the pieces.
+///\remarks A block can span several pieces, so these are read into a
+///         temporary buffer and copied.
+////////////////////////////////////////////////////////////////////////////////
+qint64 BounceThread::readBlock(int& piece, qint64& position, qint64 count, SampleBuffer& buffer)
+{
+  qint64 done = 0;
+  while (done < count && piece < m_snippets.size())
+  {
+    // Next piece?
+    SubSnippet* current = m_snippets[piece];
+    if (position >= current->sampleCount())
+    {
+      piece++;
+      position = 0;
+      continue;
+    }
+
+    // Read straight into the buffer if the block starts with this part:
+    qint64 wanted = qMin(count - done, current->sampleCount() - position);
+    qint64 read = 0;
+    if (done == 0)
+      read = current->readSamples(position, wanted, buffer, AudioSnippet::BounceReader);
+    else
+    {
+      SampleBuffer part(m_numChannels, static_cast<int>(wanted));
+      read = current->readSamples(position, wanted, part, AudioSnippet::BounceReader);
+      for (int j = 0; j < m_numChannels; j++)
+        memcpy(buffer.sampleBuffer(j) + done, part.sampleBuffer(j), read * sizeof(double));
+    }
+    if (read <= 0)
+      break;
+
+    // Advance:
+    position += read;
+    done     += read;
+  }
+
+  // Return number of frames read:
+  return done;
+}
+
+///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    bouncethread.h
+///\ingroup bruo
+///\brief   Offline rack render thread.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __BOUNCETHREAD_H_INCLUDED__
+#define __BOUNCETHREAD_H_INCLUDED__
+
+#include <QThread>
+#include "subsnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Foward declarations:
+class Rack;
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   BounceThread bouncethread.h
+///\brief   Helper thread class to render pieces through a rack into a file.
+///\remarks This drives the same devices as the audio callback, but with large
+///         blocks and as fast as the CPU allows. The realtime output of the
+///         rack is silent while the render runs.
+////////////////////////////////////////////////////////////////////////////////
+class BounceThread : public QThread
+{
+  Q_OBJECT // Qt magic...
+
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::BounceThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] parent: Parent for this instance.
+  //////////////////////////////////////////////////////////////////////////////
+  BounceThread(QObject* parent = 0);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::~BounceThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Cancels a running render.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~BounceThread();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::startBounce()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Start rendering pieces through a rack.
+  ///\param   [in] rack:        The rack to render through.
+  ///\param   [in] snippets:    The input pieces, the thread takes them over.
+  ///\param   [in] fileName:    The target file.
+  ///\param   [in] format:      Id of the file format.
+  ///\param   [in] numChannels: Number of channels of the pieces.
+  ///\param   [in] sampleRate:  Samples per second of the pieces.
+  ///\return  true if the render was started or false if one is still running.
+  ///\remarks The finished() signal is emitted when done.
+  //////////////////////////////////////////////////////////////////////////////
+  bool startBounce(Rack* rack, const QList<SubSnippet*>& snippets, const QString& fileName, int format, int numChannels, double sampleRate);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::cancel()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Abort the current render.
+  //////////////////////////////////////////////////////////////////////////////
+  void cancel();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::succeeded()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check the result of the last render.
+  ///\return  true if the file was written completely.
+  //////////////////////////////////////////////////////////////////////////////
+  bool succeeded() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::canceled()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check if the last render was stopped by cancel().
+  ///\return  true if canceled, false if it succeeded or failed.
+  //////////////////////////////////////////////////////////////////////////////
+  bool canceled() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::fileName()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the target of the last render.
+  ///\return  The file name.
+  //////////////////////////////////////////////////////////////////////////////
+  const QString& fileName() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::lastError()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the reason why the last render failed.
+  ///\return  The error as string.
+  //////////////////////////////////////////////////////////////////////////////
+  const QString& lastError() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::realtimeFactor()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the speed of the last render.
+  ///\return  Seconds of audio rendered per second of wall time.
+  //////////////////////////////////////////////////////////////////////////////
+  double realtimeFactor() const;
+
+signals:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::progress()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   This signal is emitted whenever another percent was rendered.
+  ///\param   [in] percent: The progress (0..100).
+  //////////////////////////////////////////////////////////////////////////////
+  void progress(int percent);
+
+protected:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::run()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   The actual thread function.
+  //////////////////////////////////////////////////////////////////////////////
+  void run();
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::render()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Render all pieces into an open file.
+  ///\param   [in] handle: The libsndfile handle of the file.
+  ///\return  true if successful or false otherwise.
+  //////////////////////////////////////////////////////////////////////////////
+  bool render(void* handle);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // BounceThread::readBlock()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read the next block of the pieces.
+  ///\param   [in,out] piece:    Index of the current piece.
+  ///\param   [in,out] position: Read position in the current piece.
+  ///\param   [in]     count:    Number of frames to read.
+  ///\param   [out]    buffer:   The target buffer.
+  ///\return  The number of frames read, less at the end of the pieces.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 readBlock(int& piece, qint64& position, qint64 count, SampleBuffer& buffer);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  Rack*              m_rack;           ///> The rack to render through.
+  QList<SubSnippet*> m_snippets;       ///> The input pieces.
+  QString            m_fileName;       ///> The target file.
+  int                m_format;         ///> Id of the file format.
+  int                m_numChannels;    ///> Channel count of the pieces.
+  double             m_sampleRate;     ///> Sample rate of the pieces.
+  qint64             m_sampleCount;    ///> Total length of the pieces.
+  QAtomicInt         m_canceled;       ///> Stop as soon as possible?
+  bool               m_succeeded;      ///> Was the last render successful?
+  bool               m_wasCanceled;    ///> Was the last render canceled?
+  QString            m_lastError;      ///> Why did the last render fail?
+  double             m_realtimeFactor; ///> Speed of the last render.
+};
+
+#endif // #ifndef __BOUNCETHREAD_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
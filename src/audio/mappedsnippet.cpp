@@ -0,0 +1,822 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    mappedsnippet.cpp
+///\ingroup bruo
+///\brief   Memory mapped playlist item class implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "mappedsnippet.h"
+#include "samplekernels.h"
+#include <QtEndian>
+#include <sndfile.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// loadInt()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read an unaligned integer with the given byte order.
+///\param   [in] p: Where to read.
+///\return  The integer in native byte order.
+////////////////////////////////////////////////////////////////////////////////
+template <typename I, bool BigEndian>
+static inline I loadInt(const uchar* p)
+{
+  return BigEndian ? qFromBigEndian<I>(p) : qFromLittleEndian<I>(p);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// floatToRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Convert a normalized float sample to a left aligned 32 bit int.
+///\param   [in] v: The sample.
+///\return  The clipped integer sample.
+////////////////////////////////////////////////////////////////////////////////
+static inline qint32 floatToRaw(double v)
+{
+  v *= 2147483648.0;
+  if (v >= 2147483647.0)
+    return 2147483647;
+  if (v <= -2147483648.0)
+    return -2147483647 - 1;
+  return static_cast<qint32>(v);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sample decoders. Each one knows its size and converts a single sample to the
+// normalized -1..1 range the same way libsndfile does (value()) or to a left
+// aligned 32 bit integer (raw()).
+////////////////////////////////////////////////////////////////////////////////
+struct Int8Decoder
+{
+  enum { Size = 1 };
+  template <typename T> static inline T value(const uchar* p) { return T(static_cast<qint8>(p[0])) * T(1.0 / 128.0); }
+  static inline qint32 raw(const uchar* p) { return static_cast<qint32>(static_cast<quint32>(p[0]) << 24); }
+};
+
+struct UInt8Decoder
+{
+  enum { Size = 1 };
+  template <typename T> static inline T value(const uchar* p) { return T(int(p[0]) - 128) * T(1.0 / 128.0); }
+  static inline qint32 raw(const uchar* p) { return static_cast<qint32>(static_cast<quint32>(p[0] ^ 0x80) << 24); }
+};
+
+template <bool BigEndian>
+struct Int16Decoder
+{
+  enum { Size = 2 };
+  template <typename T> static inline T value(const uchar* p) { return T(static_cast<qint16>(loadInt<quint16, BigEndian>(p))) * T(1.0 / 32768.0); }
+  static inline qint32 raw(const uchar* p) { return static_cast<qint32>(static_cast<quint32>(loadInt<quint16, BigEndian>(p)) << 16); }
+};
+
+template <bool BigEndian>
+struct Int24Decoder
+{
+  enum { Size = 3 };
+  template <typename T> static inline T value(const uchar* p) { return T(raw(p)) * T(1.0 / 2147483648.0); }
+  static inline qint32 raw(const uchar* p)
+  {
+    // Put the 24 bits into the upper part of an int:
+    quint32 v = BigEndian ?
+      (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) :
+      (quint32(p[2]) << 24) | (quint32(p[1]) << 16) | (quint32(p[0]) << 8);
+    return static_cast<qint32>(v);
+  }
+};
+
+template <bool BigEndian>
+struct Int32Decoder
+{
+  enum { Size = 4 };
+  template <typename T> static inline T value(const uchar* p) { return T(static_cast<qint32>(loadInt<quint32, BigEndian>(p))) * T(1.0 / 2147483648.0); }
+  static inline qint32 raw(const uchar* p) { return static_cast<qint32>(loadInt<quint32, BigEndian>(p)); }
+};
+
+template <bool BigEndian>
+struct Float32Decoder
+{
+  enum { Size = 4 };
+  template <typename T> static inline T value(const uchar* p)
+  {
+    quint32 bits = loadInt<quint32, BigEndian>(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return T(v);
+  }
+  static inline qint32 raw(const uchar* p) { return floatToRaw(value<double>(p)); }
+};
+
+template <bool BigEndian>
+struct Float64Decoder
+{
+  enum { Size = 8 };
+  template <typename T> static inline T value(const uchar* p)
+  {
+    quint64 bits = loadInt<quint64, BigEndian>(p);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return T(v);
+  }
+  static inline qint32 raw(const uchar* p) { return floatToRaw(value<double>(p)); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// convertFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Convert interleaved raw frames into separate channel buffers.
+///\param   [in]  src:         The raw interleaved frames.
+///\param   [out] dst:         One target pointer per channel.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  frameBytes:  Size of a frame in bytes.
+///\param   [in]  numFrames:   Number of frames to convert.
+///\remarks Works in blocks so the source stays in the cache while all the
+///         channels are picked out of it.
+////////////////////////////////////////////////////////////////////////////////
+template <typename D, typename T>
+static void convertFrames(const uchar* src, T* const* dst, int numChannels, int frameBytes, qint64 numFrames)
+{
+  const qint64 blockSize = 4096;
+  for (qint64 pos = 0; pos < numFrames; pos += blockSize)
+  {
+    qint64 frames = qMin(blockSize, numFrames - pos);
+    const uchar* block = src + pos * frameBytes;
+    for (int c = 0; c < numChannels; c++)
+    {
+      const uchar* s = block + c * D::Size;
+      T* d = dst[c] + pos;
+      for (qint64 i = 0; i < frames; i++, s += frameBytes)
+        d[i] = D::template value<T>(s);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// convertSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Convert raw frames of the given encoding into channel buffers.
+///\param   [in]  type:        The encoding of the samples.
+///\param   [in]  bigEndian:   Byte order of the samples.
+///\param   [in]  src:         The raw interleaved frames.
+///\param   [out] dst:         One target pointer per channel.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  frameBytes:  Size of a frame in bytes.
+///\param   [in]  numFrames:   Number of frames to convert.
+///\remarks Float data in native byte order (the common case) goes through the
+///         vectorized deinterleave() without any conversion.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+static void convertSamples(MappedSnippet::SampleType type, bool bigEndian, const uchar* src, T* const* dst, int numChannels, int frameBytes, qint64 numFrames)
+{
+  const bool nativeOrder = bigEndian == (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+  const bool aligned     = (reinterpret_cast<quintptr>(src) % sizeof(T)) == 0;
+  switch (type)
+  {
+  case MappedSnippet::Int8:
+    convertFrames<Int8Decoder>(src, dst, numChannels, frameBytes, numFrames);
+    break;
+  case MappedSnippet::UInt8:
+    convertFrames<UInt8Decoder>(src, dst, numChannels, frameBytes, numFrames);
+    break;
+  case MappedSnippet::Int16:
+    if (bigEndian)
+      convertFrames<Int16Decoder<true> >(src, dst, numChannels, frameBytes, numFrames);
+    else
+      convertFrames<Int16Decoder<false> >(src, dst, numChannels, frameBytes, numFrames);
+    break;
+  case MappedSnippet::Int24:
+    if (bigEndian)
+      convertFrames<Int24Decoder<true> >(src, dst, numChannels, frameBytes, numFrames);
+    else
+      convertFrames<Int24Decoder<false> >(src, dst, numChannels, frameBytes, numFrames);
+    break;
+  case MappedSnippet::Int32:
+    if (bigEndian)
+      convertFrames<Int32Decoder<true> >(src, dst, numChannels, frameBytes, numFrames);
+    else
+      convertFrames<Int32Decoder<false> >(src, dst, numChannels, frameBytes, numFrames);
+    break;
+  case MappedSnippet::Float32:
+    if (nativeOrder && aligned && sizeof(T) == sizeof(float))
+      deinterleave(reinterpret_cast<const T*>(src), dst, numChannels, numFrames);
+    else if (bigEndian)
+      convertFrames<Float32Decoder<true> >(src, dst, numChannels, frameBytes, numFrames);
+    else
+      convertFrames<Float32Decoder<false> >(src, dst, numChannels, frameBytes, numFrames);
+    break;
+  case MappedSnippet::Float64:
+    if (nativeOrder && aligned && sizeof(T) == sizeof(double))
+      deinterleave(reinterpret_cast<const T*>(src), dst, numChannels, numFrames);
+    else if (bigEndian)
+      convertFrames<Float64Decoder<true> >(src, dst, numChannels, frameBytes, numFrames);
+    else
+      convertFrames<Float64Decoder<false> >(src, dst, numChannels, frameBytes, numFrames);
+    break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// rawSample()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Decode a single sample into the target format of a raw read.
+///\param   [in]  p:   The raw sample.
+///\param   [out] out: The decoded sample.
+////////////////////////////////////////////////////////////////////////////////
+template <typename D>
+static inline void rawSample(const uchar* p, qint16& out)
+{
+  out = static_cast<qint16>(D::raw(p) >> 16);
+}
+
+template <typename D>
+static inline void rawSample(const uchar* p, qint32& out)
+{
+  out = D::raw(p);
+}
+
+template <typename D>
+static inline void rawSample(const uchar* p, float& out)
+{
+  out = D::template value<float>(p);
+}
+
+template <typename D>
+static inline void rawSample(const uchar* p, double& out)
+{
+  out = D::template value<double>(p);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// rawType()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   The encoding that matches the target of a raw read.
+///\return  The encoding that can be copied without conversion.
+////////////////////////////////////////////////////////////////////////////////
+static inline MappedSnippet::SampleType rawType(const qint16*)
+{
+  return MappedSnippet::Int16;
+}
+
+static inline MappedSnippet::SampleType rawType(const qint32*)
+{
+  return MappedSnippet::Int32;
+}
+
+static inline MappedSnippet::SampleType rawType(const float*)
+{
+  return MappedSnippet::Float32;
+}
+
+static inline MappedSnippet::SampleType rawType(const double*)
+{
+  return MappedSnippet::Float64;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// convertRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Convert raw samples into interleaved samples of another format.
+///\param   [in]  src:        The raw samples.
+///\param   [out] dst:        The target samples.
+///\param   [in]  numSamples: Number of samples (not frames) to convert.
+////////////////////////////////////////////////////////////////////////////////
+template <typename D, typename T>
+static void convertRaw(const uchar* src, T* dst, qint64 numSamples)
+{
+  for (qint64 i = 0; i < numSamples; i++, src += D::Size)
+    rawSample<D>(src, dst[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// convertRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Convert raw samples of the given encoding into interleaved samples.
+///\param   [in]  type:       The encoding of the samples.
+///\param   [in]  bigEndian:  Byte order of the samples.
+///\param   [in]  src:        The raw samples.
+///\param   [out] dst:        The target samples.
+///\param   [in]  numSamples: Number of samples (not frames) to convert.
+///\remarks If the encoding matches the target then it's a plain copy.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+static void convertRaw(MappedSnippet::SampleType type, bool bigEndian, const uchar* src, T* dst, qint64 numSamples)
+{
+  // Same format?
+  const bool nativeOrder = bigEndian == (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+  if (nativeOrder && type == rawType(dst))
+  {
+    memcpy(dst, src, numSamples * sizeof(T));
+    return;
+  }
+
+  // Convert:
+  switch (type)
+  {
+  case MappedSnippet::Int8:
+    convertRaw<Int8Decoder>(src, dst, numSamples);
+    break;
+  case MappedSnippet::UInt8:
+    convertRaw<UInt8Decoder>(src, dst, numSamples);
+    break;
+  case MappedSnippet::Int16:
+    if (bigEndian)
+      convertRaw<Int16Decoder<true> >(src, dst, numSamples);
+    else
+      convertRaw<Int16Decoder<false> >(src, dst, numSamples);
+    break;
+  case MappedSnippet::Int24:
+    if (bigEndian)
+      convertRaw<Int24Decoder<true> >(src, dst, numSamples);
+    else
+      convertRaw<Int24Decoder<false> >(src, dst, numSamples);
+    break;
+  case MappedSnippet::Int32:
+    if (bigEndian)
+      convertRaw<Int32Decoder<true> >(src, dst, numSamples);
+    else
+      convertRaw<Int32Decoder<false> >(src, dst, numSamples);
+    break;
+  case MappedSnippet::Float32:
+    if (bigEndian)
+      convertRaw<Float32Decoder<true> >(src, dst, numSamples);
+    else
+      convertRaw<Float32Decoder<false> >(src, dst, numSamples);
+    break;
+  case MappedSnippet::Float64:
+    if (bigEndian)
+      convertRaw<Float64Decoder<true> >(src, dst, numSamples);
+    else
+      convertRaw<Float64Decoder<false> >(src, dst, numSamples);
+    break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readChunkHeader()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a chunk header or any other small block of a file.
+///\param   [in]  file:  The file to read from.
+///\param   [in]  pos:   Where to read.
+///\param   [out] data:  The target for the bytes.
+///\param   [in]  count: Number of bytes to read.
+///\return  true if all bytes could be read.
+////////////////////////////////////////////////////////////////////////////////
+static bool readChunkHeader(QFile& file, qint64 pos, uchar* data, qint64 count)
+{
+  if (!file.seek(pos))
+    return false;
+  return file.read(reinterpret_cast<char*>(data), count) == count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findRiffData()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the data chunk of a RIFF or RIFX (WAV) file.
+///\param   [in]  file:      The file to search.
+///\param   [in]  bigEndian: RIFX file?
+///\param   [out] offset:    Start of the sample data.
+///\return  true if the chunk was found.
+////////////////////////////////////////////////////////////////////////////////
+static bool findRiffData(QFile& file, bool bigEndian, qint64& offset)
+{
+  // Walk the chunk list behind the "RIFF" size "WAVE" header:
+  qint64 pos = 12;
+  uchar chunk[8];
+  while (readChunkHeader(file, pos, chunk, 8))
+  {
+    if (memcmp(chunk, "data", 4) == 0)
+    {
+      offset = pos + 8;
+      return true;
+    }
+    quint32 size = bigEndian ? loadInt<quint32, true>(chunk + 4) : loadInt<quint32, false>(chunk + 4);
+    pos += 8 + qint64(size) + (size & 1);
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findW64Data()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the data chunk of a Sony Wave64 file.
+///\param   [in]  file:   The file to search.
+///\param   [out] offset: Start of the sample data.
+///\return  true if the chunk was found.
+////////////////////////////////////////////////////////////////////////////////
+static bool findW64Data(QFile& file, qint64& offset)
+{
+  static const uchar dataGuid[16] =
+  {
+    'd', 'a', 't', 'a', 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+  };
+
+  // Walk the chunk list behind the riff and wave GUIDs, sizes include the
+  // 24 byte header and chunks are aligned to 8 bytes:
+  qint64 pos = 40;
+  uchar chunk[24];
+  while (readChunkHeader(file, pos, chunk, 24))
+  {
+    if (memcmp(chunk, dataGuid, 16) == 0)
+    {
+      offset = pos + 24;
+      return true;
+    }
+    quint64 size = loadInt<quint64, false>(chunk + 16);
+    if (size < 24)
+      return false;
+    pos += qint64((size + 7) & ~quint64(7));
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findAiffData()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the sound data chunk of an AIFF or AIFC file.
+///\param   [in]  file:      The file to search.
+///\param   [out] offset:    Start of the sample data.
+///\param   [out] bigEndian: Byte order of the samples.
+///\return  true if the chunk was found.
+///\remarks AIFF is always big endian, AIFC can be little endian ("sowt").
+////////////////////////////////////////////////////////////////////////////////
+static bool findAiffData(QFile& file, qint64& offset, bool& bigEndian)
+{
+  // Walk the chunk list behind the "FORM" size "AIFF" header:
+  bool foundComm = false;
+  bool foundData = false;
+  bigEndian = true;
+  qint64 pos = 12;
+  uchar chunk[8];
+  while ((!foundComm || !foundData) && readChunkHeader(file, pos, chunk, 8))
+  {
+    quint32 size = loadInt<quint32, true>(chunk + 4);
+    if (memcmp(chunk, "COMM", 4) == 0)
+    {
+      // channels (2), frames (4), bits (2), rate (10), AIFC compression (4):
+      uchar comm[22];
+      if (size >= 22 && readChunkHeader(file, pos + 8, comm, 22))
+        bigEndian = memcmp(comm + 18, "sowt", 4) != 0;
+      foundComm = true;
+    }
+    else if (memcmp(chunk, "SSND", 4) == 0)
+    {
+      // The sample data starts behind offset and block size:
+      uchar ssnd[4];
+      if (!readChunkHeader(file, pos + 8, ssnd, 4))
+        return false;
+      offset = pos + 16 + loadInt<quint32, true>(ssnd);
+      foundData = true;
+    }
+    pos += 8 + qint64(size) + (size & 1);
+  }
+  return foundData;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findCafData()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the data chunk of a Core Audio file.
+///\param   [in]  file:      The file to search.
+///\param   [out] offset:    Start of the sample data.
+///\param   [out] bigEndian: Byte order of the samples.
+///\return  true if the chunk was found.
+///\remarks The byte order is part of the format flags in the desc chunk.
+////////////////////////////////////////////////////////////////////////////////
+static bool findCafData(QFile& file, qint64& offset, bool& bigEndian)
+{
+  // Walk the chunk list behind the "caff" version flags header:
+  bigEndian = true;
+  qint64 pos = 8;
+  uchar chunk[12];
+  while (readChunkHeader(file, pos, chunk, 12))
+  {
+    qint64 size = static_cast<qint64>(loadInt<quint64, true>(chunk + 4));
+    if (memcmp(chunk, "desc", 4) == 0)
+    {
+      // rate (8), format id (4), format flags (4):
+      uchar desc[16];
+      if (!readChunkHeader(file, pos + 12, desc, 16) || memcmp(desc + 8, "lpcm", 4) != 0)
+        return false;
+      bigEndian = (loadInt<quint32, true>(desc + 12) & 2) == 0;
+    }
+    else if (memcmp(chunk, "data", 4) == 0)
+    {
+      // Skip the edit count:
+      offset = pos + 16;
+      return true;
+    }
+    if (size < 0)
+      return false;
+    pos += 12 + size;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::MappedSnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] numChannels: The number of channels of this snippet.
+///\param   [in] numSamples:  The number of sample frames of this document.
+///\remarks The snippet is empty until open() succeeds.
+////////////////////////////////////////////////////////////////////////////////
+MappedSnippet::MappedSnippet(int numChannels, qint64 numSamples) :
+  AudioSnippet(numChannels, numSamples),
+  m_data(0),
+  m_sampleType(Int16),
+  m_bigEndian(false),
+  m_frameBytes(0)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::~MappedSnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Does final cleanup.
+////////////////////////////////////////////////////////////////////////////////
+MappedSnippet::~MappedSnippet()
+{
+  // Release the mapping:
+  if (m_data != 0)
+    m_file.unmap(m_data);
+  m_data = 0;
+  m_file.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::open()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Map the sample data of a file.
+///\param   [in] fileName: Name of the file to map.
+///\param   [in] format:   The libsndfile format of the file.
+///\return  true if successful or false if the file can't be mapped.
+///\remarks The format comes from sf_open(), this only locates the data chunk
+///         and checks that it fits the channel and frame count.
+////////////////////////////////////////////////////////////////////////////////
+bool MappedSnippet::open(const QString& fileName, int format)
+{
+  // Sanity check:
+  if (m_data != 0 || sampleCount() <= 0 || channelCount() <= 0)
+    return false;
+
+  // Check sample encoding:
+  int sampleBytes = 0;
+  switch (format & SF_FORMAT_SUBMASK)
+  {
+  case SF_FORMAT_PCM_S8: m_sampleType = Int8;    sampleBytes = 1; break;
+  case SF_FORMAT_PCM_U8: m_sampleType = UInt8;   sampleBytes = 1; break;
+  case SF_FORMAT_PCM_16: m_sampleType = Int16;   sampleBytes = 2; break;
+  case SF_FORMAT_PCM_24: m_sampleType = Int24;   sampleBytes = 3; break;
+  case SF_FORMAT_PCM_32: m_sampleType = Int32;   sampleBytes = 4; break;
+  case SF_FORMAT_FLOAT:  m_sampleType = Float32; sampleBytes = 4; break;
+  case SF_FORMAT_DOUBLE: m_sampleType = Float64; sampleBytes = 8; break;
+  default:
+    return false;
+  }
+  m_frameBytes = sampleBytes * channelCount();
+
+  // Open the file:
+  m_file.setFileName(fileName);
+  if (!m_file.open(QIODevice::ReadOnly))
+    return false;
+
+  // Locate the sample data:
+  uchar magic[4];
+  qint64 offset = -1;
+  bool found = readChunkHeader(m_file, 0, magic, 4);
+  switch (format & SF_FORMAT_TYPEMASK)
+  {
+  case SF_FORMAT_WAV:
+  case SF_FORMAT_WAVEX:
+    m_bigEndian = found && memcmp(magic, "RIFX", 4) == 0;
+    found = found && (m_bigEndian || memcmp(magic, "RIFF", 4) == 0) && findRiffData(m_file, m_bigEndian, offset);
+    break;
+  case SF_FORMAT_W64:
+    m_bigEndian = false;
+    found = found && memcmp(magic, "riff", 4) == 0 && findW64Data(m_file, offset);
+    break;
+  case SF_FORMAT_AIFF:
+    found = found && memcmp(magic, "FORM", 4) == 0 && findAiffData(m_file, offset, m_bigEndian);
+    break;
+  case SF_FORMAT_CAF:
+    found = found && memcmp(magic, "caff", 4) == 0 && findCafData(m_file, offset, m_bigEndian);
+    break;
+  default:
+    found = false;
+    break;
+  }
+
+  // Make sure all frames are really there:
+  qint64 dataSize = sampleCount() * m_frameBytes;
+  if (found && offset >= 0 && offset + dataSize <= m_file.size())
+    m_data = m_file.map(offset, dataSize);
+
+  // Cleanup on failure:
+  if (m_data == 0)
+  {
+    m_file.close();
+    return false;
+  }
+
+  // Return success (the mapping stays valid if a save keeps the file aside):
+  setFileName(fileName);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads (not needed here).
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MappedSnippet::readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader /* reader */)
+{
+  return convert(offset, count, buffer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from this snippet, float version.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads (not needed here).
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MappedSnippet::readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader /* reader */)
+{
+  return convert(offset, count, buffer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::nativeFormat()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the format that this snippet can read without conversion.
+///\return  The native sample format.
+///\remarks 8 bit data counts as 16 bit and 24 bit data as 32 bit.
+////////////////////////////////////////////////////////////////////////////////
+AudioSnippet::SampleFormat MappedSnippet::nativeFormat() const
+{
+  switch (m_sampleType)
+  {
+  case Int8:
+  case UInt8:
+  case Int16:
+    return Int16Samples;
+  case Int24:
+  case Int32:
+    return Int32Samples;
+  case Float64:
+    return DoubleSamples;
+  default:
+    return FloatSamples;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved 16 bit sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads (not needed here).
+///\return  The number of samples frames read.
+///\remarks A plain copy if this is the native format of the file.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MappedSnippet::readRaw(const qint64 offset, const qint64 count, qint16* frames, Reader /* reader */)
+{
+  return convertRawFrames(offset, count, frames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved 32 bit sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads (not needed here).
+///\return  The number of samples frames read.
+///\remarks A plain copy if this is the native format of the file.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MappedSnippet::readRaw(const qint64 offset, const qint64 count, qint32* frames, Reader /* reader */)
+{
+  return convertRawFrames(offset, count, frames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved float sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads (not needed here).
+///\return  The number of samples frames read.
+///\remarks A plain copy if this is the native format of the file.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MappedSnippet::readRaw(const qint64 offset, const qint64 count, float* frames, Reader /* reader */)
+{
+  return convertRawFrames(offset, count, frames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved double sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads (not needed here).
+///\return  The number of samples frames read.
+///\remarks A plain copy if this is the native format of the file.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MappedSnippet::readRaw(const qint64 offset, const qint64 count, double* frames, Reader /* reader */)
+{
+  return convertRawFrames(offset, count, frames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::convertRawFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Shared implementation of the readRaw() versions.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\return  The number of samples frames read.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+qint64 MappedSnippet::convertRawFrames(const qint64 offset, const qint64 count, T* frames)
+{
+  // Sanity check:
+  if (m_data == 0 || offset < 0 || offset >= sampleCount() || count <= 0)
+    return 0;
+
+  // Clip to the end of the data:
+  qint64 numFrames = qMin(count, sampleCount() - offset);
+
+  // Convert straight from the mapped pages:
+  convertRaw(m_sampleType, m_bigEndian, m_data + offset * m_frameBytes, frames, numFrames * channelCount());
+
+  // Return number of frames read:
+  return numFrames;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedSnippet::convert()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Shared implementation of both readSamples() versions.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\return  The number of samples frames read.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+qint64 MappedSnippet::convert(const qint64 offset, const qint64 count, SampleBufferT<T>& buffer)
+{
+  // Sanity check:
+  if (m_data == 0 || offset < 0 || offset >= sampleCount() || count <= 0)
+    return 0;
+
+  // Clip to the end of the data:
+  qint64 numFrames = qMin(count, sampleCount() - offset);
+
+  // Convert straight from the mapped pages:
+  int numChannels = channelCount();
+  assert(buffer.channelCount() >= numChannels && buffer.sampleCount() >= numFrames);
+  QVarLengthArray<T*, 8> channels(numChannels);
+  for (int j = 0; j < numChannels; j++)
+    channels[j] = buffer.sampleBuffer(j);
+  convertSamples(m_sampleType, m_bigEndian, m_data + offset * m_frameBytes, channels.constData(), numChannels, m_frameBytes, numFrames);
+
+  // Return number of frames read:
+  return numFrames;
+}
+
+///////////////////////////////// End of File //////////////////////////////////
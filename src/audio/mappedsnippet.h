@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    mappedsnippet.h
+///\ingroup bruo
+///\brief   Memory mapped playlist item class definition.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __MAPPEDSNIPPET_H_INCLUDED__
+#define __MAPPEDSNIPPET_H_INCLUDED__
+
+#include "audiosnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   MappedSnippet mappedsnippet.h
+///\brief   Audio snippet that reads uncompressed files through a memory map.
+///\remarks The data chunk of the file is mapped and the samples are converted
+///         straight from the mapped pages. There is no seeking and no locking
+///         so all readers can access it at the same time. Only plain PCM and
+///         float data in WAV, AIFF, W64 and CAF files is supported, use a
+///         SndFileSnippet for everything else.
+////////////////////////////////////////////////////////////////////////////////
+class MappedSnippet :
+  public AudioSnippet
+{
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::MappedSnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] numChannels: The number of channels of this snippet.
+  ///\param   [in] numSamples:  The number of sample frames of this document.
+  ///\remarks The snippet is empty until open() succeeds.
+  //////////////////////////////////////////////////////////////////////////////
+  MappedSnippet(int numChannels, qint64 numSamples);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::~MappedSnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Does final cleanup.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~MappedSnippet();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::open()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Map the sample data of a file.
+  ///\param   [in] fileName: Name of the file to map.
+  ///\param   [in] format:   The libsndfile format of the file.
+  ///\return  true if successful or false if the file can't be mapped.
+  ///\remarks The format comes from sf_open(), this only locates the data chunk
+  ///         and checks that it fits the channel and frame count.
+  //////////////////////////////////////////////////////////////////////////////
+  bool open(const QString& fileName, int format);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads (not needed here).
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from this snippet, float version.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads (not needed here).
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::nativeFormat()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the format that this snippet can read without conversion.
+  ///\return  The native sample format.
+  ///\remarks 8 bit data counts as 16 bit and 24 bit data as 32 bit.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual SampleFormat nativeFormat() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved 16 bit sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads (not needed here).
+  ///\return  The number of samples frames read.
+  ///\remarks A plain copy if this is the native format of the file.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, qint16* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved 32 bit sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads (not needed here).
+  ///\return  The number of samples frames read.
+  ///\remarks A plain copy if this is the native format of the file.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, qint32* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved float sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads (not needed here).
+  ///\return  The number of samples frames read.
+  ///\remarks A plain copy if this is the native format of the file.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, float* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved double sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads (not needed here).
+  ///\return  The number of samples frames read.
+  ///\remarks A plain copy if this is the native format of the file.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, double* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // enum MappedSnippet::SampleType
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   The sample encodings that can be mapped.
+  //////////////////////////////////////////////////////////////////////////////
+  typedef enum SampleType
+  {
+    Int8    = 0, ///> Signed 8 bit.
+    UInt8   = 1, ///> Unsigned 8 bit.
+    Int16   = 2, ///> Signed 16 bit.
+    Int24   = 3, ///> Signed 24 bit, packed.
+    Int32   = 4, ///> Signed 32 bit.
+    Float32 = 5, ///> IEEE float.
+    Float64 = 6  ///> IEEE double.
+  } SampleType;
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::convert()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Shared implementation of both readSamples() versions.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\return  The number of samples frames read.
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  qint64 convert(const qint64 offset, const qint64 count, SampleBufferT<T>& buffer);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MappedSnippet::convertRawFrames()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Shared implementation of the readRaw() versions.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\return  The number of samples frames read.
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  qint64 convertRawFrames(const qint64 offset, const qint64 count, T* frames);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  QFile       m_file;       ///> The mapped file.
+  uchar*      m_data;       ///> Start of the mapped sample data.
+  SampleType  m_sampleType; ///> Encoding of the samples.
+  bool        m_bigEndian;  ///> Byte order of the samples.
+  int         m_frameBytes; ///> Size of one sample frame in bytes.
+};
+
+#endif // #ifndef __MAPPEDSNIPPET_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
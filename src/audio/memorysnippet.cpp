@@ -0,0 +1,268 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    memorysnippet.cpp
+///\ingroup bruo
+///\brief   Audio snippet that holds its samples in memory.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "memorysnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::MemorySnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] samples: The samples of this snippet.
+///\remarks The samples are copied.
+////////////////////////////////////////////////////////////////////////////////
+MemorySnippet::MemorySnippet(const FloatSampleBuffer& samples) :
+  AudioSnippet(samples.channelCount(), samples.sampleCount()),
+  m_samples(samples),
+  m_swapped(0),
+  m_swapOffset(0)
+{
+  // Read from our buffer:
+  for (int i = 0; i < channelCount(); i++)
+    m_channels.append(m_samples.sampleBuffer(i));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::MemorySnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class, move version.
+///\param   [in] samples: The samples of this snippet.
+///\remarks The snippet takes over the sample buffers.
+////////////////////////////////////////////////////////////////////////////////
+MemorySnippet::MemorySnippet(FloatSampleBuffer&& samples) :
+  AudioSnippet(samples.channelCount(), samples.sampleCount()),
+  m_samples(std::move(samples)),
+  m_swapped(0),
+  m_swapOffset(0)
+{
+  // Read from our buffer:
+  for (int i = 0; i < channelCount(); i++)
+    m_channels.append(m_samples.sampleBuffer(i));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::~MemorySnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Does final cleanup.
+////////////////////////////////////////////////////////////////////////////////
+MemorySnippet::~MemorySnippet()
+{
+  // Give the swap space back:
+  if (m_swapped != 0)
+    m_store->release(m_swapOffset, m_swapped, sampleCount() * channelCount() * qint64(sizeof(float)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MemorySnippet::readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader /* reader */)
+{
+  // Anything to read?
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+
+  // Convert to double:
+  assert(buffer.channelCount() >= channelCount() && buffer.sampleCount() >= numFrames);
+  QReadLocker locker(&m_lock);
+  for (int i = 0; i < channelCount(); i++)
+  {
+    const float* src = m_channels[i] + offset;
+    double* dst = buffer.sampleBuffer(i);
+    for (qint64 j = 0; j < numFrames; j++)
+      dst[j] = src[j];
+  }
+
+  // Return number of frames read:
+  return numFrames;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from this snippet, float version.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MemorySnippet::readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader /* reader */)
+{
+  // Anything to read?
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+
+  // Copy channels:
+  assert(buffer.channelCount() >= channelCount() && buffer.sampleCount() >= numFrames);
+  QReadLocker locker(&m_lock);
+  for (int i = 0; i < channelCount(); i++)
+    memcpy(buffer.sampleBuffer(i), m_channels[i] + offset, numFrames * sizeof(float));
+
+  // Return number of frames read:
+  return numFrames;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::nativeFormat()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the format that this snippet can read without conversion.
+///\return  Always FloatSamples.
+////////////////////////////////////////////////////////////////////////////////
+AudioSnippet::SampleFormat MemorySnippet::nativeFormat() const
+{
+  // We store floats:
+  return FloatSamples;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::memorySize()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the amount of RAM that holds the samples of this snippet.
+///\return  The size of the sample buffer in bytes.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MemorySnippet::memorySize() const
+{
+  // Paged out samples don't count:
+  QReadLocker locker(&m_lock);
+  if (m_swapped != 0)
+    return 0;
+
+  // All channels are in memory:
+  return sampleCount() * channelCount() * qint64(sizeof(float));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::pageOut()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move the samples of this snippet from RAM to a swap file.
+///\param   [in] store: The swap file to use.
+///\return  true if the samples are not in RAM anymore.
+///\remarks The samples are written while the readers go on, only the
+///         switch to the mapped file blocks them for a moment.
+////////////////////////////////////////////////////////////////////////////////
+bool MemorySnippet::pageOut(const QSharedPointer<SwapStore>& store)
+{
+  // Already paged out? Only the owning thread switches, so no lock here:
+  if (m_swapped != 0)
+    return true;
+  if (sampleCount() == 0)
+    return true;
+  if (store.isNull())
+    return false;
+
+  // Write the channels one after another:
+  const qint64 channelBytes = sampleCount() * qint64(sizeof(float));
+  const qint64 size = channelBytes * channelCount();
+  const qint64 offset = store->allocate(size);
+  if (offset < 0)
+    return false;
+  bool ok = true;
+  for (int i = 0; ok && i < channelCount(); i++)
+    ok = store->write(offset + i * channelBytes, m_samples.sampleBuffer(i), channelBytes);
+
+  // Map them:
+  const uchar* address = ok ? store->map(offset, size) : 0;
+  if (address == 0)
+  {
+    store->release(offset, 0, size);
+    return false;
+  }
+
+  // Switch the readers to the file:
+  QWriteLocker locker(&m_lock);
+  for (int i = 0; i < channelCount(); i++)
+    m_channels[i] = reinterpret_cast<const float*>(address + i * channelBytes);
+  m_store      = store;
+  m_swapped    = address;
+  m_swapOffset = offset;
+
+  // Free the RAM:
+  m_samples = FloatSampleBuffer();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved float sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MemorySnippet::readRaw(const qint64 offset, const qint64 count, float* frames, Reader /* reader */)
+{
+  // Anything to read?
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+
+  // Interleave channels:
+  const int numChannels = channelCount();
+  QReadLocker locker(&m_lock);
+  for (int i = 0; i < numChannels; i++)
+  {
+    const float* src = m_channels[i] + offset;
+    for (qint64 j = 0; j < numFrames; j++)
+      frames[j * numChannels + i] = src[j];
+  }
+
+  // Return number of frames read:
+  return numFrames;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MemorySnippet::clipCount()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Limit a read to the samples of this snippet.
+///\param   [in] offset: Position where to start reading.
+///\param   [in] count:  Number of sample frames to read.
+///\return  The number of frames that can be read.
+////////////////////////////////////////////////////////////////////////////////
+qint64 MemorySnippet::clipCount(const qint64 offset, const qint64 count) const
+{
+  // Outside of our samples?
+  if (offset < 0 || offset >= sampleCount())
+    return 0;
+
+  // Clip to the end:
+  return qMin(count, sampleCount() - offset);
+}
+
+///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    memorysnippet.h
+///\ingroup bruo
+///\brief   Audio snippet that holds its samples in memory.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __MEMORYSNIPPET_H_INCLUDED__
+#define __MEMORYSNIPPET_H_INCLUDED__
+
+#include "audiosnippet.h"
+#include "swapstore.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   MemorySnippet memorysnippet.h
+///\brief   Audio snippet for new audio that doesn't come from a file.
+///\remarks The samples are stored as single precision floats and never change
+///         after construction, so all readers can read at the same time. The
+///         samples can be paged out to a swap file, then they are read from
+///         a memory map of that file.
+////////////////////////////////////////////////////////////////////////////////
+class MemorySnippet :
+  public AudioSnippet
+{
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::MemorySnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] samples: The samples of this snippet.
+  ///\remarks The samples are copied.
+  //////////////////////////////////////////////////////////////////////////////
+  MemorySnippet(const FloatSampleBuffer& samples);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::MemorySnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class, move version.
+  ///\param   [in] samples: The samples of this snippet.
+  ///\remarks The snippet takes over the sample buffers.
+  //////////////////////////////////////////////////////////////////////////////
+  MemorySnippet(FloatSampleBuffer&& samples);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::~MemorySnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Does final cleanup.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~MemorySnippet();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from this snippet, float version.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::nativeFormat()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the format that this snippet can read without conversion.
+  ///\return  Always FloatSamples.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual SampleFormat nativeFormat() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::memorySize()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the amount of RAM that holds the samples of this snippet.
+  ///\return  The size of the sample buffer in bytes.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 memorySize() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::pageOut()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move the samples of this snippet from RAM to a swap file.
+  ///\param   [in] store: The swap file to use.
+  ///\return  true if the samples are not in RAM anymore.
+  ///\remarks The samples are written while the readers go on, only the
+  ///         switch to the mapped file blocks them for a moment.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual bool pageOut(const QSharedPointer<SwapStore>& store);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved float sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, float* frames, Reader reader = SharedReader);
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MemorySnippet::clipCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Limit a read to the samples of this snippet.
+  ///\param   [in] offset: Position where to start reading.
+  ///\param   [in] count:  Number of sample frames to read.
+  ///\return  The number of frames that can be read.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 clipCount(const qint64 offset, const qint64 count) const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  FloatSampleBuffer          m_samples;    ///> The samples of this snippet.
+  QVector<const float*>      m_channels;   ///> Where to read the channels from.
+  QSharedPointer<SwapStore>  m_store;      ///> The swap file once paged out.
+  const uchar*               m_swapped;    ///> The mapped samples or 0.
+  qint64                     m_swapOffset; ///> Position of the samples in the swap file.
+  mutable QReadWriteLock     m_lock;       ///> Guards the switch to the swap file.
+};
+
+#endif // #ifndef __MEMORYSNIPPET_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
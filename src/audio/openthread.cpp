@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    openthread.cpp
+///\ingroup bruo
+///\brief   Background file open thread implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "openthread.h"
+#include "document.h"
+#include <sndfile.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenThread::OpenThread()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] parent: Parent for this instance.
+////////////////////////////////////////////////////////////////////////////////
+OpenThread::OpenThread(QObject* parent) :
+  QThread(parent),
+  m_source(0),
+  m_sampleRate(0.0),
+  m_format(0)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenThread::~OpenThread()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Waits for a running open and frees a source that nobody took.
+////////////////////////////////////////////////////////////////////////////////
+OpenThread::~OpenThread()
+{
+  // Wait for the file system:
+  wait();
+
+  // Release the result:
+  delete m_source;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenThread::startOpen()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Start opening a file.
+///\param   [in] fileName: The file to open.
+///\return  true if the open was started or false if one is still running.
+///\remarks The finished() signal is emitted when done.
+////////////////////////////////////////////////////////////////////////////////
+bool OpenThread::startOpen(const QString& fileName)
+{
+  // Only one open at a time:
+  if (isRunning())
+    return false;
+
+  // Drop an old result that nobody took:
+  delete m_source;
+  m_source = 0;
+
+  // Take the new job:
+  m_fileName   = fileName;
+  m_sampleRate = 0.0;
+  m_format     = 0;
+  m_lastError  = "";
+
+  // Go:
+  start();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenThread::fileName()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the file of the last open.
+///\return  The file name.
+////////////////////////////////////////////////////////////////////////////////
+const QString& OpenThread::fileName() const
+{
+  // Return file:
+  return m_fileName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenThread::lastError()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the reason why the last open failed.
+///\return  The error as string.
+////////////////////////////////////////////////////////////////////////////////
+const QString& OpenThread::lastError() const
+{
+  // Return reason:
+  return m_lastError;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenThread::takeSource()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Take the result of the last open.
+///\param   [out] sampleRate: Samples per second of the file.
+///\param   [out] format:     Id of the file format.
+///\return  The new source (owned by the caller now) or 0 on error.
+////////////////////////////////////////////////////////////////////////////////
+AudioSnippet* OpenThread::takeSource(double& sampleRate, int& format)
+{
+  // Hand over the result:
+  AudioSnippet* source = m_source;
+  m_source   = 0;
+  sampleRate = m_sampleRate;
+  format     = m_format;
+  return source;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenThread::run()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   The actual thread function.
+////////////////////////////////////////////////////////////////////////////////
+void OpenThread::run()
+{
+  // Parse the header and create the source:
+  m_source = Document::openSource(m_fileName, m_sampleRate, m_format);
+  if (m_source == 0)
+    m_lastError = QString(sf_strerror(0));
+}
+
+///////////////////////////////// End of File //////////////////////////////////
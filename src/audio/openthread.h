@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    openthread.h
+///\ingroup bruo
+///\brief   Background file open thread.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __OPENTHREAD_H_INCLUDED__
+#define __OPENTHREAD_H_INCLUDED__
+
+#include <QThread>
+#include "audiosnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   OpenThread openthread.h
+///\brief   Helper thread class to open an audio file in the background.
+///\remarks Parsing the header and creating the source can take a while on
+///         network mounts or with big headers, so this is kept away from the
+///         GUI thread. Every open runs in a thread of its own that deletes
+///         itself when done, so closing a document never waits for it.
+////////////////////////////////////////////////////////////////////////////////
+class OpenThread : public QThread
+{
+  Q_OBJECT // Qt magic...
+
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // OpenThread::OpenThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] parent: Parent for this instance.
+  //////////////////////////////////////////////////////////////////////////////
+  OpenThread(QObject* parent = 0);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // OpenThread::~OpenThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Waits for a running open and frees a source that nobody took.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~OpenThread();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // OpenThread::startOpen()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Start opening a file.
+  ///\param   [in] fileName: The file to open.
+  ///\return  true if the open was started or false if one is still running.
+  ///\remarks The finished() signal is emitted when done.
+  //////////////////////////////////////////////////////////////////////////////
+  bool startOpen(const QString& fileName);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // OpenThread::fileName()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the file of the last open.
+  ///\return  The file name.
+  //////////////////////////////////////////////////////////////////////////////
+  const QString& fileName() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // OpenThread::lastError()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the reason why the last open failed.
+  ///\return  The error as string.
+  //////////////////////////////////////////////////////////////////////////////
+  const QString& lastError() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // OpenThread::takeSource()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Take the result of the last open.
+  ///\param   [out] sampleRate: Samples per second of the file.
+  ///\param   [out] format:     Id of the file format.
+  ///\return  The new source (owned by the caller now) or 0 on error.
+  //////////////////////////////////////////////////////////////////////////////
+  AudioSnippet* takeSource(double& sampleRate, int& format);
+
+protected:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // OpenThread::run()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   The actual thread function.
+  //////////////////////////////////////////////////////////////////////////////
+  void run();
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  QString       m_fileName;   ///> The file to open.
+  AudioSnippet* m_source;     ///> The opened source until it's taken.
+  double        m_sampleRate; ///> Sample rate of the file.
+  int           m_format;     ///> Id of the file format.
+  QString       m_lastError;  ///> Why did the last open fail?
+};
+
+#endif // #ifndef __OPENTHREAD_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
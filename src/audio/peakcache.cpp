@@ -0,0 +1,261 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    peakcache.cpp
+///\ingroup bruo
+///\brief   Persistent peak data cache implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "peakcache.h"
+#include <QCryptographicHash>
+#include <QStandardPaths>
+
+////////////////////////////////////////////////////////////////////////////////
+// Layout of an entry: the header, one level descriptor per mipmap and then the
+// peaks of every level (sorted by channel). Entries are written in host byte
+// order, the cache is never shared between machines.
+static const char    s_magic[8]    = { 'B', 'R', 'U', 'O', 'P', 'E', 'A', 'K' };
+static const quint32 s_version     = 3;
+static const int     s_headerBytes = 65536; ///> Bytes of the audio file hashed.
+
+struct PeakCacheHeader
+{
+  char    magic[8];    ///> Always s_magic.
+  quint32 version;     ///> Layout version, always s_version.
+  quint32 numChannels; ///> Number of channels of the audio file.
+  double  sampleRate;  ///> Samplerate of the audio file.
+  qint64  sampleCount; ///> Number of sample frames of the audio file.
+  quint32 numMipmaps;  ///> Number of levels.
+  quint32 reserved;    ///> Keeps the level descriptors aligned.
+};
+
+struct PeakCacheLevel
+{
+  qint64 divisionFactor; ///> Samples represented by each peak value.
+  qint64 sampleCount;    ///> Number of peak values per channel.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// PeakCache::load()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Fill peak data from the cache.
+///\param   [in]  fileName:    The audio file.
+///\param   [in]  numChannels: Number of channels of the file.
+///\param   [in]  sampleRate:  Samplerate of the file.
+///\param   [in]  sampleCount: Number of sample frames of the file.
+///\param   [out] peaks:       The peak data to fill.
+///\return  true if the peaks were found or false otherwise.
+///\remarks The peaks stay mapped until the peak data is reallocated.
+////////////////////////////////////////////////////////////////////////////////
+bool PeakCache::load(const QString& fileName, int numChannels, double sampleRate, qint64 sampleCount, PeakData& peaks)
+{
+  // Find the entry:
+  const QString name = entryName(fileName);
+  if (name.isEmpty() || !QFile::exists(name))
+    return false;
+
+  // Map it (private, so later edits of the peaks never reach the file):
+  QFile* file = new QFile(name);
+  const qint64 size = file->size();
+  uchar* base = 0;
+  if (size >= qint64(sizeof(PeakCacheHeader)) && file->open(QIODevice::ReadOnly))
+    base = file->map(0, size, QFileDevice::MapPrivateOption);
+  if (base == 0)
+  {
+    delete file;
+    return false;
+  }
+
+  // Check the header:
+  const PeakCacheHeader* header = reinterpret_cast<const PeakCacheHeader*>(base);
+  qint64 offset = sizeof(PeakCacheHeader) + qint64(header->numMipmaps) * sizeof(PeakCacheLevel);
+  if (memcmp(header->magic, s_magic, sizeof(s_magic)) != 0 || header->version != s_version ||
+      header->numChannels != quint32(numChannels) || header->sampleRate != sampleRate ||
+      header->sampleCount != sampleCount || header->numMipmaps == 0 || header->numMipmaps > 64 ||
+      offset > size)
+  {
+    delete file;
+    return false;
+  }
+
+  // Set up the levels on top of the mapping:
+  const PeakCacheLevel* levels = reinterpret_cast<const PeakCacheLevel*>(base + sizeof(PeakCacheHeader));
+  MipmapLevel* mipmaps = new MipmapLevel[header->numMipmaps];
+  for (quint32 i = 0; i < header->numMipmaps; i++)
+  {
+    const qint64 bytes = qint64(levels[i].sampleCount) * numChannels * sizeof(PeakSample);
+    if (levels[i].divisionFactor <= 0 || levels[i].divisionFactor > 0x40000000 || levels[i].sampleCount <= 0 || offset + bytes > size)
+    {
+      delete [] mipmaps;
+      delete file;
+      return false;
+    }
+    mipmaps[i].setChannelCount(numChannels);
+    mipmaps[i].setDivisionFactor(static_cast<int>(levels[i].divisionFactor));
+    mipmaps[i].setSampleCount(levels[i].sampleCount);
+    mipmaps[i].attachSamples(reinterpret_cast<PeakSample*>(base + offset));
+    offset += bytes;
+  }
+
+  // Mark the entry as recently used:
+  file->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+  // Hand everything over:
+  peaks.attachMipMaps(mipmaps, header->numMipmaps, numChannels, sampleRate, sampleCount, file);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PeakCache::store()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Write complete peak data to the cache.
+///\param   [in] fileName: The audio file.
+///\param   [in] peaks:    The peaks of the file.
+///\param   [in] maxSize:  Size limit of the whole cache in bytes.
+///\return  true if successful or false otherwise.
+///\remarks Old entries are removed afterwards until the cache fits the limit.
+////////////////////////////////////////////////////////////////////////////////
+bool PeakCache::store(const QString& fileName, const PeakData& peaks, qint64 maxSize)
+{
+  // Anything to store?
+  if (!peaks.valid() || maxSize <= 0)
+    return false;
+  const QString name = entryName(fileName);
+  if (name.isEmpty())
+    return false;
+
+  // Compose header and level descriptors:
+  PeakCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, s_magic, sizeof(s_magic));
+  header.version     = s_version;
+  header.numChannels = peaks.channelCount();
+  header.sampleRate  = peaks.sampleRate();
+  header.sampleCount = peaks.sampleCount();
+  header.numMipmaps  = peaks.mipmapCount();
+  QVector<PeakCacheLevel> levels(peaks.mipmapCount());
+  for (int i = 0; i < levels.size(); i++)
+  {
+    levels[i].divisionFactor = peaks.mipmaps()[i].divisionFactor();
+    levels[i].sampleCount    = peaks.mipmaps()[i].sampleCount();
+  }
+
+  // Write everything to a temporary file first, so readers never see half an
+  // entry:
+  QSaveFile file(name);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(levels.constData()), levels.size() * sizeof(PeakCacheLevel));
+  for (int i = 0; i < levels.size(); i++)
+  {
+    const qint64 bytes = qint64(levels[i].sampleCount) * header.numChannels * sizeof(PeakSample);
+    file.write(reinterpret_cast<const char*>(peaks.mipmaps()[i].data()), bytes);
+  }
+  if (!file.commit())
+    return false;
+
+  // Keep the cache small:
+  trim(maxSize);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PeakCache::trim()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Remove the least recently used entries.
+///\param   [in] maxSize: Size limit of the whole cache in bytes.
+///\remarks Entries are touched whenever they are used, so the modification
+///         time tells the last use.
+////////////////////////////////////////////////////////////////////////////////
+void PeakCache::trim(qint64 maxSize)
+{
+  // Get entries, most recently used first:
+  const QString path = cachePath();
+  if (path.isEmpty())
+    return;
+  QFileInfoList entries = QDir(path).entryInfoList(QStringList("*.peaks"), QDir::Files, QDir::Time);
+
+  // Keep as many as fit:
+  qint64 total = 0;
+  for (int i = 0; i < entries.size(); i++)
+  {
+    total += entries[i].size();
+    if (total > maxSize)
+      QFile::remove(entries[i].filePath());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PeakCache::cachePath()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the directory of the cache.
+///\return  The path including the trailing slash or an empty string.
+////////////////////////////////////////////////////////////////////////////////
+QString PeakCache::cachePath()
+{
+  // Get the per-user cache directory:
+  QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if (path.isEmpty())
+    return "";
+  path += QDir::separator() + QString("peaks") + QDir::separator();
+
+  // Create path if needed:
+  if (!QDir(path).exists() && !QDir().mkpath(path))
+    return "";
+
+  // Return the path:
+  return path;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PeakCache::entryName()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Compose the name of the cache entry of a file.
+///\param   [in] fileName: The audio file.
+///\return  The entry file name or an empty string on errors.
+////////////////////////////////////////////////////////////////////////////////
+QString PeakCache::entryName(const QString& fileName)
+{
+  // Get the file properties:
+  QFileInfo info(fileName);
+  const QString path = cachePath();
+  if (!info.exists() || path.isEmpty())
+    return "";
+
+  // Read the header:
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return "";
+  const QByteArray header = file.read(s_headerBytes);
+
+  // Hash everything that identifies the contents:
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(info.canonicalFilePath().toUtf8());
+  hash.addData(QByteArray::number(info.size()));
+  hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+  hash.addData(header);
+
+  // Return the name:
+  return path + QString(hash.result().toHex()) + ".peaks";
+}
+
+///////////////////////////////// End of File //////////////////////////////////
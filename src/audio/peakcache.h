@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    peakcache.h
+///\ingroup bruo
+///\brief   Persistent peak data cache.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __PEAKCACHE_H_INCLUDED__
+#define __PEAKCACHE_H_INCLUDED__
+
+#include "bruo.h"
+#include "peakdata.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   PeakCache peakcache.h
+///\brief   Keeps the peaks of audio files on disk between sessions.
+///\remarks The cache lives in the per-user cache directory. Entries are keyed
+///         by path, size, modification time and a hash of the file header,
+///         so a changed file never uses stale peaks. Entries are mapped
+///         straight into the peak data when a file is opened again, and the
+///         least recently used ones are removed when the cache grows too big.
+////////////////////////////////////////////////////////////////////////////////
+class PeakCache
+{
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakCache::load()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Fill peak data from the cache.
+  ///\param   [in]  fileName:    The audio file.
+  ///\param   [in]  numChannels: Number of channels of the file.
+  ///\param   [in]  sampleRate:  Samplerate of the file.
+  ///\param   [in]  sampleCount: Number of sample frames of the file.
+  ///\param   [out] peaks:       The peak data to fill.
+  ///\return  true if the peaks were found or false otherwise.
+  ///\remarks The peaks stay mapped until the peak data is reallocated.
+  //////////////////////////////////////////////////////////////////////////////
+  static bool load(const QString& fileName, int numChannels, double sampleRate, qint64 sampleCount, PeakData& peaks);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakCache::store()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Write complete peak data to the cache.
+  ///\param   [in] fileName: The audio file.
+  ///\param   [in] peaks:    The peaks of the file.
+  ///\param   [in] maxSize:  Size limit of the whole cache in bytes.
+  ///\return  true if successful or false otherwise.
+  ///\remarks Old entries are removed afterwards until the cache fits the limit.
+  //////////////////////////////////////////////////////////////////////////////
+  static bool store(const QString& fileName, const PeakData& peaks, qint64 maxSize);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakCache::trim()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Remove the least recently used entries.
+  ///\param   [in] maxSize: Size limit of the whole cache in bytes.
+  //////////////////////////////////////////////////////////////////////////////
+  static void trim(qint64 maxSize);
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakCache::cachePath()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Find the directory of the cache.
+  ///\return  The path including the trailing slash or an empty string.
+  //////////////////////////////////////////////////////////////////////////////
+  static QString cachePath();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakCache::entryName()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Compose the name of the cache entry of a file.
+  ///\param   [in] fileName: The audio file.
+  ///\return  The entry file name or an empty string on errors.
+  //////////////////////////////////////////////////////////////////////////////
+  static QString entryName(const QString& fileName);
+};
+
+#endif // #ifndef __PEAKCACHE_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
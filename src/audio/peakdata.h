@@ -3,17 +3,49 @@
 
 #include "bruo.h"
 #include "audio/samplebuffer.h"
+#include "audio/samplekernels.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // struct PeakSample
 ////////////////////////////////////////////////////////////////////////////////
-///\brief One audio peak data sample.
+///\brief   One audio peak data sample.
+///\remarks The values are stored as 16 bit (-32767..32767 for -1..1), use
+///         peakValue() and quantizePeak() to convert them.
 struct PeakSample
 {
-  float maxVal; ///> Maximum value of this sample interval.
-  float minVal; ///> Minimum value of this sample interval.
+  qint16 maxVal; ///> Maximum value of this sample interval.
+  qint16 minVal; ///> Minimum value of this sample interval.
+  qint16 rmsVal; ///> RMS value of this sample interval.
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// quantizePeak()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Convert a sample value to the peak data format.
+///\param   [in] value: The value, will be clipped to -1..1.
+///\return  The stored value.
+////////////////////////////////////////////////////////////////////////////////
+inline qint16 quantizePeak(float value)
+{
+  if (value >= 1.0f)
+    return 32767;
+  if (value <= -1.0f)
+    return -32767;
+  return static_cast<qint16>(qRound(value * 32767.0f));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// peakValue()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Convert a stored peak value back to a sample value.
+///\param   [in] value: The stored value.
+///\return  The sample value (-1..1).
+////////////////////////////////////////////////////////////////////////////////
+inline float peakValue(qint16 value)
+{
+  return value * (1.0f / 32767.0f);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief One channel of audio peak data.
 typedef PeakSample* PeakChannel;
@@ -39,7 +71,12 @@ class MipmapLevel
     m_numSamples(0),
     m_numChannels(0),
     m_data(0),
-    m_samples(0)
+    m_samples(0),
+    m_external(false),
+    m_valueFrames(0),
+    m_offset(0),
+    m_frameCount(0),
+    m_squares(0)
   {
     // Nothing to do here.
   }
@@ -52,13 +89,16 @@ class MipmapLevel
   //////////////////////////////////////////////////////////////////////////////
   virtual ~MipmapLevel()
   {
-    // Free buffers:
-    if (m_data != 0)
+    // Free buffers (external ones belong to someone else):
+    if (m_data != 0 && !m_external)
       delete [] m_data;
     if (m_samples != 0)
       delete [] m_samples;
+    if (m_squares != 0)
+      delete [] m_squares;
     m_data    = 0;
     m_samples = 0;
+    m_squares = 0;
 
     // Reset members:
     m_cursor         = 0;
@@ -84,12 +124,13 @@ class MipmapLevel
       return false;
 
     // Free old buffers (if any):
-    if (m_data != 0)
+    if (m_data != 0 && !m_external)
       delete [] m_data;
     if (m_samples != 0)
       delete [] m_samples;
-    m_data    = 0;
-    m_samples = 0;
+    m_data     = 0;
+    m_samples  = 0;
+    m_external = false;
 
     // Create sample buffer:
     m_data = new PeakSample[m_numChannels * m_numSamples];
@@ -108,14 +149,55 @@ class MipmapLevel
     for (int i = 0; i < m_numChannels; i++)
       m_samples[i] = m_data + i * m_numSamples;
 
+    // Create the RMS sums of the current value:
+    if (m_squares != 0)
+      delete [] m_squares;
+    m_squares = new float[m_numChannels];
+
     // Reset write cursors:
-    m_cursor = 0;
-    m_block  = 0;
+    m_cursor      = 0;
+    m_block       = 0;
+    m_valueFrames = 0;
+    m_offset      = 0;
+    m_frameCount  = 0;
 
     // Return success:
     return true;
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::seek()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Start writing in the middle of the first peak value.
+  ///\param   [in] cursor: Samples of the first value that are not part of the
+  ///                      following adds.
+  ///\remarks Used by the parallel peak build: a level that covers one chunk
+  ///         of a file starts where the chunk starts. The first value is
+  ///         then only partial and must be merged with the previous chunk.
+  //////////////////////////////////////////////////////////////////////////////
+  void seek(int cursor)
+  {
+    // Set write cursors, the first value is initialized by the next add:
+    m_cursor      = cursor;
+    m_block       = 0;
+    m_valueFrames = 0;
+    m_offset      = cursor;
+    m_frameCount  = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::setFrameCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Set the number of frames that this level covers.
+  ///\param   [in] count: Number of frames.
+  ///\remarks Needed by reduce() for levels that were not filled by adds.
+  //////////////////////////////////////////////////////////////////////////////
+  void setFrameCount(qint64 count)
+  {
+    m_offset     = 0;
+    m_frameCount = count;
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   // MipmapLevel::divisionFactor()
   //////////////////////////////////////////////////////////////////////////////
@@ -155,7 +237,7 @@ class MipmapLevel
   ///\return  The current number of samples.
   ///\remarks This value represents the number of samples in this mipmap.
   //////////////////////////////////////////////////////////////////////////////
-  int sampleCount() const
+  qint64 sampleCount() const
   {
     // Return current sample count:
     return m_numSamples;
@@ -170,7 +252,7 @@ class MipmapLevel
   ///         Setting this value will not allocate any samples. You'll have to
   ///         use createSamples() above to create the actual buffers.
   //////////////////////////////////////////////////////////////////////////////
-  void setSampleCount(const int newCount)
+  void setSampleCount(const qint64 newCount)
   {
     // Parameter check:
     if (newCount <= 0)
@@ -238,51 +320,322 @@ class MipmapLevel
     return m_samples;
   }
 
-  void addSamples(int count, SampleBuffer& buffer)
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::attachSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Use an external buffer instead of creating one.
+  ///\param   [in] data: ChannelCount * SampleCount values, sorted by channel.
+  ///\return  Returns true if successful or false on failure.
+  ///\remarks The buffer must live as long as this level (eg. a mapped peak
+  ///         cache file). It's never freed here.
+  //////////////////////////////////////////////////////////////////////////////
+  bool attachSamples(PeakSample* data)
+  {
+    // Environment check:
+    if (m_numChannels <= 0 || m_numSamples <= 0 || data == 0)
+      return false;
+
+    // Free old buffers (if any):
+    if (m_data != 0 && !m_external)
+      delete [] m_data;
+    if (m_samples != 0)
+      delete [] m_samples;
+
+    // Take the buffer:
+    m_data     = data;
+    m_external = true;
+
+    // Set channel pointers into the buffer:
+    m_samples = new PeakChannel[m_numChannels];
+    for (int i = 0; i < m_numChannels; i++)
+      m_samples[i] = m_data + i * m_numSamples;
+
+    // The level is complete:
+    m_cursor = 0;
+    m_block  = m_numSamples - 1;
+
+    // Return success:
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::data()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the raw peak buffer.
+  ///\return  ChannelCount * SampleCount values, sorted by channel.
+  //////////////////////////////////////////////////////////////////////////////
+  const PeakSample* data() const
+  {
+    // Return buffer:
+    return m_data;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::addSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Add the samples of a sample buffer.
+  ///\param   [in] count:  Number of frames.
+  ///\param   [in] buffer: The samples, one buffer per channel.
+  ///\remarks Every peak value window is searched at once (see findPeaks()).
+  //////////////////////////////////////////////////////////////////////////////
+  void addSamples(int count, const FloatSampleBuffer& buffer)
   {
-    for (int i = 0; i < count; i++)
+    int i = 0;
+    while (i < count)
     {
+      // Frames left for the current peak value:
+      const int run = qMin(count - i, m_divisionFactor - m_cursor);
       for (int j = 0; j < m_numChannels; j++)
       {
-        float sample = static_cast<float>(buffer.sample(j, i));
+        float minVal = 0.0f;
+        float maxVal = 0.0f;
+        float squares = 0.0f;
+        findPeaks(buffer.sampleBuffer(j) + i, 1, run, &minVal, &maxVal, &squares);
+        mergeValue(j, minVal, maxVal, squares, run);
+      }
+
+      // Advance cursor:
+      advance(run);
+      i += run;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::addFrames()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Add interleaved frames in their native format.
+  ///\param   [in] count:  Number of frames.
+  ///\param   [in] frames: The interleaved frames.
+  ///\param   [in] scale:  Factor to normalize a sample to -1..1.
+  ///\remarks The peak search runs on the native samples (see findPeaks()) and
+  ///         only the result of each window is converted.
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  void addFrames(int count, const T* frames, float scale)
+  {
+    QVarLengthArray<T, 32> lo(m_numChannels);
+    QVarLengthArray<T, 32> hi(m_numChannels);
+    QVarLengthArray<float, 32> squares(m_numChannels);
+    int i = 0;
+    while (i < count)
+    {
+      // Find the extremes and energy of the current peak value's frames:
+      const int run = qMin(count - i, m_divisionFactor - m_cursor);
+      findPeaks(frames + i * m_numChannels, m_numChannels, run, lo.data(), hi.data(), squares.data());
+      for (int j = 0; j < m_numChannels; j++)
+        mergeValue(j, lo[j] * scale, hi[j] * scale, squares[j] * scale * scale, run);
+
+      // Advance cursor:
+      advance(run);
+      i += run;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::reduce()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Build this level from the next finer one.
+  ///\param   [in] finer: The finer level, its division factor must divide ours.
+  ///\param   [in] skip:  Values of the finer level that belong to our first
+  ///                     value but are not part of finer (see seek()).
+  ///\remarks Each value is the min of the mins and the max of the maxes of
+  ///         the finer values that it covers, the RMS values are weighted by
+  ///         their number of frames. So only the finest level of a pyramid
+  ///         ever has to look at the actual samples.
+  //////////////////////////////////////////////////////////////////////////////
+  void reduce(const MipmapLevel& finer, int skip = 0)
+  {
+    // Environment check:
+    if (m_samples == 0 || finer.m_samples == 0 || finer.m_divisionFactor <= 0)
+      return;
+    const int ratio = m_divisionFactor / finer.m_divisionFactor;
+    if (ratio <= 0)
+      return;
+
+    // Frame range of the finer level:
+    const qint64 first = finer.m_offset;
+    const qint64 last = finer.m_offset + finer.m_frameCount;
 
-        // Init on first round:
-        if (m_cursor == 0)
+    for (int j = 0; j < m_numChannels; j++)
+    {
+      const PeakSample* source = finer.m_samples[j];
+      PeakSample* target = m_samples[j];
+      qint64 block = 0;
+      int cursor = skip;
+      double energy = 0.0;
+      qint64 frames = 0;
+      for (qint64 i = 0; i < finer.m_numSamples && block < m_numSamples; i++)
+      {
+        // Merge into the peak value (the first one is always set):
+        if (i == 0 || cursor == 0)
+        {
+          target[block] = source[i];
+          energy = 0.0;
+          frames = 0;
+        }
+        else
         {
-          m_samples[j][m_block].minVal = sample;
-          m_samples[j][m_block].maxVal = sample;
+          if (source[i].minVal < target[block].minVal)
+            target[block].minVal = source[i].minVal;
+          if (source[i].maxVal > target[block].maxVal)
+            target[block].maxVal = source[i].maxVal;
         }
 
-        // Update value:
-        if (sample < m_samples[j][m_block].minVal)
-          m_samples[j][m_block].minVal = sample;
-        if (sample > m_samples[j][m_block].maxVal)
-          m_samples[j][m_block].maxVal = sample;
+        // Weight the RMS by the frames that the finer value covers:
+        const qint64 count = qMin((i + 1) * finer.m_divisionFactor, last) - qMax(i * finer.m_divisionFactor, first);
+        if (count > 0)
+        {
+          const double rms = peakValue(source[i].rmsVal);
+          energy += rms * rms * count;
+          frames += count;
+          target[block].rmsVal = quantizePeak(static_cast<float>(sqrt(energy / frames)));
+        }
+
+        // Advance cursor:
+        cursor++;
+        if (cursor >= ratio)
+        {
+          block++;
+          cursor = 0;
+        }
       }
+    }
+    m_frameCount = finer.m_frameCount;
+  }
 
-      // Advance cursor:
-      m_cursor++;
-      if (m_cursor >= m_divisionFactor)
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::reduceRange()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Rebuild the values of this level that cover a range of frames.
+  ///\param   [in] finer: The finer level, its division factor must divide ours.
+  ///\param   [in] start: First frame of the range.
+  ///\param   [in] end:   Frame after the range.
+  ///\remarks Both levels must start at the first frame and know their frame
+  ///         count (see setFrameCount()). Only the touched values are built
+  ///         again, so a few changed finer values don't cost a full reduce().
+  //////////////////////////////////////////////////////////////////////////////
+  void reduceRange(const MipmapLevel& finer, qint64 start, qint64 end)
+  {
+    // Environment check:
+    if (m_samples == 0 || finer.m_samples == 0 || finer.m_divisionFactor <= 0 || end <= start)
+      return;
+    const int ratio = m_divisionFactor / finer.m_divisionFactor;
+    if (ratio <= 0)
+      return;
+
+    // Values that cover the range:
+    const qint64 first = start / m_divisionFactor;
+    const qint64 last = qMin((end - 1) / m_divisionFactor + 1, m_numSamples);
+    for (int j = 0; j < m_numChannels; j++)
+    {
+      const PeakSample* source = finer.m_samples[j];
+      PeakSample* target = m_samples[j];
+      for (qint64 block = first; block < last; block++)
       {
-        m_block++;
-        if (m_block >= m_numSamples)
-          m_block = m_numSamples - 1;
-        m_cursor = 0;
+        // Merge the finer values of the value (the first one is always set):
+        const qint64 begin = block * ratio;
+        const qint64 stop = qMin(begin + ratio, finer.m_numSamples);
+        double energy = 0.0;
+        qint64 frames = 0;
+        for (qint64 i = begin; i < stop; i++)
+        {
+          if (i == begin)
+            target[block] = source[i];
+          else
+          {
+            if (source[i].minVal < target[block].minVal)
+              target[block].minVal = source[i].minVal;
+            if (source[i].maxVal > target[block].maxVal)
+              target[block].maxVal = source[i].maxVal;
+          }
+
+          // Weight the RMS by the frames that the finer value covers:
+          const qint64 count = qMin((i + 1) * finer.m_divisionFactor, finer.m_frameCount) - i * finer.m_divisionFactor;
+          if (count > 0)
+          {
+            const double rms = peakValue(source[i].rmsVal);
+            energy += rms * rms * count;
+            frames += count;
+            target[block].rmsVal = quantizePeak(static_cast<float>(sqrt(energy / frames)));
+          }
+        }
       }
     }
   }
 
 private:
 
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::mergeValue()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Merge some samples into the current peak value.
+  ///\param   [in] channel: The channel of the samples.
+  ///\param   [in] minVal:  Minimum of the samples.
+  ///\param   [in] maxVal:  Maximum of the samples.
+  ///\param   [in] squares: Sum of the squared samples.
+  ///\param   [in] count:   Number of samples.
+  //////////////////////////////////////////////////////////////////////////////
+  void mergeValue(int channel, float minVal, float maxVal, float squares, int count)
+  {
+    // Init on first round:
+    PeakSample& value = m_samples[channel][m_block];
+    const qint16 lo = quantizePeak(minVal);
+    const qint16 hi = quantizePeak(maxVal);
+    if (m_valueFrames == 0)
+    {
+      value.minVal = lo;
+      value.maxVal = hi;
+      m_squares[channel] = squares;
+    }
+    else
+    {
+      if (lo < value.minVal)
+        value.minVal = lo;
+      if (hi > value.maxVal)
+        value.maxVal = hi;
+      m_squares[channel] += squares;
+    }
+
+    // Update the RMS of all samples so far:
+    value.rmsVal = quantizePeak(static_cast<float>(sqrt(m_squares[channel] / (m_valueFrames + count))));
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // MipmapLevel::advance()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move the write cursor after adding samples.
+  ///\param   [in] count: Number of frames added, never beyond the current
+  ///                     peak value.
+  //////////////////////////////////////////////////////////////////////////////
+  void advance(int count)
+  {
+    m_frameCount  += count;
+    m_valueFrames += count;
+    m_cursor      += count;
+    if (m_cursor >= m_divisionFactor)
+    {
+      m_block++;
+      if (m_block >= m_numSamples)
+        m_block = m_numSamples - 1;
+      m_cursor      = 0;
+      m_valueFrames = 0;
+    }
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   // Member:
   int          m_cursor;
-  int          m_block;
+  qint64       m_block;
   int          m_divisionFactor; ///> Samples represented by each peak value.
-  int          m_numSamples;     ///> Number of samples in the buffer.
+  qint64       m_numSamples;     ///> Number of samples in the buffer.
   int          m_numChannels;    ///> Number of channels.
   PeakSample*  m_data;           ///> The raw sample data.
   PeakChannel* m_samples;        ///> Data sorted by channel.
+  bool         m_external;       ///> Is m_data owned by someone else?
+  int          m_valueFrames;    ///> Frames added to the current value.
+  int          m_offset;         ///> Frames of the first value before this level.
+  qint64       m_frameCount;     ///> Frames added so far.
+  float*       m_squares;        ///> Sum of squares of the current value.
 };
 
 class PeakData
@@ -294,17 +647,20 @@ class PeakData
     m_numSamples(0),
     m_sampleRate(0),
     m_numMipmaps(0),
-    m_mipmaps(0)
+    m_mipmaps(0),
+    m_storage(0)
   {
     // Nothing to do here.
   }
 
   virtual ~PeakData()
   {
-    // Free peaks:
+    // Free peaks (before the file that they may live in):
     if (m_mipmaps != 0)
       delete [] m_mipmaps;
     m_mipmaps = 0;
+    delete m_storage;
+    m_storage = 0;
 
     // Reset members:
     m_numChannels = 0;
@@ -349,51 +705,87 @@ class PeakData
     return m_numMipmaps;
   }
 
-  void allocateMipMaps(int numMipMaps, int numChannels, double sampleRate, int sampleCount)
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakData::clear()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Free all levels.
+  //////////////////////////////////////////////////////////////////////////////
+  void clear()
   {
-    // Free peaks:
+    // Free peaks (before the file that they may live in):
     if (m_mipmaps != 0)
       delete [] m_mipmaps;
     m_mipmaps = 0;
+    delete m_storage;
+    m_storage = 0;
 
     // Reset members:
     m_numChannels = 0;
     m_numSamples  = 0;
     m_sampleRate  = 0;
     m_numMipmaps  = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakData::swap()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Exchange the levels with another peak data object.
+  ///\param   [in,out] other: The other object.
+  ///\remarks Nothing is copied, so this is cheap enough to be done under a
+  ///         lock.
+  //////////////////////////////////////////////////////////////////////////////
+  void swap(PeakData& other)
+  {
+    qSwap(m_numChannels, other.m_numChannels);
+    qSwap(m_numSamples,  other.m_numSamples);
+    qSwap(m_sampleRate,  other.m_sampleRate);
+    qSwap(m_numMipmaps,  other.m_numMipmaps);
+    qSwap(m_mipmaps,     other.m_mipmaps);
+    qSwap(m_storage,     other.m_storage);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakData::allocateMipMaps()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Create an empty mipmap pyramid.
+  ///\param   [in] numChannels: Number of channels of the source file.
+  ///\param   [in] sampleRate:  Samplerate of the source file.
+  ///\param   [in] sampleCount: Number of sample frames of the source file.
+  ///\param   [in] baseFactor:  Division factor of the finest level.
+  ///\param   [in] ratio:       Division factor of a level / the finer one.
+  ///\remarks Levels are added until the coarsest one has only a few hundred
+  ///         values left. Every level can be built from the next finer one
+  ///         (see MipmapLevel::reduce()).
+  //////////////////////////////////////////////////////////////////////////////
+  void allocateMipMaps(int numChannels, double sampleRate, qint64 sampleCount, int baseFactor, int ratio)
+  {
+    // Free peaks:
+    clear();
+
+    // Parameter check:
+    if (numChannels <= 0 || sampleCount <= 0 || baseFactor <= 0 || ratio < 2)
+      return;
+
+    // Count the levels, the factors must fit an int:
+    int numMipMaps = 1;
+    qint64 factor = baseFactor;
+    while (sampleCount / factor > 512 && factor * ratio <= 0x40000000)
+    {
+      factor *= ratio;
+      numMipMaps++;
+    }
 
     // Allocate mipmaps:
     m_mipmaps = new MipmapLevel[numMipMaps];
+    factor = baseFactor;
     for (int i = 0; i < numMipMaps; i++)
     {
-      // Get division factor:
-      int factor = 0;
-      switch (i)
-      {
-      case 0:
-        factor = static_cast<int>(sampleRate / 300);
-        break;
-      case 1:
-        factor = static_cast<int>(sampleRate / 20);
-        break;
-      case 2:
-        factor = static_cast<int>(sampleRate);
-        break;
-      default:
-        factor = static_cast<int>(sampleRate * i * 20);
-        break;
-      }
-
-      // Get sample count:
-      int count = sampleCount / factor;
-      if (count < (sampleCount * factor))
-        count++;
-
       // Update mipmap:
       m_mipmaps[i].setChannelCount(numChannels);
-      m_mipmaps[i].setDivisionFactor(factor);
-      m_mipmaps[i].setSampleCount(count);
+      m_mipmaps[i].setDivisionFactor(static_cast<int>(factor));
+      m_mipmaps[i].setSampleCount((sampleCount + factor - 1) / factor);
       m_mipmaps[i].createSamples();
+      factor *= ratio;
     }
 
     // Update members:
@@ -403,6 +795,35 @@ class PeakData
     m_sampleRate  = sampleRate;
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakData::attachMipMaps()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Use complete mipmaps that were built elsewhere.
+  ///\param   [in] mipmaps:     The levels, allocated with new [].
+  ///\param   [in] numMipMaps:  Number of levels.
+  ///\param   [in] numChannels: Number of channels of the source file.
+  ///\param   [in] sampleRate:  Samplerate of the source file.
+  ///\param   [in] sampleCount: Number of sample frames of the source file.
+  ///\param   [in] storage:     The mapped file that holds the peaks (or 0).
+  ///\remarks This object takes over the levels and the file.
+  //////////////////////////////////////////////////////////////////////////////
+  void attachMipMaps(MipmapLevel* mipmaps, int numMipMaps, int numChannels, double sampleRate, qint64 sampleCount, QFile* storage)
+  {
+    // Free peaks:
+    if (m_mipmaps != 0)
+      delete [] m_mipmaps;
+    m_mipmaps = 0;
+    delete m_storage;
+
+    // Take the new ones:
+    m_mipmaps     = mipmaps;
+    m_storage     = storage;
+    m_numMipmaps  = numMipMaps;
+    m_numChannels = numChannels;
+    m_numSamples  = sampleCount;
+    m_sampleRate  = sampleRate;
+  }
+
 private:
   //////////////////////////////////////////////////////////////////////////////
   // Member:
@@ -411,6 +832,7 @@ private:
   double       m_sampleRate;  ///> Samplerate of the source file.
   int          m_numMipmaps;  ///> Number of mipmaps.
   MipmapLevel* m_mipmaps;     ///> Actual peak data as mipmaps.
+  QFile*       m_storage;     ///> Mapped cache file of the peaks (if any).
 };
 
 #endif // PEAKDATA_H
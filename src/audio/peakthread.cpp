@@ -50,4 +50,29 @@ void PeakThread::run()
   m_doc->updatePeakData();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// PeakWorker::PeakWorker()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] doc:   The document that we are working on.
+///\param   [in] index: Number of this worker (selects its reader).
+////////////////////////////////////////////////////////////////////////////////
+PeakWorker::PeakWorker(class Document* doc, int index) :
+  m_doc(doc),
+  m_index(index)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PeakWorker::run()
+////////////////////////////////////////////////////////////////////////////////
+///\brief The actual thread function.
+////////////////////////////////////////////////////////////////////////////////
+void PeakWorker::run()
+{
+  // Scan chunks until there are no more:
+  m_doc->scanPeakChunks(m_index);
+}
+
 ///////////////////////////////// End of File //////////////////////////////////
@@ -63,5 +63,43 @@ private:
   class Document* m_doc; ///> The document that we are working on.
 };
 
+////////////////////////////////////////////////////////////////////////////////
+///\class   PeakWorker peakthread.h
+///\brief   Helper thread class to scan chunks of a document for peaks.
+///\remarks The peak thread starts several of these, they take the chunks one
+///         by one until the whole document is scanned.
+////////////////////////////////////////////////////////////////////////////////
+class PeakWorker : public QThread
+{
+  Q_OBJECT // Qt magic...
+
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakWorker::PeakWorker()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] doc:   The document that we are working on.
+  ///\param   [in] index: Number of this worker (selects its reader).
+  //////////////////////////////////////////////////////////////////////////////
+  PeakWorker(class Document* doc, int index);
+
+protected:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PeakWorker::run()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief The actual thread function.
+  //////////////////////////////////////////////////////////////////////////////
+  void run();
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  class Document* m_doc;   ///> The document that we are working on.
+  int             m_index; ///> Number of this worker.
+};
+
 #endif // #ifndef __PEAKTHREAD_H_INCLUDED__
 ///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,352 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    playbackstream.cpp
+///\ingroup bruo
+///\brief   Playback disk streaming class implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "playbackstream.h"
+#include "document.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::PlaybackStream()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] doc: The document that we are streaming.
+////////////////////////////////////////////////////////////////////////////////
+PlaybackStream::PlaybackStream(class Document* doc) :
+  m_doc(doc),
+  m_ringMask(0),
+  m_writeIndex(0),
+  m_readIndex(0),
+  m_seekSerial(0),
+  m_seekAck(0),
+  m_invalid(0),
+  m_stop(0),
+  m_seekPosition(0),
+  m_readPosition(0),
+  m_streamPosition(0),
+  m_seeking(false),
+  m_underruns(0),
+  m_missingFrames(0),
+  m_seeks(0)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::~PlaybackStream()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Stops the thread.
+////////////////////////////////////////////////////////////////////////////////
+PlaybackStream::~PlaybackStream()
+{
+  stopStreaming();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::startStreaming()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Allocate the ring buffer and start the reader thread.
+///\param   [in] numChannels: Number of channels of the document.
+///\param   [in] sampleRate:  Sample rate of the document.
+///\param   [in] seconds:     How far to read ahead of the play cursor.
+///\remarks Must not be called while the audio callback uses this stream.
+////////////////////////////////////////////////////////////////////////////////
+void PlaybackStream::startStreaming(int numChannels, double sampleRate, double seconds)
+{
+  // Stop previous run:
+  stopStreaming();
+
+  // Ring size is the next power of two:
+  int ringSize = 4096;
+  while (ringSize < sampleRate * seconds)
+    ringSize *= 2;
+  m_ring.createBuffers(numChannels, ringSize);
+  m_chunk.createBuffers(numChannels, 4096);
+  m_ringMask = ringSize - 1;
+
+  // Reset state, the first read will issue a seek:
+  m_writeIndex.storeRelease(0);
+  m_readIndex.storeRelease(0);
+  m_seekSerial.storeRelease(0);
+  m_seekAck.storeRelease(0);
+  m_invalid.storeRelease(1);
+  m_stop.storeRelease(0);
+  m_seekPosition.storeRelease(0);
+  m_readPosition   = 0;
+  m_streamPosition = 0;
+  m_seeking        = false;
+
+  // Start reading:
+  start(QThread::HighPriority);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::stopStreaming()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Stop the reader thread and free the ring buffer.
+///\remarks Must not be called while the audio callback uses this stream.
+////////////////////////////////////////////////////////////////////////////////
+void PlaybackStream::stopStreaming()
+{
+  // Stop the thread:
+  m_stop.storeRelease(1);
+  wait();
+
+  // Free buffers:
+  m_ring.createBuffers(0, 0);
+  m_chunk.createBuffers(0, 0);
+  m_ringMask = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::read()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Get the next frames for playback, called by the audio thread.
+///\param   [in,out] position:   The play position, advanced by the frames
+///                              read (and wrapped around if looping).
+///\param   [out]    buffer:     The target buffer.
+///\param   [in]     frameCount: Number of frames to read.
+///\return  The number of frames read, the rest of the buffer is silence.
+///\remarks Never blocks. If the position is not where the last call ended a
+///         seek is requested and silence is returned until the thread has
+///         caught up.
+////////////////////////////////////////////////////////////////////////////////
+int PlaybackStream::read(qint64& position, SampleBuffer& buffer, int frameCount)
+{
+  // Sanity check:
+  buffer.makeSilence();
+  if (m_ring.channelCount() == 0 || frameCount <= 0)
+    return 0;
+
+  // Cursor moved by someone else or data stale? Then request a seek:
+  const bool stale = m_invalid.fetchAndStoreAcquire(0) != 0;
+  if (stale || position != m_readPosition)
+  {
+    m_seekPosition.storeRelease(position);
+    m_readPosition = position;
+    m_seekSerial.fetchAndAddRelease(1);
+    m_seeks.fetchAndAddRelaxed(1);
+    m_seeking = true;
+  }
+
+  // Wait until the thread has handled the seek:
+  if (m_seekAck.loadAcquire() != m_seekSerial.load())
+    return 0;
+
+  // How many frames do we need?
+  const qint64 length  = m_doc->sampleCount();
+  const bool   looping = m_doc->looping();
+  int wanted = frameCount;
+  if (!looping)
+    wanted = static_cast<int>(qBound(qint64(0), length - position, qint64(frameCount)));
+
+  // How many do we have?
+  const int readIndex = m_readIndex.load();
+  const int available = static_cast<int>(static_cast<unsigned int>(m_writeIndex.loadAcquire()) - static_cast<unsigned int>(readIndex));
+  const int numFrames = qMin(wanted, available);
+
+  // Copy out of the ring (in up to two parts):
+  const int start = readIndex & m_ringMask;
+  const int first = qMin(numFrames, m_ringMask + 1 - start);
+  const int numChannels = qMin(buffer.channelCount(), m_ring.channelCount());
+  for (int i = 0; i < numChannels; i++)
+  {
+    const double* src = m_ring.sampleBuffer(i);
+    double* dst = buffer.sampleBuffer(i);
+    memcpy(dst, src + start, first * sizeof(double));
+    memcpy(dst + first, src, (numFrames - first) * sizeof(double));
+  }
+  m_readIndex.storeRelease(static_cast<int>(static_cast<unsigned int>(readIndex) + numFrames));
+
+  // Count underruns (but not while the thread is still busy with a seek):
+  if (numFrames > 0)
+    m_seeking = false;
+  if (numFrames < wanted && !m_seeking)
+  {
+    m_underruns.fetchAndAddRelaxed(1);
+    m_missingFrames.fetchAndAddRelaxed(wanted - numFrames);
+  }
+
+  // Advance position:
+  position += numFrames;
+  if (looping && length > 0 && position >= length)
+    position %= length;
+  m_readPosition = position;
+
+  // Return number of frames:
+  return numFrames;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::invalidate()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Drop the buffered frames and read them again.
+///\remarks Call this when the document was modified.
+////////////////////////////////////////////////////////////////////////////////
+void PlaybackStream::invalidate()
+{
+  m_invalid.storeRelease(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::underrunCount()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Number of audio callbacks that didn't get all their frames.
+///\return  The underrun count.
+////////////////////////////////////////////////////////////////////////////////
+int PlaybackStream::underrunCount() const
+{
+  return m_underruns.load();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::underrunFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Number of frames that were replaced by silence in underruns.
+///\return  The number of missing frames.
+////////////////////////////////////////////////////////////////////////////////
+int PlaybackStream::underrunFrames() const
+{
+  return m_missingFrames.load();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::seekCount()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Number of seeks (cursor jumps, loops don't count).
+///\return  The seek count.
+////////////////////////////////////////////////////////////////////////////////
+int PlaybackStream::seekCount() const
+{
+  return m_seeks.load();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::bufferedFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Number of frames currently waiting in the ring buffer.
+///\return  The fill level of the ring.
+////////////////////////////////////////////////////////////////////////////////
+int PlaybackStream::bufferedFrames() const
+{
+  return static_cast<int>(static_cast<unsigned int>(m_writeIndex.load()) - static_cast<unsigned int>(m_readIndex.load()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::resetStatistics()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Reset the underrun and seek counters.
+////////////////////////////////////////////////////////////////////////////////
+void PlaybackStream::resetStatistics()
+{
+  m_underruns.store(0);
+  m_missingFrames.store(0);
+  m_seeks.store(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::run()
+////////////////////////////////////////////////////////////////////////////////
+///\brief The actual thread function.
+////////////////////////////////////////////////////////////////////////////////
+void PlaybackStream::run()
+{
+  while (m_stop.loadAcquire() == 0)
+  {
+    // Follow the consumer:
+    handleSeek();
+
+    // Read ahead, sleep if the ring is full or the end was reached:
+    if (fillRing() == 0)
+      msleep(5);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::handleSeek()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Handle a pending seek request of the consumer (thread side).
+////////////////////////////////////////////////////////////////////////////////
+void PlaybackStream::handleSeek()
+{
+  // Anything to do?
+  const int serial = m_seekSerial.loadAcquire();
+  if (serial == m_seekAck.load())
+    return;
+
+  // Drop everything buffered, the consumer doesn't touch the ring until the
+  // request is acknowledged (a newer request may have moved the target
+  // already, it's handled again on the next round):
+  m_streamPosition = m_seekPosition.loadAcquire();
+  m_writeIndex.storeRelease(m_readIndex.loadAcquire());
+  m_seekAck.storeRelease(serial);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlaybackStream::fillRing()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read the next chunk of the document into the ring (thread side).
+///\return  The number of frames added, zero if there was nothing to do.
+////////////////////////////////////////////////////////////////////////////////
+int PlaybackStream::fillRing()
+{
+  // Wrap around at the end when looping:
+  const qint64 length = m_doc->sampleCount();
+  if (m_streamPosition >= length && m_doc->looping())
+    m_streamPosition = 0;
+
+  // Only read full chunks unless we are at the end of the file:
+  const int writeIndex = m_writeIndex.load();
+  const int free = m_ringMask + 1 - static_cast<int>(static_cast<unsigned int>(writeIndex) - static_cast<unsigned int>(m_readIndex.loadAcquire()));
+  const qint64 left = length - m_streamPosition;
+  int numFrames = static_cast<int>(qMin(qint64(m_chunk.sampleCount()), left));
+  if (numFrames <= 0 || free < numFrames)
+    return 0;
+
+  // Read the next chunk:
+  numFrames = static_cast<int>(m_doc->readSamples(m_streamPosition, m_chunk, numFrames, AudioSnippet::PlaybackReader));
+  if (numFrames <= 0)
+    return 0;
+
+  // Copy into the ring (in up to two parts):
+  const int start = writeIndex & m_ringMask;
+  const int first = qMin(numFrames, m_ringMask + 1 - start);
+  for (int i = 0; i < m_ring.channelCount(); i++)
+  {
+    const double* src = m_chunk.sampleBuffer(i);
+    double* dst = m_ring.sampleBuffer(i);
+    memcpy(dst + start, src, first * sizeof(double));
+    memcpy(dst, src + first, (numFrames - first) * sizeof(double));
+  }
+
+  // Publish the frames:
+  m_writeIndex.storeRelease(static_cast<int>(static_cast<unsigned int>(writeIndex) + numFrames));
+  m_streamPosition += numFrames;
+
+  // Return number of frames:
+  return numFrames;
+}
+
+///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    playbackstream.h
+///\ingroup bruo
+///\brief   Playback disk streaming class definition.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __PLAYBACKSTREAM_H_INCLUDED__
+#define __PLAYBACKSTREAM_H_INCLUDED__
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include "samplebuffer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   PlaybackStream playbackstream.h
+///\brief   Reads the document ahead of the play cursor for the audio thread.
+///\remarks A background thread keeps a ring buffer filled from the document
+///         and the audio callback only copies the frames out of it, so disk
+///         access never happens in the callback. The ring is single producer
+///         (this thread) and single consumer (the audio callback) and needs
+///         no locks. Cursor jumps are detected by the consumer and handed to
+///         the thread as seek requests.
+////////////////////////////////////////////////////////////////////////////////
+class PlaybackStream : public QThread
+{
+  Q_OBJECT // Qt magic...
+
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::PlaybackStream()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] doc: The document that we are streaming.
+  //////////////////////////////////////////////////////////////////////////////
+  PlaybackStream(class Document* doc);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::~PlaybackStream()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Stops the thread.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~PlaybackStream();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::startStreaming()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Allocate the ring buffer and start the reader thread.
+  ///\param   [in] numChannels: Number of channels of the document.
+  ///\param   [in] sampleRate:  Sample rate of the document.
+  ///\param   [in] seconds:     How far to read ahead of the play cursor.
+  ///\remarks Must not be called while the audio callback uses this stream.
+  //////////////////////////////////////////////////////////////////////////////
+  void startStreaming(int numChannels, double sampleRate, double seconds = 0.5);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::stopStreaming()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Stop the reader thread and free the ring buffer.
+  ///\remarks Must not be called while the audio callback uses this stream.
+  //////////////////////////////////////////////////////////////////////////////
+  void stopStreaming();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::read()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Get the next frames for playback, called by the audio thread.
+  ///\param   [in,out] position:   The play position, advanced by the frames
+  ///                              read (and wrapped around if looping).
+  ///\param   [out]    buffer:     The target buffer.
+  ///\param   [in]     frameCount: Number of frames to read.
+  ///\return  The number of frames read, the rest of the buffer is silence.
+  ///\remarks Never blocks. If the position is not where the last call ended a
+  ///         seek is requested and silence is returned until the thread has
+  ///         caught up.
+  //////////////////////////////////////////////////////////////////////////////
+  int read(qint64& position, SampleBuffer& buffer, int frameCount);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::invalidate()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Drop the buffered frames and read them again.
+  ///\remarks Call this when the document was modified.
+  //////////////////////////////////////////////////////////////////////////////
+  void invalidate();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::underrunCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Number of audio callbacks that didn't get all their frames.
+  ///\return  The underrun count.
+  //////////////////////////////////////////////////////////////////////////////
+  int underrunCount() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::underrunFrames()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Number of frames that were replaced by silence in underruns.
+  ///\return  The number of missing frames.
+  //////////////////////////////////////////////////////////////////////////////
+  int underrunFrames() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::seekCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Number of seeks (cursor jumps, loops don't count).
+  ///\return  The seek count.
+  //////////////////////////////////////////////////////////////////////////////
+  int seekCount() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::bufferedFrames()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Number of frames currently waiting in the ring buffer.
+  ///\return  The fill level of the ring.
+  //////////////////////////////////////////////////////////////////////////////
+  int bufferedFrames() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::resetStatistics()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Reset the underrun and seek counters.
+  //////////////////////////////////////////////////////////////////////////////
+  void resetStatistics();
+
+protected:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::run()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief The actual thread function.
+  //////////////////////////////////////////////////////////////////////////////
+  void run();
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::handleSeek()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Handle a pending seek request of the consumer (thread side).
+  //////////////////////////////////////////////////////////////////////////////
+  void handleSeek();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // PlaybackStream::fillRing()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read the next chunk of the document into the ring (thread side).
+  ///\return  The number of frames added, zero if there was nothing to do.
+  //////////////////////////////////////////////////////////////////////////////
+  int fillRing();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  class Document* m_doc;            ///> The document that we are streaming.
+  SampleBuffer    m_ring;           ///> The ring buffer.
+  SampleBuffer    m_chunk;          ///> Read buffer of the thread.
+  int             m_ringMask;       ///> Ring size - 1 (size is a power of 2).
+  QAtomicInt      m_writeIndex;     ///> Frames written (producer owned).
+  QAtomicInt      m_readIndex;      ///> Frames read (consumer owned).
+  QAtomicInt      m_seekSerial;     ///> Seek requests (consumer owned).
+  QAtomicInt      m_seekAck;        ///> Handled seek requests (producer owned).
+  QAtomicInt      m_invalid;        ///> Buffered frames are stale.
+  QAtomicInt      m_stop;           ///> Stop the thread.
+  QAtomicInteger<qint64> m_seekPosition; ///> Target of the last seek request.
+  qint64          m_readPosition;   ///> Consumer position after the last read.
+  qint64          m_streamPosition; ///> Producer position in the document.
+  bool            m_seeking;        ///> Waiting for the first frames of a seek.
+  QAtomicInt      m_underruns;      ///> Number of underruns.
+  QAtomicInt      m_missingFrames;  ///> Number of frames lost to underruns.
+  QAtomicInt      m_seeks;          ///> Number of seeks.
+};
+
+#endif // #ifndef __PLAYBACKSTREAM_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
@@ -28,49 +28,83 @@
 #include "samplebuffer.h"
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::SampleBuffer()
+// Alignment of the channel buffers in bytes (one cache line, wide enough for
+// AVX-512 loads):
+static const size_t s_alignment = 64;
+
+////////////////////////////////////////////////////////////////////////////////
+// SampleBufferT::SampleBufferT()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Default constructor of this class.
 ///\remarks Basically only initializes the buffer.
 ////////////////////////////////////////////////////////////////////////////////
-SampleBuffer::SampleBuffer() :
+template <typename T>
+SampleBufferT<T>::SampleBufferT() :
   m_channelCount(0),
   m_sampleCount(0),
+  m_channelCapacity(0),
+  m_stride(0),
   m_sampleBuffer(0)
 {
   // Nothing to do here.
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::SampleBuffer()
+// SampleBufferT::SampleBufferT()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Copy constructor of this class.
 ///\brief   [in] other: The buffer to copy.
 ///\remarks Copies the entire buffer.
 ////////////////////////////////////////////////////////////////////////////////
-SampleBuffer::SampleBuffer(const SampleBuffer& other) :
+template <typename T>
+SampleBufferT<T>::SampleBufferT(const SampleBufferT& other) :
   m_channelCount(0),
   m_sampleCount(0),
+  m_channelCapacity(0),
+  m_stride(0),
   m_sampleBuffer(0)
 {
-  // Create a matching buffer:
-  createBuffers(other.m_channelCount, other.m_sampleCount);
+  // Use the assignment operator:
+  *this = other;
+}
 
-  // Copy data:
-  memcpy(m_sampleBuffer, other.m_sampleBuffer, m_channelCount * m_sampleCount * sizeof(double));
+////////////////////////////////////////////////////////////////////////////////
+// SampleBufferT::SampleBufferT()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move constructor of this class.
+///\brief   [in] other: The buffer to take the storage from.
+///\remarks The other buffer is left empty. Nothing is copied or allocated.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+SampleBufferT<T>::SampleBufferT(SampleBufferT&& other) :
+  m_channelCount(other.m_channelCount),
+  m_sampleCount(other.m_sampleCount),
+  m_channelCapacity(other.m_channelCapacity),
+  m_stride(other.m_stride),
+  m_sampleBuffer(other.m_sampleBuffer)
+{
+  // Leave the other buffer empty:
+  other.m_channelCount    = 0;
+  other.m_sampleCount     = 0;
+  other.m_channelCapacity = 0;
+  other.m_stride          = 0;
+  other.m_sampleBuffer    = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::SampleBuffer()
+// SampleBufferT::SampleBufferT()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Initialization constructor of this class.
 ///\brief   [in] numChannels: Number of channels of this buffer.
 ///\param   [in] numSamples:  Number of samples for a single channel.
 ///\remarks The buffer is zeroed.
 ////////////////////////////////////////////////////////////////////////////////
-SampleBuffer::SampleBuffer(int numChannels, int numSamples) :
+template <typename T>
+SampleBufferT<T>::SampleBufferT(int numChannels, int numSamples) :
   m_channelCount(0),
   m_sampleCount(0),
+  m_channelCapacity(0),
+  m_stride(0),
   m_sampleBuffer(0)
 {
   // Just create a matching buffer:
@@ -78,92 +112,110 @@ SampleBuffer::SampleBuffer(int numChannels, int numSamples) :
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::~SampleBuffer()
+// SampleBufferT::~SampleBufferT()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Default destructor of this class.
 ///\remarks Frees all used resources. This is not virtual because this class
 ///         is not ment to be subclassed.
 ////////////////////////////////////////////////////////////////////////////////
-SampleBuffer::~SampleBuffer()
+template <typename T>
+SampleBufferT<T>::~SampleBufferT()
 {
   // Cleanup:
-  if (m_sampleBuffer != 0)
-    delete [] m_sampleBuffer;
-  m_sampleBuffer = 0;
+  release();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::channelCount()
+// SampleBufferT::channelCount()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Access the number of channels of this buffer.
 ///\return  The number of channels of this buffer.
 ///\remarks 1 is mono, 2 is stereo etc.
 ////////////////////////////////////////////////////////////////////////////////
-int SampleBuffer::channelCount() const
+template <typename T>
+int SampleBufferT<T>::channelCount() const
 {
   // Return number of channels:
   return m_channelCount;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::sampleCount()
+// SampleBufferT::sampleCount()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Access the sample count of this buffer.
 ///\return  The sample count.
 ///\remarks Samples are only counted for a single channel here so for the
 ///         count it doesn't matter how many channels there are.
 ////////////////////////////////////////////////////////////////////////////////
-int SampleBuffer::sampleCount() const
+template <typename T>
+int SampleBufferT<T>::sampleCount() const
 {
   // Return number of samples:
   return m_sampleCount;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::sampleBuffer()
+// SampleBufferT::capacity()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the allocated capacity of a single channel.
+///\return  The number of samples a channel can hold without reallocation.
+///\remarks This is always greater or equal to sampleCount().
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+int SampleBufferT<T>::capacity() const
+{
+  // Return the channel stride:
+  return m_stride;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SampleBufferT::sampleBuffer()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Access the samples of this buffer.
 ///\param   [in] channel: The channel to access.
 ///\return  A pointer to the first sample of the requested channel.
 ///\remarks The data is not interleaved so each channel has it's own buffer.
 ////////////////////////////////////////////////////////////////////////////////
-double* SampleBuffer::sampleBuffer(const int channel)
+template <typename T>
+T* SampleBufferT<T>::sampleBuffer(const int channel)
 {
   // Sanity check:
   if (m_sampleBuffer == 0)
     return 0;
 
   // Return the buffer:
-  return m_sampleBuffer + (channel * m_sampleCount);
+  return m_sampleBuffer + (channel * m_stride);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::sampleBuffer()
+// SampleBufferT::sampleBuffer()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Access the samples of this buffer, const version.
 ///\param   [in] channel: The channel to access.
 ///\return  A pointer to the first sample of the requested channel.
 ///\remarks The data is not interleaved so each channel has it's own buffer.
 ////////////////////////////////////////////////////////////////////////////////
-const double* SampleBuffer::sampleBuffer(const int channel) const
+template <typename T>
+const T* SampleBufferT<T>::sampleBuffer(const int channel) const
 {
   // Sanity check:
   if (m_sampleBuffer == 0)
     return 0;
 
   // Return the buffer:
-  return m_sampleBuffer + (channel * m_sampleCount);
+  return m_sampleBuffer + (channel * m_stride);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::sample()
+// SampleBufferT::sample()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief  Extract a single samples from this buffer.
 ///\param  [in] channel: The channel of the sample.
 ///\param  [in] sample:  The index of the sample.
 ///\return The requested sample.
 ////////////////////////////////////////////////////////////////////////////////
-double SampleBuffer::sample(const int channel, const int sample) const
+template <typename T>
+T SampleBufferT<T>::sample(const int channel, const int sample) const
 {
   // Sanity check:
   assert(m_sampleBuffer != 0);
@@ -171,18 +223,19 @@ double SampleBuffer::sample(const int channel, const int sample) const
   assert(sample >= 0 && sample < m_sampleCount);
 
   // Return sample:
-  return *(m_sampleBuffer + (channel * m_sampleCount) + sample);
+  return *(m_sampleBuffer + (channel * m_stride) + sample);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::setSample()
+// SampleBufferT::setSample()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief  Set a single sample from this buffer.
 ///\param  [in] channel: The channel of the sample.
 ///\param  [in] sample:  The index of the sample.
 ///\param  [in] value:   The new sample.
 ////////////////////////////////////////////////////////////////////////////////
-void SampleBuffer::setSample(const int channel, const int sample, const double value)
+template <typename T>
+void SampleBufferT<T>::setSample(const int channel, const int sample, const T value)
 {
   // Sanity check:
   assert(m_sampleBuffer != 0);
@@ -190,75 +243,202 @@ void SampleBuffer::setSample(const int channel, const int sample, const double v
   assert(sample >= 0 && sample < m_sampleCount);
 
   // Set sample:
-  *(m_sampleBuffer + (channel * m_sampleCount) + sample) = value;
+  *(m_sampleBuffer + (channel * m_stride) + sample) = value;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::makeSilence()
+// SampleBufferT::makeSilence()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief Fill this buffer with zeroes.
 ////////////////////////////////////////////////////////////////////////////////
-void SampleBuffer::makeSilence()
+template <typename T>
+void SampleBufferT<T>::makeSilence()
 {
   // Sanity check:
   if (m_sampleBuffer == 0)
     return;
 
-  // Clear the buffer:
-  memset(m_sampleBuffer, 0, m_channelCount * m_sampleCount * sizeof(double));
+  // Clear the whole block if the channels are packed, else only the used part
+  // of each channel:
+  if (m_stride == m_sampleCount)
+    memset(m_sampleBuffer, 0, m_channelCount * m_stride * sizeof(T));
+  else
+  {
+    for (int i = 0; i < m_channelCount; i++)
+      memset(m_sampleBuffer + (i * m_stride), 0, m_sampleCount * sizeof(T));
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::operator = ()
+// SampleBufferT::operator = ()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Assignment operator of this class.
 ///\brief   [in] other: The buffer to copy.
 ///\return  A reference to this object.
 ///\remarks Copies the entire buffer without allocations if possible.
 ////////////////////////////////////////////////////////////////////////////////
-SampleBuffer& SampleBuffer::operator = (const SampleBuffer& other)
+template <typename T>
+SampleBufferT<T>& SampleBufferT<T>::operator = (const SampleBufferT& other)
 {
-  // Do we have to create a new buffer?
-  if (other.m_sampleCount != m_sampleCount || other.m_channelCount != m_channelCount)
-    createBuffers(other.m_channelCount, other.m_sampleCount);
+  // Self assignment?
+  if (&other == this)
+    return *this;
+
+  // Resize without clearing, everything is overwritten below:
+  createBuffers(other.m_channelCount, other.m_sampleCount, false);
 
   // Copy data:
-  memcpy(m_sampleBuffer, other.m_sampleBuffer, m_channelCount * m_sampleCount * sizeof(double));
+  for (int i = 0; i < m_channelCount; i++)
+    memcpy(sampleBuffer(i), other.sampleBuffer(i), m_sampleCount * sizeof(T));
+
+  // Always return this:
+  return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SampleBufferT::operator = ()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move assignment operator of this class.
+///\brief   [in] other: The buffer to take the storage from.
+///\return  A reference to this object.
+///\remarks The storage of both buffers is swapped, so our old storage is
+///         released together with the other buffer.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+SampleBufferT<T>& SampleBufferT<T>::operator = (SampleBufferT&& other)
+{
+  // Swap everything:
+  qSwap(m_channelCount,    other.m_channelCount);
+  qSwap(m_sampleCount,     other.m_sampleCount);
+  qSwap(m_channelCapacity, other.m_channelCapacity);
+  qSwap(m_stride,          other.m_stride);
+  qSwap(m_sampleBuffer,    other.m_sampleBuffer);
 
   // Always return this:
   return *this;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// SampleBuffer::createBuffers()
+// SampleBufferT::createBuffers()
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Create the actual storage space for this buffer.
 ///\brief   [in] numChannels: Number of channels of the buffer.
 ///\param   [in] numSamples:  Number of samples for a single channel.
-///\remarks The old buffer (if any) will be deleted and the new buffer is
-///         zeroed.
-////////////////////////////////////////////////////////////////////////////////
-void SampleBuffer::createBuffers(int numChannels, int numSamples)
+///\param   [in] clear:       Fill the buffer with zeroes?
+///\remarks The old storage is only replaced if the new size does not fit
+///         into the current capacity. Pass false for clear if the caller
+///         overwrites the whole buffer anyway (eg. when reading samples).
+///         If the memory can't be allocated the buffer is left empty.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void SampleBufferT<T>::createBuffers(int numChannels, int numSamples, bool clear)
 {
   // Sanity check:
   assert(numChannels >= 0);
   assert(numSamples >= 0);
 
-  // Free old buffers:
-  if (m_sampleBuffer != 0)
-    delete [] m_sampleBuffer;
-  m_sampleBuffer = 0;
+  // Need more space?
+  if (numChannels > m_channelCapacity || numSamples > m_stride)
+  {
+    allocate(numChannels, numSamples);
+
+    // Out of memory, stay empty:
+    if (numChannels > m_channelCapacity || numSamples > m_stride)
+      return;
+  }
 
   // Set properties:
   m_channelCount = numChannels;
   m_sampleCount  = numSamples;
 
+  // Clear the buffer:
+  if (clear)
+    makeSilence();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SampleBufferT::reserve()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Make sure that the buffer can hold the given size.
+///\brief   [in] numChannels: Number of channels to reserve.
+///\param   [in] numSamples:  Number of samples to reserve for each channel.
+///\remarks The logical size and the content of the buffer are preserved,
+///         also if the memory can't be allocated.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void SampleBufferT<T>::reserve(int numChannels, int numSamples)
+{
+  // Anything to do?
+  if (numChannels <= m_channelCapacity && numSamples <= m_stride)
+    return;
+
+  // Allocate the new storage and move the content over:
+  SampleBufferT temp;
+  temp.allocate(qMax(numChannels, m_channelCount), qMax(numSamples, m_sampleCount));
+  if (temp.m_channelCapacity < m_channelCount || temp.m_stride < m_sampleCount)
+    return;
+  temp.m_channelCount = m_channelCount;
+  temp.m_sampleCount  = m_sampleCount;
+  for (int i = 0; i < m_channelCount; i++)
+    memcpy(temp.sampleBuffer(i), sampleBuffer(i), m_sampleCount * sizeof(T));
+  *this = std::move(temp);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SampleBufferT::allocate()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Replace the storage of this buffer.
+///\brief   [in] numChannels: Number of channels to allocate.
+///\param   [in] numSamples:  Number of samples to allocate per channel.
+///\remarks The old content is lost. On failure the buffer has no storage
+///         and a capacity of 0.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void SampleBufferT<T>::allocate(int numChannels, int numSamples)
+{
+  // Free old buffers:
+  release();
+
+  // Round channel size up so every channel starts aligned:
+  const int alignSamples = s_alignment / sizeof(T);
+  int stride = ((numSamples + alignSamples - 1) / alignSamples) * alignSamples;
+
   // Alloc space for the samples:
-  if (m_channelCount != 0 && m_sampleCount != 0)
-    m_sampleBuffer = new double[m_channelCount * m_sampleCount];
+  if (numChannels != 0 && stride != 0)
+  {
+    m_sampleBuffer = static_cast<T*>(qMallocAligned(static_cast<size_t>(numChannels) * stride * sizeof(T), s_alignment));
+    if (m_sampleBuffer == 0)
+      return;
+  }
 
-  // Clear the buffer:
-  makeSilence();
+  // Set capacity:
+  m_channelCapacity = numChannels;
+  m_stride          = stride;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SampleBufferT::release()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Free the storage of this buffer.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void SampleBufferT<T>::release()
+{
+  // Free the storage:
+  if (m_sampleBuffer != 0)
+    qFreeAligned(m_sampleBuffer);
+  m_sampleBuffer = 0;
+
+  // Reset properties:
+  m_channelCount    = 0;
+  m_sampleCount     = 0;
+  m_channelCapacity = 0;
+  m_stride          = 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Explicit instantiations:
+template class SampleBufferT<double>;
+template class SampleBufferT<float>;
+
 ///////////////////////////////// End of File //////////////////////////////////
@@ -28,53 +28,69 @@
 #define __SAMPLEBUFFER_H_INCLUDED__
 
 ////////////////////////////////////////////////////////////////////////////////
-///\class   SampleBuffer samplebuffer.h
+///\class   SampleBufferT samplebuffer.h
 ///\brief   Buffer for samples.
-///\remarks This class encapsulates a sample buffer. The sample format is double
-///         precision float, normalized to [-1, 1]. For performance reasons this
-///         class should not be derived.
+///\remarks This class encapsulates a sample buffer. The sample format is
+///         either single or double precision float (see the typedefs below),
+///         normalized to [-1, 1]. For performance reasons this class should not
+///         be derived.
+///\par
+///         Every channel starts on a 64 byte boundary so it can be processed
+///         with aligned vector loads. The allocated capacity is kept apart from
+///         the logical sample count, so shrinking and regrowing a buffer within
+///         its capacity never touches the heap.
 ////////////////////////////////////////////////////////////////////////////////
-class SampleBuffer
+template <typename T>
+class SampleBufferT
 {
 public:
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::SampleBuffer()
+  // SampleBufferT::SampleBufferT()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Default constructor of this class.
   ///\remarks Basically only initializes the buffer.
   //////////////////////////////////////////////////////////////////////////////
-  SampleBuffer();
+  SampleBufferT();
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::SampleBuffer()
+  // SampleBufferT::SampleBufferT()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Copy constructor of this class.
   ///\brief   [in] other: The buffer to copy.
   ///\remarks Copies the entire buffer.
   //////////////////////////////////////////////////////////////////////////////
-  SampleBuffer(const SampleBuffer& other);
+  SampleBufferT(const SampleBufferT& other);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SampleBufferT::SampleBufferT()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move constructor of this class.
+  ///\brief   [in] other: The buffer to take the storage from.
+  ///\remarks The other buffer is left empty. Nothing is copied or allocated.
+  //////////////////////////////////////////////////////////////////////////////
+  SampleBufferT(SampleBufferT&& other);
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::SampleBuffer()
+  // SampleBufferT::SampleBufferT()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Initialization constructor of this class.
   ///\brief   [in] numChannels: Number of channels of this buffer.
   ///\param   [in] numSamples:  Number of samples for a single channel.
   ///\remarks The buffer is zeroed.
   //////////////////////////////////////////////////////////////////////////////
-  SampleBuffer(int numChannels, int numSamples);
+  SampleBufferT(int numChannels, int numSamples);
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::~SampleBuffer()
+  // SampleBufferT::~SampleBufferT()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Default destructor of this class.
   ///\remarks Frees all used resources. This is not virtual because this class
   ///         is not ment to be subclassed.
   //////////////////////////////////////////////////////////////////////////////
-  ~SampleBuffer();
+  ~SampleBufferT();
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::channelCount()
+  // SampleBufferT::channelCount()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Access the number of channels of this buffer.
   ///\return  The number of channels of this buffer.
@@ -83,7 +99,7 @@ public:
   int channelCount() const;
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::sampleCount()
+  // SampleBufferT::sampleCount()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Access the sample count of this buffer.
   ///\return  The sample count.
@@ -93,81 +109,143 @@ public:
   int sampleCount() const;
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::sampleBuffer()
+  // SampleBufferT::capacity()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the allocated capacity of a single channel.
+  ///\return  The number of samples a channel can hold without reallocation.
+  ///\remarks This is always greater or equal to sampleCount().
+  //////////////////////////////////////////////////////////////////////////////
+  int capacity() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SampleBufferT::sampleBuffer()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Access the samples of this buffer.
   ///\param   [in] channel: The channel to access.
   ///\return  A pointer to the first sample of the requested channel.
   ///\remarks The data is not interleaved so each channel has it's own buffer.
   //////////////////////////////////////////////////////////////////////////////
-  double* sampleBuffer(const int channel);
+  T* sampleBuffer(const int channel);
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::sampleBuffer()
+  // SampleBufferT::sampleBuffer()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Access the samples of this buffer, const version.
   ///\param   [in] channel: The channel to access.
   ///\return  A pointer to the first sample of the requested channel.
   ///\remarks The data is not interleaved so each channel has it's own buffer.
   //////////////////////////////////////////////////////////////////////////////
-  const double* sampleBuffer(const int channel) const;
+  const T* sampleBuffer(const int channel) const;
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::sample()
+  // SampleBufferT::sample()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief  Extract a single sample from this buffer.
   ///\param  [in] channel: The channel of the sample.
   ///\param  [in] sample:  The index of the sample.
   ///\return The requested sample.
   //////////////////////////////////////////////////////////////////////////////
-  double sample(const int channel, const int sample) const;
+  T sample(const int channel, const int sample) const;
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::setSample()
+  // SampleBufferT::setSample()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief  Set a single sample from this buffer.
   ///\param  [in] channel: The channel of the sample.
   ///\param  [in] sample:  The index of the sample.
   ///\param  [in] value:   The new sample.
   //////////////////////////////////////////////////////////////////////////////
-  void setSample(const int channel, const int sample, const double value);
+  void setSample(const int channel, const int sample, const T value);
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::makeSilence()
+  // SampleBufferT::makeSilence()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief Fill this buffer with zeroes.
   //////////////////////////////////////////////////////////////////////////////
   void makeSilence();
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::operator = ()
+  // SampleBufferT::operator = ()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Assignment operator of this class.
   ///\brief   [in] other: The buffer to copy.
   ///\return  A reference to this object.
   ///\remarks Copies the entire buffer without allocations if possible.
   //////////////////////////////////////////////////////////////////////////////
-  SampleBuffer& operator = (const SampleBuffer& other);
+  SampleBufferT& operator = (const SampleBufferT& other);
 
   //////////////////////////////////////////////////////////////////////////////
-  // SampleBuffer::createBuffers()
+  // SampleBufferT::operator = ()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move assignment operator of this class.
+  ///\brief   [in] other: The buffer to take the storage from.
+  ///\return  A reference to this object.
+  ///\remarks The storage of both buffers is swapped, so our old storage is
+  ///         released together with the other buffer.
+  //////////////////////////////////////////////////////////////////////////////
+  SampleBufferT& operator = (SampleBufferT&& other);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SampleBufferT::createBuffers()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Create the actual storage space for this buffer.
   ///\brief   [in] numChannels: Number of channels of the buffer.
   ///\param   [in] numSamples:  Number of samples for a single channel.
-  ///\remarks The old buffer (if any) will be deleted and the new buffer is
-  ///         zeroed.
+  ///\param   [in] clear:       Fill the buffer with zeroes?
+  ///\remarks The old storage is only replaced if the new size does not fit
+  ///         into the current capacity. Pass false for clear if the caller
+  ///         overwrites the whole buffer anyway (eg. when reading samples).
+  ///         If the memory can't be allocated the buffer is left empty.
+  //////////////////////////////////////////////////////////////////////////////
+  void createBuffers(int numChannels, int numSamples, bool clear = true);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SampleBufferT::reserve()
   //////////////////////////////////////////////////////////////////////////////
-  void createBuffers(int numChannels, int numSamples);
+  ///\brief   Make sure that the buffer can hold the given size.
+  ///\brief   [in] numChannels: Number of channels to reserve.
+  ///\param   [in] numSamples:  Number of samples to reserve for each channel.
+  ///\remarks The logical size and the content of the buffer are preserved,
+  ///         also if the memory can't be allocated.
+  //////////////////////////////////////////////////////////////////////////////
+  void reserve(int numChannels, int numSamples);
 
 private:
 
+  //////////////////////////////////////////////////////////////////////////////
+  // SampleBufferT::allocate()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Replace the storage of this buffer.
+  ///\brief   [in] numChannels: Number of channels to allocate.
+  ///\param   [in] numSamples:  Number of samples to allocate per channel.
+  ///\remarks The old content is lost. On failure the buffer has no storage
+  ///         and a capacity of 0.
+  //////////////////////////////////////////////////////////////////////////////
+  void allocate(int numChannels, int numSamples);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SampleBufferT::release()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief Free the storage of this buffer.
+  //////////////////////////////////////////////////////////////////////////////
+  void release();
+
   //////////////////////////////////////////////////////////////////////////////
   // Member:
-  int     m_channelCount; ///> Number of channels.
-  int     m_sampleCount;  ///> Number of samples of a channel.
-  double* m_sampleBuffer; ///> Pointer to the channel buffers.
+  int     m_channelCount;    ///> Number of channels.
+  int     m_sampleCount;     ///> Number of samples of a channel.
+  int     m_channelCapacity; ///> Number of allocated channels.
+  int     m_stride;          ///> Allocated samples per channel (aligned).
+  T*      m_sampleBuffer;    ///> Pointer to the channel buffers.
 };
 
+////////////////////////////////////////////////////////////////////////////////
+///\brief Double precision sample buffer, used by the rack and its devices.
+typedef SampleBufferT<double> SampleBuffer;
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Single precision sample buffer, used for peak building and display.
+typedef SampleBufferT<float> FloatSampleBuffer;
+
 #endif // #ifndef __SAMPLEBUFFER_H_INCLUDED__
 ///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,770 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    samplekernels.cpp
+///\ingroup bruo
+///\brief   Vectorized sample processing kernels.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "samplekernels.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Instruction set selection. SSE2 is part of every x86-64 CPU, AVX2 is checked
+// at runtime:
+#if defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && defined(__SSE2__))
+  #define BRUO_SIMD_X86
+  #include <emmintrin.h>
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    #define BRUO_TARGET_AVX2
+  #else
+    #define BRUO_TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Available instruction set levels.
+enum SimdLevel
+{
+  SimdScalar = 0, ///> Plain C++.
+  SimdSSE2   = 1, ///> SSE2 (x86 baseline).
+  SimdAVX2   = 2  ///> AVX2.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// detectSimdLevel()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the best instruction set of the current CPU.
+///\return  The detected level.
+////////////////////////////////////////////////////////////////////////////////
+static SimdLevel detectSimdLevel()
+{
+#if defined(BRUO_SIMD_X86)
+  #if defined(_MSC_VER)
+  // Check AVX2 and OS support for the YMM state:
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] >= 7)
+  {
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    __cpuidex(info, 7, 0);
+    if (osxsave && (info[1] & (1 << 5)) != 0 && (_xgetbv(0) & 6) == 6)
+      return SimdAVX2;
+  }
+  #else
+  // Ask the compiler runtime:
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return SimdAVX2;
+  #endif
+  return SimdSSE2;
+#else
+  return SimdScalar;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// simdLevel()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the instruction set level (detected once).
+///\return  The current level.
+////////////////////////////////////////////////////////////////////////////////
+static SimdLevel simdLevel()
+{
+  static const SimdLevel level = detectSimdLevel();
+  return level;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// simdLevelName()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Name the instruction set that the kernels use on this machine.
+///\return  "AVX2", "SSE2" or "scalar".
+///\remarks Meant for logging and statistics.
+////////////////////////////////////////////////////////////////////////////////
+const char* simdLevelName()
+{
+  switch (simdLevel())
+  {
+  case SimdAVX2:
+    return "AVX2";
+  case SimdSSE2:
+    return "SSE2";
+  default:
+    return "scalar";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleaveScalar()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Scalar deinterleave for any channel count.
+///\param   [in]  src:         The interleaved source frames.
+///\param   [out] dst:         One target pointer per channel.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  firstFrame:  First frame to convert.
+///\param   [in]  numFrames:   Total number of frames.
+///\remarks Works in blocks so the source stays in the cache while every
+///         channel is extracted.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+static void deinterleaveScalar(const T* src, T* const* dst, int numChannels, qint64 firstFrame, qint64 numFrames)
+{
+  const qint64 blockSize = 256;
+  for (qint64 block = firstFrame; block < numFrames; block += blockSize)
+  {
+    const qint64 end = qMin(block + blockSize, numFrames);
+    for (int c = 0; c < numChannels; c++)
+    {
+      const T* s = src + (block * numChannels) + c;
+      T* d = dst[c];
+      for (qint64 i = block; i < end; i++, s += numChannels)
+        d[i] = *s;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaksScalar()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Scalar peak search of interleaved frames for any channel count.
+///\param   [in]     frames:      The interleaved frames.
+///\param   [in]     numChannels: Number of channels of a frame.
+///\param   [in]     firstFrame:  First frame to search.
+///\param   [in]     numFrames:   Total number of frames.
+///\param   [in,out] minVals:     Minimum of every channel.
+///\param   [in,out] maxVals:     Maximum of every channel.
+///\param   [in,out] squares:     Sum of the squares of every channel.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+static void findPeaksScalar(const T* frames, int numChannels, qint64 firstFrame, qint64 numFrames, T* minVals, T* maxVals, float* squares)
+{
+  const T* p = frames + firstFrame * numChannels;
+  for (qint64 i = firstFrame; i < numFrames; i++)
+  {
+    for (int c = 0; c < numChannels; c++, p++)
+    {
+      if (*p < minVals[c])
+        minVals[c] = *p;
+      if (*p > maxVals[c])
+        maxVals[c] = *p;
+      const float f = static_cast<float>(*p);
+      squares[c] += f * f;
+    }
+  }
+}
+
+#if defined(BRUO_SIMD_X86)
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleaveStereoSSE2()
+////////////////////////////////////////////////////////////////////////////////
+///\brief  Stereo float deinterleave, SSE2 version.
+///\return The number of frames converted (the rest is left to the caller).
+////////////////////////////////////////////////////////////////////////////////
+static qint64 deinterleaveStereoSSE2(const float* src, float* left, float* right, qint64 numFrames)
+{
+  qint64 i = 0;
+  for (; i + 4 <= numFrames; i += 4, src += 8)
+  {
+    __m128 a = _mm_loadu_ps(src);
+    __m128 b = _mm_loadu_ps(src + 4);
+    _mm_storeu_ps(left  + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleaveStereoSSE2()
+////////////////////////////////////////////////////////////////////////////////
+///\brief  Stereo double deinterleave, SSE2 version.
+///\return The number of frames converted (the rest is left to the caller).
+////////////////////////////////////////////////////////////////////////////////
+static qint64 deinterleaveStereoSSE2(const double* src, double* left, double* right, qint64 numFrames)
+{
+  qint64 i = 0;
+  for (; i + 2 <= numFrames; i += 2, src += 4)
+  {
+    __m128d a = _mm_loadu_pd(src);
+    __m128d b = _mm_loadu_pd(src + 2);
+    _mm_storeu_pd(left  + i, _mm_unpacklo_pd(a, b));
+    _mm_storeu_pd(right + i, _mm_unpackhi_pd(a, b));
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleaveQuadsSSE2()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Float deinterleave for multiples of four channels, SSE2 version.
+///\return  The number of frames converted (the rest is left to the caller).
+///\remarks Transposes 4x4 blocks of frames and channels.
+////////////////////////////////////////////////////////////////////////////////
+static qint64 deinterleaveQuadsSSE2(const float* src, float* const* dst, int numChannels, qint64 numFrames)
+{
+  qint64 i = 0;
+  for (; i + 4 <= numFrames; i += 4)
+  {
+    const float* s = src + (i * numChannels);
+    for (int c = 0; c < numChannels; c += 4)
+    {
+      __m128 r0 = _mm_loadu_ps(s + c);
+      __m128 r1 = _mm_loadu_ps(s + c + numChannels);
+      __m128 r2 = _mm_loadu_ps(s + c + numChannels * 2);
+      __m128 r3 = _mm_loadu_ps(s + c + numChannels * 3);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      _mm_storeu_ps(dst[c]     + i, r0);
+      _mm_storeu_ps(dst[c + 1] + i, r1);
+      _mm_storeu_ps(dst[c + 2] + i, r2);
+      _mm_storeu_ps(dst[c + 3] + i, r3);
+    }
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleavePairsSSE2()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Double deinterleave for even channel counts, SSE2 version.
+///\return  The number of frames converted (the rest is left to the caller).
+///\remarks Transposes 2x2 blocks of frames and channels.
+////////////////////////////////////////////////////////////////////////////////
+static qint64 deinterleavePairsSSE2(const double* src, double* const* dst, int numChannels, qint64 numFrames)
+{
+  qint64 i = 0;
+  for (; i + 2 <= numFrames; i += 2)
+  {
+    const double* s = src + (i * numChannels);
+    for (int c = 0; c < numChannels; c += 2)
+    {
+      __m128d a = _mm_loadu_pd(s + c);
+      __m128d b = _mm_loadu_pd(s + c + numChannels);
+      _mm_storeu_pd(dst[c]     + i, _mm_unpacklo_pd(a, b));
+      _mm_storeu_pd(dst[c + 1] + i, _mm_unpackhi_pd(a, b));
+    }
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleaveStereoAVX2()
+////////////////////////////////////////////////////////////////////////////////
+///\brief  Stereo float deinterleave, AVX2 version.
+///\return The number of frames converted (the rest is left to the caller).
+////////////////////////////////////////////////////////////////////////////////
+BRUO_TARGET_AVX2
+static qint64 deinterleaveStereoAVX2(const float* src, float* left, float* right, qint64 numFrames)
+{
+  qint64 i = 0;
+  for (; i + 8 <= numFrames; i += 8, src += 16)
+  {
+    // Split inside the 128 bit lanes, then fix the lane order:
+    __m256 a = _mm256_loadu_ps(src);
+    __m256 b = _mm256_loadu_ps(src + 8);
+    __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+    r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu_ps(left  + i, l);
+    _mm256_storeu_ps(right + i, r);
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleaveStereoAVX2()
+////////////////////////////////////////////////////////////////////////////////
+///\brief  Stereo double deinterleave, AVX2 version.
+///\return The number of frames converted (the rest is left to the caller).
+////////////////////////////////////////////////////////////////////////////////
+BRUO_TARGET_AVX2
+static qint64 deinterleaveStereoAVX2(const double* src, double* left, double* right, qint64 numFrames)
+{
+  qint64 i = 0;
+  for (; i + 4 <= numFrames; i += 4, src += 8)
+  {
+    __m256d a = _mm256_loadu_pd(src);
+    __m256d b = _mm256_loadu_pd(src + 4);
+    _mm256_storeu_pd(left  + i, _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu_pd(right + i, _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Vector operations for the peak kernels, SSE2 and 16 bit samples.
+struct Int16SSE2
+{
+  typedef qint16  T;
+  typedef __m128i V;
+  enum { Lanes = 8 };
+  static V load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+  static void store(T* p, V v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+  static V min(V a, V b) { return _mm_min_epi16(a, b); }
+  static V max(V a, V b) { return _mm_max_epi16(a, b); }
+  enum { SquareVectors = 2 };
+  static void addSquares(V x, __m128* acc)
+  {
+    // Sign extend to 32 bit, then square as float:
+    const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+    const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+    acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(lo, lo));
+    acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(hi, hi));
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Vector operations for the peak kernels, SSE2 and 32 bit samples.
+///\remarks SSE2 has no 32 bit min/max, so they are built from a compare.
+struct Int32SSE2
+{
+  typedef qint32  T;
+  typedef __m128i V;
+  enum { Lanes = 4 };
+  static V load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+  static void store(T* p, V v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+  static V min(V a, V b) { V m = _mm_cmpgt_epi32(a, b); return _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a)); }
+  static V max(V a, V b) { V m = _mm_cmpgt_epi32(a, b); return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+  enum { SquareVectors = 1 };
+  static void addSquares(V x, __m128* acc) { const __m128 f = _mm_cvtepi32_ps(x); acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(f, f)); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Vector operations for the peak kernels, SSE2 and float samples.
+struct FloatSSE2
+{
+  typedef float  T;
+  typedef __m128 V;
+  enum { Lanes = 4 };
+  static V load(const T* p) { return _mm_loadu_ps(p); }
+  static void store(T* p, V v) { _mm_storeu_ps(p, v); }
+  static V min(V a, V b) { return _mm_min_ps(a, b); }
+  static V max(V a, V b) { return _mm_max_ps(a, b); }
+  enum { SquareVectors = 1 };
+  static void addSquares(V x, __m128* acc) { acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(x, x)); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Vector operations for the peak kernels, AVX2 and 16 bit samples.
+struct Int16AVX2
+{
+  typedef qint16  T;
+  typedef __m256i V;
+  enum { Lanes = 16 };
+  BRUO_TARGET_AVX2 static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+  BRUO_TARGET_AVX2 static void store(T* p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+  BRUO_TARGET_AVX2 static V min(V a, V b) { return _mm256_min_epi16(a, b); }
+  BRUO_TARGET_AVX2 static V max(V a, V b) { return _mm256_max_epi16(a, b); }
+  enum { SquareVectors = 2 };
+  BRUO_TARGET_AVX2 static void addSquares(V x, __m256* acc)
+  {
+    // Sign extend to 32 bit, then square as float:
+    const __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(x)));
+    const __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1)));
+    acc[0] = _mm256_add_ps(acc[0], _mm256_mul_ps(lo, lo));
+    acc[1] = _mm256_add_ps(acc[1], _mm256_mul_ps(hi, hi));
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Vector operations for the peak kernels, AVX2 and 32 bit samples.
+struct Int32AVX2
+{
+  typedef qint32  T;
+  typedef __m256i V;
+  enum { Lanes = 8 };
+  BRUO_TARGET_AVX2 static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+  BRUO_TARGET_AVX2 static void store(T* p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+  BRUO_TARGET_AVX2 static V min(V a, V b) { return _mm256_min_epi32(a, b); }
+  BRUO_TARGET_AVX2 static V max(V a, V b) { return _mm256_max_epi32(a, b); }
+  enum { SquareVectors = 1 };
+  BRUO_TARGET_AVX2 static void addSquares(V x, __m256* acc) { const __m256 f = _mm256_cvtepi32_ps(x); acc[0] = _mm256_add_ps(acc[0], _mm256_mul_ps(f, f)); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Vector operations for the peak kernels, AVX2 and float samples.
+struct FloatAVX2
+{
+  typedef float  T;
+  typedef __m256 V;
+  enum { Lanes = 8 };
+  BRUO_TARGET_AVX2 static V load(const T* p) { return _mm256_loadu_ps(p); }
+  BRUO_TARGET_AVX2 static void store(T* p, V v) { _mm256_storeu_ps(p, v); }
+  BRUO_TARGET_AVX2 static V min(V a, V b) { return _mm256_min_ps(a, b); }
+  BRUO_TARGET_AVX2 static V max(V a, V b) { return _mm256_max_ps(a, b); }
+  enum { SquareVectors = 1 };
+  BRUO_TARGET_AVX2 static void addSquares(V x, __m256* acc) { acc[0] = _mm256_add_ps(acc[0], _mm256_mul_ps(x, x)); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// peakPeriod()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the number of samples that the peak kernels load per step.
+///\param   [in] lanes:       Samples per vector.
+///\param   [in] numChannels: Number of channels of a frame.
+///\return  The step size (always whole frames) or zero if the channel count
+///         doesn't fit the vectors.
+///\remarks A step is one vector of several frames (mono, stereo, ...) or up
+///         to four vectors of one frame (eg. 8 channels).
+////////////////////////////////////////////////////////////////////////////////
+static int peakPeriod(int lanes, int numChannels)
+{
+  if ((lanes % numChannels) == 0)
+    return lanes;
+  if ((numChannels % lanes) == 0 && numChannels <= lanes * 4)
+    return numChannels;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// foldPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Merge the lanes of the peak kernels into the channel results.
+///\param   [in]     lo:          Minimum of every lane.
+///\param   [in]     hi:          Maximum of every lane.
+///\param   [in]     sq:          Sum of the squares of every lane.
+///\param   [in]     period:      Number of lanes.
+///\param   [in]     numChannels: Number of channels of a frame.
+///\param   [in,out] minVals:     Minimum of every channel.
+///\param   [in,out] maxVals:     Maximum of every channel.
+///\param   [in,out] squares:     Sum of the squares of every channel.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+static void foldPeaks(const T* lo, const T* hi, const float* sq, int period, int numChannels, T* minVals, T* maxVals, float* squares)
+{
+  for (int i = 0; i < period; i++)
+  {
+    const int c = i % numChannels;
+    if (lo[i] < minVals[c])
+      minVals[c] = lo[i];
+    if (hi[i] > maxVals[c])
+      maxVals[c] = hi[i];
+    squares[c] += sq[i];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaksSSE2()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Peak search of interleaved frames, SSE2 version.
+///\return  The number of frames searched (the rest is left to the caller).
+///\remarks The results are merged into minVals, maxVals and squares.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Ops>
+static qint64 findPeaksSSE2(const typename Ops::T* frames, int numChannels, qint64 numFrames, typename Ops::T* minVals, typename Ops::T* maxVals, float* squares)
+{
+  // Does the channel count fit?
+  const int period = peakPeriod(Ops::Lanes, numChannels);
+  if (period == 0 || numFrames * numChannels < period)
+    return 0;
+  const int vectors = period / Ops::Lanes;
+  const qint64 steps = (numFrames * numChannels) / period;
+
+  // Search every lane:
+  typename Ops::V lo[4];
+  typename Ops::V hi[4];
+  __m128 sq[4 * Ops::SquareVectors];
+  for (int v = 0; v < vectors; v++)
+    lo[v] = hi[v] = Ops::load(frames + v * Ops::Lanes);
+  for (int v = 0; v < vectors * Ops::SquareVectors; v++)
+    sq[v] = _mm_setzero_ps();
+  const typename Ops::T* p = frames;
+  for (qint64 i = 0; i < steps; i++, p += period)
+  {
+    for (int v = 0; v < vectors; v++)
+    {
+      const typename Ops::V x = Ops::load(p + v * Ops::Lanes);
+      lo[v] = Ops::min(lo[v], x);
+      hi[v] = Ops::max(hi[v], x);
+      Ops::addSquares(x, sq + v * Ops::SquareVectors);
+    }
+  }
+
+  // Merge the lanes into the channels:
+  const int floatLanes = sizeof(__m128) / sizeof(float);
+  typename Ops::T loLanes[Ops::Lanes * 4];
+  typename Ops::T hiLanes[Ops::Lanes * 4];
+  float sqLanes[Ops::Lanes * 4];
+  for (int v = 0; v < vectors; v++)
+  {
+    Ops::store(loLanes + v * Ops::Lanes, lo[v]);
+    Ops::store(hiLanes + v * Ops::Lanes, hi[v]);
+  }
+  for (int v = 0; v < vectors * Ops::SquareVectors; v++)
+    _mm_storeu_ps(sqLanes + v * floatLanes, sq[v]);
+  foldPeaks(loLanes, hiLanes, sqLanes, period, numChannels, minVals, maxVals, squares);
+  return (steps * period) / numChannels;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaksAVX2()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Peak search of interleaved frames, AVX2 version.
+///\return  The number of frames searched (the rest is left to the caller).
+///\remarks Same as the SSE2 version, but compiled for AVX2.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Ops>
+BRUO_TARGET_AVX2
+static qint64 findPeaksAVX2(const typename Ops::T* frames, int numChannels, qint64 numFrames, typename Ops::T* minVals, typename Ops::T* maxVals, float* squares)
+{
+  // Does the channel count fit?
+  const int period = peakPeriod(Ops::Lanes, numChannels);
+  if (period == 0 || numFrames * numChannels < period)
+    return 0;
+  const int vectors = period / Ops::Lanes;
+  const qint64 steps = (numFrames * numChannels) / period;
+
+  // Search every lane:
+  typename Ops::V lo[4];
+  typename Ops::V hi[4];
+  __m256 sq[4 * Ops::SquareVectors];
+  for (int v = 0; v < vectors; v++)
+    lo[v] = hi[v] = Ops::load(frames + v * Ops::Lanes);
+  for (int v = 0; v < vectors * Ops::SquareVectors; v++)
+    sq[v] = _mm256_setzero_ps();
+  const typename Ops::T* p = frames;
+  for (qint64 i = 0; i < steps; i++, p += period)
+  {
+    for (int v = 0; v < vectors; v++)
+    {
+      const typename Ops::V x = Ops::load(p + v * Ops::Lanes);
+      lo[v] = Ops::min(lo[v], x);
+      hi[v] = Ops::max(hi[v], x);
+      Ops::addSquares(x, sq + v * Ops::SquareVectors);
+    }
+  }
+
+  // Merge the lanes into the channels:
+  const int floatLanes = sizeof(__m256) / sizeof(float);
+  typename Ops::T loLanes[Ops::Lanes * 4];
+  typename Ops::T hiLanes[Ops::Lanes * 4];
+  float sqLanes[Ops::Lanes * 4];
+  for (int v = 0; v < vectors; v++)
+  {
+    Ops::store(loLanes + v * Ops::Lanes, lo[v]);
+    Ops::store(hiLanes + v * Ops::Lanes, hi[v]);
+  }
+  for (int v = 0; v < vectors * Ops::SquareVectors; v++)
+    _mm256_storeu_ps(sqLanes + v * floatLanes, sq[v]);
+  foldPeaks(loLanes, hiLanes, sqLanes, period, numChannels, minVals, maxVals, squares);
+  return (steps * period) / numChannels;
+}
+
+#endif // #if defined(BRUO_SIMD_X86)
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleave()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Split interleaved sample frames into separate channel buffers.
+///\param   [in]  src:         The interleaved source frames.
+///\param   [out] dst:         One target pointer per channel.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to convert.
+///\remarks Mono, stereo and multiples of four channels have vectorized
+///         versions (SSE2 and AVX2 on x86, picked at runtime). Everything else
+///         uses the scalar fallback.
+////////////////////////////////////////////////////////////////////////////////
+void deinterleave(const float* src, float* const* dst, int numChannels, qint64 numFrames)
+{
+  // Anything to do?
+  if (numChannels <= 0 || numFrames <= 0)
+    return;
+
+  // Mono is a plain copy:
+  if (numChannels == 1)
+  {
+    memcpy(dst[0], src, numFrames * sizeof(float));
+    return;
+  }
+
+  // Run the vector kernel first, the scalar code handles the tail:
+  qint64 done = 0;
+#if defined(BRUO_SIMD_X86)
+  if (numChannels == 2)
+  {
+    if (simdLevel() >= SimdAVX2)
+      done = deinterleaveStereoAVX2(src, dst[0], dst[1], numFrames);
+    else
+      done = deinterleaveStereoSSE2(src, dst[0], dst[1], numFrames);
+  }
+  else if ((numChannels % 4) == 0)
+    done = deinterleaveQuadsSSE2(src, dst, numChannels, numFrames);
+#endif
+  deinterleaveScalar(src, dst, numChannels, done, numFrames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleave()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Split interleaved sample frames into separate channel buffers.
+///\param   [in]  src:         The interleaved source frames.
+///\param   [out] dst:         One target pointer per channel.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to convert.
+///\remarks Double precision version, see above.
+////////////////////////////////////////////////////////////////////////////////
+void deinterleave(const double* src, double* const* dst, int numChannels, qint64 numFrames)
+{
+  // Anything to do?
+  if (numChannels <= 0 || numFrames <= 0)
+    return;
+
+  // Mono is a plain copy:
+  if (numChannels == 1)
+  {
+    memcpy(dst[0], src, numFrames * sizeof(double));
+    return;
+  }
+
+  // Run the vector kernel first, the scalar code handles the tail:
+  qint64 done = 0;
+#if defined(BRUO_SIMD_X86)
+  if (numChannels == 2)
+  {
+    if (simdLevel() >= SimdAVX2)
+      done = deinterleaveStereoAVX2(src, dst[0], dst[1], numFrames);
+    else
+      done = deinterleaveStereoSSE2(src, dst[0], dst[1], numFrames);
+  }
+  else if ((numChannels % 2) == 0)
+    done = deinterleavePairsSSE2(src, dst, numChannels, numFrames);
+#endif
+  deinterleaveScalar(src, dst, numChannels, done, numFrames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the extremes and the energy of every channel of interleaved
+///         sample frames.
+///\param   [in]  frames:      The interleaved frames.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to search.
+///\param   [out] minVals:     Minimum of every channel.
+///\param   [out] maxVals:     Maximum of every channel.
+///\param   [out] squares:     Sum of the squared samples of every channel.
+///\remarks Channel counts that divide or are a small multiple of the vector
+///         width (1, 2, 4, 8 ...) have vectorized versions (SSE2 and AVX2 on
+///         x86, picked at runtime). Everything else uses the scalar fallback.
+////////////////////////////////////////////////////////////////////////////////
+void findPeaks(const qint16* frames, int numChannels, qint64 numFrames, qint16* minVals, qint16* maxVals, float* squares)
+{
+  // Anything to do?
+  if (numChannels <= 0 || numFrames <= 0)
+    return;
+
+  // Start with the first frame:
+  for (int c = 0; c < numChannels; c++)
+  {
+    minVals[c] = maxVals[c] = frames[c];
+    squares[c] = 0.0f;
+  }
+
+  // Run the vector kernel first, the scalar code handles the tail:
+  qint64 done = 0;
+#if defined(BRUO_SIMD_X86)
+  if (simdLevel() >= SimdAVX2)
+    done = findPeaksAVX2<Int16AVX2>(frames, numChannels, numFrames, minVals, maxVals, squares);
+  else
+    done = findPeaksSSE2<Int16SSE2>(frames, numChannels, numFrames, minVals, maxVals, squares);
+#endif
+  findPeaksScalar(frames, numChannels, done, numFrames, minVals, maxVals, squares);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the extremes and the energy of every channel of interleaved
+///         sample frames.
+///\param   [in]  frames:      The interleaved frames.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to search.
+///\param   [out] minVals:     Minimum of every channel.
+///\param   [out] maxVals:     Maximum of every channel.
+///\param   [out] squares:     Sum of the squared samples of every channel.
+///\remarks 32 bit version, see above.
+////////////////////////////////////////////////////////////////////////////////
+void findPeaks(const qint32* frames, int numChannels, qint64 numFrames, qint32* minVals, qint32* maxVals, float* squares)
+{
+  // Anything to do?
+  if (numChannels <= 0 || numFrames <= 0)
+    return;
+
+  // Start with the first frame:
+  for (int c = 0; c < numChannels; c++)
+  {
+    minVals[c] = maxVals[c] = frames[c];
+    squares[c] = 0.0f;
+  }
+
+  // Run the vector kernel first, the scalar code handles the tail:
+  qint64 done = 0;
+#if defined(BRUO_SIMD_X86)
+  if (simdLevel() >= SimdAVX2)
+    done = findPeaksAVX2<Int32AVX2>(frames, numChannels, numFrames, minVals, maxVals, squares);
+  else
+    done = findPeaksSSE2<Int32SSE2>(frames, numChannels, numFrames, minVals, maxVals, squares);
+#endif
+  findPeaksScalar(frames, numChannels, done, numFrames, minVals, maxVals, squares);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the extremes and the energy of every channel of interleaved
+///         sample frames.
+///\param   [in]  frames:      The interleaved frames.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to search.
+///\param   [out] minVals:     Minimum of every channel.
+///\param   [out] maxVals:     Maximum of every channel.
+///\param   [out] squares:     Sum of the squared samples of every channel.
+///\remarks Float version, see above. Use a channel count of one for the
+///         buffers of a sample buffer.
+////////////////////////////////////////////////////////////////////////////////
+void findPeaks(const float* frames, int numChannels, qint64 numFrames, float* minVals, float* maxVals, float* squares)
+{
+  // Anything to do?
+  if (numChannels <= 0 || numFrames <= 0)
+    return;
+
+  // Start with the first frame:
+  for (int c = 0; c < numChannels; c++)
+  {
+    minVals[c] = maxVals[c] = frames[c];
+    squares[c] = 0.0f;
+  }
+
+  // Run the vector kernel first, the scalar code handles the tail:
+  qint64 done = 0;
+#if defined(BRUO_SIMD_X86)
+  if (simdLevel() >= SimdAVX2)
+    done = findPeaksAVX2<FloatAVX2>(frames, numChannels, numFrames, minVals, maxVals, squares);
+  else
+    done = findPeaksSSE2<FloatSSE2>(frames, numChannels, numFrames, minVals, maxVals, squares);
+#endif
+  findPeaksScalar(frames, numChannels, done, numFrames, minVals, maxVals, squares);
+}
+
+///////////////////////////////// End of File //////////////////////////////////
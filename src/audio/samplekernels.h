@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    samplekernels.h
+///\ingroup bruo
+///\brief   Vectorized sample processing kernels.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __SAMPLEKERNELS_H_INCLUDED__
+#define __SAMPLEKERNELS_H_INCLUDED__
+
+#include "bruo.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleave()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Split interleaved sample frames into separate channel buffers.
+///\param   [in]  src:         The interleaved source frames.
+///\param   [out] dst:         One target pointer per channel.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to convert.
+///\remarks Mono, stereo and multiples of four channels have vectorized
+///         versions (SSE2 and AVX2 on x86, picked at runtime). Everything else
+///         uses the scalar fallback.
+////////////////////////////////////////////////////////////////////////////////
+void deinterleave(const float* src, float* const* dst, int numChannels, qint64 numFrames);
+
+////////////////////////////////////////////////////////////////////////////////
+// deinterleave()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Split interleaved sample frames into separate channel buffers.
+///\param   [in]  src:         The interleaved source frames.
+///\param   [out] dst:         One target pointer per channel.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to convert.
+///\remarks Double precision version, see above.
+////////////////////////////////////////////////////////////////////////////////
+void deinterleave(const double* src, double* const* dst, int numChannels, qint64 numFrames);
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the extremes and the energy of every channel of interleaved
+///         sample frames.
+///\param   [in]  frames:      The interleaved frames.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to search.
+///\param   [out] minVals:     Minimum of every channel.
+///\param   [out] maxVals:     Maximum of every channel.
+///\param   [out] squares:     Sum of the squared samples of every channel.
+///\remarks Channel counts that divide or are a small multiple of the vector
+///         width (1, 2, 4, 8 ...) have vectorized versions (SSE2 and AVX2 on
+///         x86, picked at runtime). Everything else uses the scalar fallback.
+////////////////////////////////////////////////////////////////////////////////
+void findPeaks(const qint16* frames, int numChannels, qint64 numFrames, qint16* minVals, qint16* maxVals, float* squares);
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the extremes and the energy of every channel of interleaved
+///         sample frames.
+///\param   [in]  frames:      The interleaved frames.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to search.
+///\param   [out] minVals:     Minimum of every channel.
+///\param   [out] maxVals:     Maximum of every channel.
+///\param   [out] squares:     Sum of the squared samples of every channel.
+///\remarks 32 bit version, see above.
+////////////////////////////////////////////////////////////////////////////////
+void findPeaks(const qint32* frames, int numChannels, qint64 numFrames, qint32* minVals, qint32* maxVals, float* squares);
+
+////////////////////////////////////////////////////////////////////////////////
+// findPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the extremes and the energy of every channel of interleaved
+///         sample frames.
+///\param   [in]  frames:      The interleaved frames.
+///\param   [in]  numChannels: Number of channels of a frame.
+///\param   [in]  numFrames:   Number of frames to search.
+///\param   [out] minVals:     Minimum of every channel.
+///\param   [out] maxVals:     Maximum of every channel.
+///\param   [out] squares:     Sum of the squared samples of every channel.
+///\remarks Float version, see above. Use a channel count of one for the
+///         buffers of a sample buffer.
+////////////////////////////////////////////////////////////////////////////////
+void findPeaks(const float* frames, int numChannels, qint64 numFrames, float* minVals, float* maxVals, float* squares);
+
+////////////////////////////////////////////////////////////////////////////////
+// simdLevelName()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Name the instruction set that the kernels use on this machine.
+///\return  "AVX2", "SSE2" or "scalar".
+///\remarks Meant for logging and statistics.
+////////////////////////////////////////////////////////////////////////////////
+const char* simdLevelName();
+
+#endif // #ifndef __SAMPLEKERNELS_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
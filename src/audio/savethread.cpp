@@ -0,0 +1,435 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    savethread.cpp
+///\ingroup bruo
+///\brief   Background save of a play list.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "savethread.h"
+#include "sndfileio.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Frames per block and number of blocks in flight:
+static const int s_blockFrames = 262144;
+static const int s_blockCount  = 4;
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::ReadStage::ReadStage()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] owner: The save that we are working for.
+////////////////////////////////////////////////////////////////////////////////
+SaveThread::ReadStage::ReadStage(SaveThread* owner) :
+  m_owner(owner)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::ReadStage::run()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   The actual thread function.
+////////////////////////////////////////////////////////////////////////////////
+void SaveThread::ReadStage::run()
+{
+  // Feed the write stage:
+  m_owner->readBlocks();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::SaveThread()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] parent: Parent for this instance.
+////////////////////////////////////////////////////////////////////////////////
+SaveThread::SaveThread(QObject* parent) :
+  QThread(parent),
+  m_format(0),
+  m_numChannels(0),
+  m_sampleRate(0.0),
+  m_sampleCount(0),
+  m_canceled(0),
+  m_succeeded(false),
+  m_wasCanceled(false),
+  m_blocks(s_blockCount),
+  m_readStage(this)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::~SaveThread()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Cancels a running save.
+////////////////////////////////////////////////////////////////////////////////
+SaveThread::~SaveThread()
+{
+  // Stop saving:
+  cancel();
+  wait();
+
+  // Release pieces:
+  qDeleteAll(m_snippets);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::startSave()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Start writing pieces to a file.
+///\param   [in] snippets:    The pieces to write, the thread takes them over.
+///\param   [in] fileName:    The target file.
+///\param   [in] format:      Id of the file format.
+///\param   [in] numChannels: Number of channels of the pieces.
+///\param   [in] sampleRate:  Samples per second of the pieces.
+///\return  true if the save was started or false if one is still running.
+///\remarks The pieces are a snapshot, so the document can be edited while
+///         it's saved. The finished() signal is emitted when done.
+////////////////////////////////////////////////////////////////////////////////
+bool SaveThread::startSave(const QList<SubSnippet*>& snippets, const QString& fileName, int format, int numChannels, double sampleRate)
+{
+  // Only one save at a time:
+  if (isRunning())
+    return false;
+
+  // Take the new job:
+  qDeleteAll(m_snippets);
+  m_snippets    = snippets;
+  m_fileName    = fileName;
+  m_format      = format;
+  m_numChannels = numChannels;
+  m_sampleRate  = sampleRate;
+  m_sampleCount = 0;
+  for (int i = 0; i < m_snippets.size(); i++)
+    m_sampleCount += m_snippets[i]->sampleCount();
+
+  // Reset state:
+  m_canceled.store(0);
+  m_succeeded   = false;
+  m_wasCanceled = false;
+  m_lastError   = "";
+
+  // Go:
+  start();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::cancel()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Abort the current save.
+///\remarks The target file is not touched then.
+////////////////////////////////////////////////////////////////////////////////
+void SaveThread::cancel()
+{
+  // Flag abort, the stages check it after every block:
+  m_canceled.store(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::succeeded()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Check the result of the last save.
+///\return  true if the file was written completely.
+////////////////////////////////////////////////////////////////////////////////
+bool SaveThread::succeeded() const
+{
+  // Return result:
+  return m_succeeded;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::canceled()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Check if the last save was stopped by cancel().
+///\return  true if canceled, false if it succeeded or failed.
+////////////////////////////////////////////////////////////////////////////////
+bool SaveThread::canceled() const
+{
+  // Return result:
+  return m_wasCanceled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::fileName()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the target of the last save.
+///\return  The file name.
+////////////////////////////////////////////////////////////////////////////////
+const QString& SaveThread::fileName() const
+{
+  // Return target:
+  return m_fileName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::lastError()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the reason why the last save failed.
+///\return  The error as string.
+////////////////////////////////////////////////////////////////////////////////
+const QString& SaveThread::lastError() const
+{
+  // Return reason:
+  return m_lastError;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::run()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   The actual thread function (the write stage).
+////////////////////////////////////////////////////////////////////////////////
+void SaveThread::run()
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  // Check format:
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  info.channels   = m_numChannels;
+  info.samplerate = qRound(m_sampleRate);
+  info.format     = m_format;
+  if (!sf_format_check(&info))
+  {
+    m_lastError = tr("This file format can't be written.");
+    return;
+  }
+
+  // Open the target, it's written to a temporary file first:
+  QSaveFile file(m_fileName);
+  if (!file.open(QIODevice::WriteOnly))
+  {
+    m_lastError = file.errorString();
+    return;
+  }
+  SNDFILE* handle = openSndFile(&file, SFM_WRITE, &info);
+  if (handle == 0)
+  {
+    m_lastError = QString(sf_strerror(0));
+    file.cancelWriting();
+    return;
+  }
+
+  // Float samples beyond full scale clip in integer files instead of wrapping:
+  sf_command(handle, SFC_SET_CLIPPING, 0, SF_TRUE);
+
+  // Reset the ring and start the read stage:
+  m_freeBlocks.acquire(m_freeBlocks.available());
+  m_usedBlocks.acquire(m_usedBlocks.available());
+  m_freeBlocks.release(s_blockCount);
+  m_readStage.start();
+
+  // Write until the end block arrives:
+  bool ok = true;
+  qint64 written = 0;
+  int lastPercent = -1;
+  for (int index = 0; ; index = (index + 1) % s_blockCount)
+  {
+    // Wait for the next block:
+    m_usedBlocks.acquire();
+    const Block& block = m_blocks[index];
+    if (block.frames <= 0 || m_canceled.load())
+    {
+      ok = block.frames == 0 && !m_canceled.load();
+      break;
+    }
+
+    // Write it and hand it back:
+    qint64 done = writeBlock(handle, block);
+    m_freeBlocks.release();
+    if (done != block.frames)
+    {
+      m_lastError = QString(sf_strerror(handle));
+      ok = false;
+      break;
+    }
+
+    // Report progress:
+    written += done;
+    int percent = static_cast<int>(written * 100 / qMax(m_sampleCount, qint64(1)));
+    if (percent != lastPercent)
+    {
+      lastPercent = percent;
+      emit progress(percent);
+    }
+  }
+
+  // Stop the read stage (it may wait for a free block):
+  if (!ok)
+  {
+    m_canceled.store(1);
+    m_freeBlocks.release(s_blockCount);
+  }
+  m_readStage.wait();
+
+  // Finish the header:
+  sf_close(handle);
+
+  // Leave the target alone on errors:
+  if (!ok)
+  {
+    if (m_lastError.isEmpty())
+    {
+      m_lastError = tr("The save was canceled.");
+      m_wasCanceled = true;
+    }
+    file.cancelWriting();
+    return;
+  }
+
+  // Snippets that still read the target keep the old file:
+  QSharedPointer<QFile> kept;
+  if (!AudioSnippet::keepFile(m_fileName, kept))
+  {
+    m_lastError = tr("The file is still in use and can't be replaced.");
+    file.cancelWriting();
+    return;
+  }
+
+  // Replace the target:
+  if (!file.commit())
+  {
+    m_lastError = file.errorString();
+    AudioSnippet::restoreFile(kept, m_fileName);
+    return;
+  }
+  m_succeeded = true;
+
+  // Log throughput:
+  const qint64 ms = qMax(timer.elapsed(), qint64(1));
+  const double megaBytes = QFileInfo(m_fileName).size() / (1024.0 * 1024.0);
+  qInfo() << "Saved" << m_fileName << ":" << megaBytes << "MB in" << ms << "ms (" << megaBytes * 1000.0 / ms << "MB/s)";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::readBlocks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   The work of the read stage.
+///\remarks Fills the free blocks and finishes with an end block.
+////////////////////////////////////////////////////////////////////////////////
+void SaveThread::readBlocks()
+{
+  // Loop through the pieces:
+  int index = 0;
+  for (int i = 0; i < m_snippets.size(); i++)
+  {
+    SubSnippet* piece = m_snippets[i];
+    qint64 position = 0;
+    while (position < piece->sampleCount())
+    {
+      // Wait for a free block (the write stage frees all of them when it
+      // stops early):
+      m_freeBlocks.acquire();
+      Block& block = m_blocks[index];
+      if (m_canceled.load())
+      {
+        block.frames = -1;
+        m_usedBlocks.release();
+        return;
+      }
+
+      // Fill it:
+      qint64 count = qMin(qint64(s_blockFrames), piece->sampleCount() - position);
+      qint64 done = readBlock(piece, position, count, block);
+      if (done <= 0)
+      {
+        // Read error, this block ends the save:
+        m_lastError = tr("The samples could not be read.");
+        block.frames = -1;
+        m_usedBlocks.release();
+        return;
+      }
+
+      // Pass it on:
+      block.frames = done;
+      m_usedBlocks.release();
+      index = (index + 1) % s_blockCount;
+      position += done;
+    }
+  }
+
+  // Send the end block:
+  m_freeBlocks.acquire();
+  m_blocks[index].frames = 0;
+  m_usedBlocks.release();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::readBlock()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a block of a piece in its native format.
+///\param   [in]  piece:    The piece to read.
+///\param   [in]  position: First frame to read.
+///\param   [in]  count:    Number of frames to read.
+///\param   [out] block:    The block to fill.
+///\return  The number of frames read.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SaveThread::readBlock(SubSnippet* piece, qint64 position, qint64 count, Block& block)
+{
+  // Samples are passed on in their native format, so unchanged parts of a
+  // file are written bit exact (and double files keep their precision):
+  block.format = piece->nativeFormat();
+  const int samples = static_cast<int>(count) * m_numChannels;
+  switch (block.format)
+  {
+  case AudioSnippet::Int16Samples:
+    block.int16.resize(samples);
+    return piece->readRaw(position, count, block.int16.data(), AudioSnippet::SaveReader);
+  case AudioSnippet::Int32Samples:
+    block.int32.resize(samples);
+    return piece->readRaw(position, count, block.int32.data(), AudioSnippet::SaveReader);
+  case AudioSnippet::DoubleSamples:
+    block.float64.resize(samples);
+    return piece->readRaw(position, count, block.float64.data(), AudioSnippet::SaveReader);
+  default:
+    block.float32.resize(samples);
+    return piece->readRaw(position, count, block.float32.data(), AudioSnippet::SaveReader);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SaveThread::writeBlock()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Write a block to the file.
+///\param   [in] handle: The libsndfile handle of the file.
+///\param   [in] block:  The block to write.
+///\return  The number of frames written.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SaveThread::writeBlock(void* handle, const Block& block)
+{
+  // libsndfile converts to the format of the file:
+  SNDFILE* sndFile = static_cast<SNDFILE*>(handle);
+  switch (block.format)
+  {
+  case AudioSnippet::Int16Samples:
+    return sf_writef_short(sndFile, block.int16.constData(), block.frames);
+  case AudioSnippet::Int32Samples:
+    return sf_writef_int(sndFile, block.int32.constData(), block.frames);
+  case AudioSnippet::DoubleSamples:
+    return sf_writef_double(sndFile, block.float64.constData(), block.frames);
+  default:
+    return sf_writef_float(sndFile, block.float32.constData(), block.frames);
+  }
+}
+
+///////////////////////////////// End of File //////////////////////////////////
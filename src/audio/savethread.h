@@ -0,0 +1,238 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    savethread.h
+///\ingroup bruo
+///\brief   Background save of a play list.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __SAVETHREAD_H_INCLUDED__
+#define __SAVETHREAD_H_INCLUDED__
+
+#include <QThread>
+#include <QSemaphore>
+#include "subsnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   SaveThread savethread.h
+///\brief   Helper thread class to write a play list to a file.
+///\remarks The save is a pipeline of two stages: a read stage reads the pieces
+///         in large blocks in their native format and this thread writes them
+///         with the matching sf_writef_*() function, so reading, converting
+///         and writing overlap. The file is written to a temporary file that
+///         only replaces the target when it's complete.
+////////////////////////////////////////////////////////////////////////////////
+class SaveThread : public QThread
+{
+  Q_OBJECT // Qt magic...
+
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::SaveThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] parent: Parent for this instance.
+  //////////////////////////////////////////////////////////////////////////////
+  SaveThread(QObject* parent = 0);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::~SaveThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Cancels a running save.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~SaveThread();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::startSave()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Start writing pieces to a file.
+  ///\param   [in] snippets:    The pieces to write, the thread takes them over.
+  ///\param   [in] fileName:    The target file.
+  ///\param   [in] format:      Id of the file format.
+  ///\param   [in] numChannels: Number of channels of the pieces.
+  ///\param   [in] sampleRate:  Samples per second of the pieces.
+  ///\return  true if the save was started or false if one is still running.
+  ///\remarks The pieces are a snapshot, so the document can be edited while
+  ///         it's saved. The finished() signal is emitted when done.
+  //////////////////////////////////////////////////////////////////////////////
+  bool startSave(const QList<SubSnippet*>& snippets, const QString& fileName, int format, int numChannels, double sampleRate);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::cancel()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Abort the current save.
+  ///\remarks The target file is not touched then.
+  //////////////////////////////////////////////////////////////////////////////
+  void cancel();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::succeeded()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check the result of the last save.
+  ///\return  true if the file was written completely.
+  //////////////////////////////////////////////////////////////////////////////
+  bool succeeded() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::canceled()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check if the last save was stopped by cancel().
+  ///\return  true if canceled, false if it succeeded or failed.
+  //////////////////////////////////////////////////////////////////////////////
+  bool canceled() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::fileName()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the target of the last save.
+  ///\return  The file name.
+  //////////////////////////////////////////////////////////////////////////////
+  const QString& fileName() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::lastError()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the reason why the last save failed.
+  ///\return  The error as string.
+  //////////////////////////////////////////////////////////////////////////////
+  const QString& lastError() const;
+
+signals:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::progress()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   This signal is emitted whenever another percent was written.
+  ///\param   [in] percent: The progress (0..100).
+  //////////////////////////////////////////////////////////////////////////////
+  void progress(int percent);
+
+protected:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::run()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   The actual thread function (the write stage).
+  //////////////////////////////////////////////////////////////////////////////
+  void run();
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  ///\class   SaveThread::ReadStage
+  ///\brief   The thread of the read stage.
+  //////////////////////////////////////////////////////////////////////////////
+  class ReadStage : public QThread
+  {
+  public:
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SaveThread::ReadStage::ReadStage()
+    ////////////////////////////////////////////////////////////////////////////
+    ///\brief   Initialization constructor of this class.
+    ///\param   [in] owner: The save that we are working for.
+    ////////////////////////////////////////////////////////////////////////////
+    ReadStage(SaveThread* owner);
+
+  protected:
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SaveThread::ReadStage::run()
+    ////////////////////////////////////////////////////////////////////////////
+    ///\brief   The actual thread function.
+    ////////////////////////////////////////////////////////////////////////////
+    void run();
+
+  private:
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Member:
+    SaveThread* m_owner; ///> The save that we are working for.
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  // struct SaveThread::Block
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   A block of interleaved frames between the stages.
+  ///\remarks Only the buffer that matches the format is used.
+  //////////////////////////////////////////////////////////////////////////////
+  struct Block
+  {
+    AudioSnippet::SampleFormat format;  ///> Format of the frames.
+    qint64                     frames;  ///> Frames in this block, 0 at the end.
+    QVector<qint16>            int16;   ///> 16 bit frames.
+    QVector<qint32>            int32;   ///> 32 bit frames.
+    QVector<float>             float32; ///> Float frames.
+    QVector<double>            float64; ///> Double frames.
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::readBlocks()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   The work of the read stage.
+  ///\remarks Fills the free blocks and finishes with an end block.
+  //////////////////////////////////////////////////////////////////////////////
+  void readBlocks();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::readBlock()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a block of a piece in its native format.
+  ///\param   [in]  piece:    The piece to read.
+  ///\param   [in]  position: First frame to read.
+  ///\param   [in]  count:    Number of frames to read.
+  ///\param   [out] block:    The block to fill.
+  ///\return  The number of frames read.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 readBlock(SubSnippet* piece, qint64 position, qint64 count, Block& block);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SaveThread::writeBlock()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Write a block to the file.
+  ///\param   [in] handle: The libsndfile handle of the file.
+  ///\param   [in] block:  The block to write.
+  ///\return  The number of frames written.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 writeBlock(void* handle, const Block& block);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  QList<SubSnippet*> m_snippets;    ///> The pieces to write.
+  QString            m_fileName;    ///> The target file.
+  int                m_format;      ///> Id of the file format.
+  int                m_numChannels; ///> Channel count of the pieces.
+  double             m_sampleRate;  ///> Sample rate of the pieces.
+  qint64             m_sampleCount; ///> Total length of the pieces.
+  QAtomicInt         m_canceled;    ///> Stop as soon as possible?
+  bool               m_succeeded;   ///> Was the last save successful?
+  bool               m_wasCanceled; ///> Was the last save canceled?
+  QString            m_lastError;   ///> Why did the last save fail?
+  QVector<Block>     m_blocks;      ///> The ring of blocks between the stages.
+  QSemaphore         m_freeBlocks;  ///> Blocks that the read stage can fill.
+  QSemaphore         m_usedBlocks;  ///> Blocks that the write stage can write.
+  ReadStage          m_readStage;   ///> The thread of the read stage.
+};
+
+#endif // #ifndef __SAVETHREAD_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
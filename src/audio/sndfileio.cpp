@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    sndfileio.cpp
+///\ingroup bruo
+///\brief   libsndfile access to Qt devices.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "sndfileio.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// deviceLength()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Virtual I/O callback: get the size of the file.
+///\param   [in] user: The device.
+///\return  The size in bytes.
+////////////////////////////////////////////////////////////////////////////////
+static sf_count_t deviceLength(void* user)
+{
+  // Return current size:
+  return static_cast<QIODevice*>(user)->size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deviceSeek()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Virtual I/O callback: move the file position.
+///\param   [in] offset: The new position relative to whence.
+///\param   [in] whence: SEEK_SET, SEEK_CUR or SEEK_END.
+///\param   [in] user:   The device.
+///\return  The new position or -1 on error.
+////////////////////////////////////////////////////////////////////////////////
+static sf_count_t deviceSeek(sf_count_t offset, int whence, void* user)
+{
+  // Make position absolute:
+  QIODevice* device = static_cast<QIODevice*>(user);
+  if (whence == SEEK_CUR)
+    offset += device->pos();
+  else if (whence == SEEK_END)
+    offset += device->size();
+
+  // Set new position:
+  if (offset < 0 || !device->seek(offset))
+    return -1;
+  return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deviceRead()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Virtual I/O callback: read from the file.
+///\param   [out] ptr:   Target of the bytes.
+///\param   [in]  count: Number of bytes to read.
+///\param   [in]  user:  The device.
+///\return  The number of bytes read.
+////////////////////////////////////////////////////////////////////////////////
+static sf_count_t deviceRead(void* ptr, sf_count_t count, void* user)
+{
+  // Read bytes:
+  return qMax(qint64(0), static_cast<QIODevice*>(user)->read(static_cast<char*>(ptr), count));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deviceWrite()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Virtual I/O callback: write to the file.
+///\param   [in] ptr:   The bytes to write.
+///\param   [in] count: Number of bytes to write.
+///\param   [in] user:  The device.
+///\return  The number of bytes written.
+////////////////////////////////////////////////////////////////////////////////
+static sf_count_t deviceWrite(const void* ptr, sf_count_t count, void* user)
+{
+  // Write bytes:
+  return qMax(qint64(0), static_cast<QIODevice*>(user)->write(static_cast<const char*>(ptr), count));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deviceTell()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Virtual I/O callback: get the file position.
+///\param   [in] user: The device.
+///\return  The current position.
+////////////////////////////////////////////////////////////////////////////////
+static sf_count_t deviceTell(void* user)
+{
+  // Return current position:
+  return static_cast<QIODevice*>(user)->pos();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// openSndFile()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Open a libsndfile handle on a Qt device.
+///\param   [in]     device: The device to read from or write to.
+///\param   [in]     mode:   SFM_READ, SFM_WRITE or SFM_RDWR.
+///\param   [in,out] info:   The format of the file (see sf_open()).
+///\return  The new handle or 0 on error (see sf_strerror(0) then).
+///\remarks The device must be open and stay alive until sf_close() was called.
+///         This way libsndfile can write into memory (QBuffer) or into a file
+///         that is only replaced when complete (QSaveFile).
+////////////////////////////////////////////////////////////////////////////////
+SNDFILE* openSndFile(QIODevice* device, int mode, SF_INFO* info)
+{
+  // libsndfile copies the callbacks:
+  SF_VIRTUAL_IO io = { deviceLength, deviceSeek, deviceRead, deviceWrite, deviceTell };
+  return sf_open_virtual(&io, mode, info, device);
+}
+
+///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    sndfileio.h
+///\ingroup bruo
+///\brief   libsndfile access to Qt devices.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __SNDFILEIO_H_INCLUDED__
+#define __SNDFILEIO_H_INCLUDED__
+
+#include "bruo.h"
+#include <sndfile.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// openSndFile()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Open a libsndfile handle on a Qt device.
+///\param   [in]     device: The device to read from or write to.
+///\param   [in]     mode:   SFM_READ, SFM_WRITE or SFM_RDWR.
+///\param   [in,out] info:   The format of the file (see sf_open()).
+///\return  The new handle or 0 on error (see sf_strerror(0) then).
+///\remarks The device must be open and stay alive until sf_close() was called.
+///         This way libsndfile can write into memory (QBuffer) or into a file
+///         that is only replaced when complete (QSaveFile).
+////////////////////////////////////////////////////////////////////////////////
+SNDFILE* openSndFile(QIODevice* device, int mode, SF_INFO* info);
+
+#endif // #ifndef __SNDFILEIO_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
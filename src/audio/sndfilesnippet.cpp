@@ -25,23 +25,90 @@
 /// Floor, Boston, MA 02110-1301, USA.
 ////////////////////////////////////////////////////////////////////////////////
 #include "sndfilesnippet.h"
+#include "samplekernels.h"
 #include <sndfile.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 // SndFileSnippet::SndFileSnippet()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief Initialization constructor of this class.
-///\param [in] handle:      The SNDFILE handle.
-///\param [in] numChannels: The number of channels of this snippet.
-///\param [in] numSamples:  The number of sample frames of this document.
+///\brief   Initialization constructor of this class.
+///\param   [in] fileName:    The name of the file (to open more readers).
+///\param   [in] handle:      The SNDFILE handle for the shared reader.
+///\param   [in] numChannels: The number of channels of this snippet.
+///\param   [in] numSamples:  The number of sample frames of this document.
+///\param   [in] format:      The libsndfile format of the file.
+///\remarks The snippet takes over the handle, so it stays valid as long as
+///         any piece refers to the snippet. The playback reader is opened
+///         right away so the audio thread never has to open files.
 ////////////////////////////////////////////////////////////////////////////////
-SndFileSnippet::SndFileSnippet(void* handle, int numChannels, qint64 numSamples) :
+SndFileSnippet::SndFileSnippet(const QString& fileName, void* handle, int numChannels, qint64 numSamples, int format) :
   AudioSnippet(numChannels, numSamples),
-  m_handle(handle),
-  m_tempBuffer(0),
-  m_tempSize(0)
+  m_fileSize(-1),
+  m_format(format),
+  m_nativeFormat(FloatSamples),
+  m_slowSeek(false)
 {
-  // Nothing to do here.
+  // Remember which file this is, reopens must find the same one:
+  QFileInfo info(fileName);
+  m_fileSize = info.size();
+  m_fileTime = info.lastModified();
+  setFileName(fileName);
+
+  // Find the native sample format (formats that decode to 16 bit internally
+  // count as 16 bit):
+  switch (format & SF_FORMAT_SUBMASK)
+  {
+  case SF_FORMAT_PCM_S8:
+  case SF_FORMAT_PCM_U8:
+  case SF_FORMAT_PCM_16:
+  case SF_FORMAT_ULAW:
+  case SF_FORMAT_ALAW:
+  case SF_FORMAT_IMA_ADPCM:
+  case SF_FORMAT_MS_ADPCM:
+  case SF_FORMAT_GSM610:
+    m_nativeFormat = Int16Samples;
+    break;
+  case SF_FORMAT_PCM_24:
+  case SF_FORMAT_PCM_32:
+    m_nativeFormat = Int32Samples;
+    break;
+  case SF_FORMAT_DOUBLE:
+    m_nativeFormat = DoubleSamples;
+    break;
+  default:
+    m_nativeFormat = FloatSamples;
+    break;
+  }
+
+  // FLAC and Ogg files seek by decoding, keep more cursors for them:
+  const int type = format & SF_FORMAT_TYPEMASK;
+  m_slowSeek = type == SF_FORMAT_FLAC || type == SF_FORMAT_OGG;
+
+  // Init read states:
+  for (int i = 0; i < ReaderCount; i++)
+  {
+    ReaderState& state = m_readers[i];
+    memset(state.cursors, 0, sizeof(state.cursors));
+    state.cursorCount     = 0;
+    state.useCounter      = 0;
+    state.ownsHandle      = false;
+    state.openFailed      = false;
+    state.tempBuffer      = 0;
+    state.tempSize        = 0;
+    state.floatTempBuffer = 0;
+    state.floatTempSize   = 0;
+    state.skipBuffer      = 0;
+  }
+  if (handle != 0)
+  {
+    m_readers[SharedReader].cursors[0].handle   = handle;
+    m_readers[SharedReader].cursors[0].position = -1;
+    m_readers[SharedReader].cursorCount         = 1;
+    m_readers[SharedReader].ownsHandle          = true;
+  }
+
+  // Open the playback reader now:
+  openReader(PlaybackReader);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -52,11 +119,9 @@ SndFileSnippet::SndFileSnippet(void* handle, int numChannels, qint64 numSamples)
 ////////////////////////////////////////////////////////////////////////////////
 SndFileSnippet::~SndFileSnippet()
 {
-  // Clear temp buffer:
-  if (m_tempBuffer != 0)
-    delete [] m_tempBuffer;
-  m_tempBuffer = 0;
-  m_tempSize   = 0;
+  // Close all readers:
+  for (int i = 0; i < ReaderCount; i++)
+    closeReader(m_readers[i]);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -66,51 +131,538 @@ SndFileSnippet::~SndFileSnippet()
 ///\param   [in]  offset: Position where to start reading.
 ///\param   [in]  count:  Number of sample frames to read.
 ///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads.
 ///\return  The number of samples frames read.
 ///\remarks If there are no more samples to read zero is returned.
 ////////////////////////////////////////////////////////////////////////////////
-qint64 SndFileSnippet::readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer)
+qint64 SndFileSnippet::readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader reader)
 {
   // Lock access:
-  QMutexLocker locker(&m_mutex);
+  QMutexLocker locker(readerMutex(reader));
+  reader = acquireReader(reader);
+  QMutexLocker sharedLocker(reader == SharedReader ? &m_mutex : 0);
+  ReaderState& state = m_readers[reader];
+
+  // Read as double:
+  return readInterleaved(offset, count, buffer, state, state.tempBuffer, state.tempSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from this snippet, float version.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned. The samples
+///         are read with sf_readf_float(), no double conversion involved.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SndFileSnippet::readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader reader)
+{
+  // Lock access:
+  QMutexLocker locker(readerMutex(reader));
+  reader = acquireReader(reader);
+  QMutexLocker sharedLocker(reader == SharedReader ? &m_mutex : 0);
+  ReaderState& state = m_readers[reader];
+
+  // Read as float:
+  return readInterleaved(offset, count, buffer, state, state.floatTempBuffer, state.floatTempSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::nativeFormat()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the format that this snippet can read without conversion.
+///\return  The native sample format.
+///\remarks Derived from the subformat of the file.
+////////////////////////////////////////////////////////////////////////////////
+AudioSnippet::SampleFormat SndFileSnippet::nativeFormat() const
+{
+  // Return our format:
+  return m_nativeFormat;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved 16 bit sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks Uses sf_readf_short() straight into the target.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SndFileSnippet::readRaw(const qint64 offset, const qint64 count, qint16* frames, Reader reader)
+{
+  return readRawLocked(offset, count, frames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved 32 bit sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks Uses sf_readf_int() straight into the target.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SndFileSnippet::readRaw(const qint64 offset, const qint64 count, qint32* frames, Reader reader)
+{
+  return readRawLocked(offset, count, frames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved float sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks Uses sf_readf_float() straight into the target.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SndFileSnippet::readRaw(const qint64 offset, const qint64 count, float* frames, Reader reader)
+{
+  return readRawLocked(offset, count, frames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved double sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks Uses sf_readf_double() straight into the target.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SndFileSnippet::readRaw(const qint64 offset, const qint64 count, double* frames, Reader reader)
+{
+  return readRawLocked(offset, count, frames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::releaseReader()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Close the files of a private reader.
+///\param   [in] reader: The reader to release.
+///\remarks Slow seeking files keep up to CursorCount handles per reader,
+///         so readers that are only used now and then (the peak workers)
+///         should give them back. The playback reader is never closed, the
+///         audio thread must not open files.
+////////////////////////////////////////////////////////////////////////////////
+void SndFileSnippet::releaseReader(Reader reader)
+{
+  // Only private readers own files:
+  QMutex* mutex = readerMutex(reader);
+  if (mutex == 0 || reader == PlaybackReader)
+    return;
+
+  // Close them, the next read opens the file again:
+  QMutexLocker locker(mutex);
+  closeReader(m_readers[reader]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::acquireReader()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Get the read state for a reader, opening its file if needed.
+///\param   [in] reader: The requested reader.
+///\return  The reader that can actually be used.
+///\remarks Falls back to the shared reader if the file can't be opened
+///         again. The caller must hold the mutex of the requested reader
+///         (see readerMutex()) and lock the shared reader if that one is
+///         returned.
+////////////////////////////////////////////////////////////////////////////////
+AudioSnippet::Reader SndFileSnippet::acquireReader(Reader reader)
+{
+  // Parameter check:
+  if (reader <= SharedReader || reader >= ReaderCount)
+    return SharedReader;
+
+  // Open on first use:
+  ReaderState& state = m_readers[reader];
+  if (state.cursorCount == 0 && !state.openFailed)
+    openReader(reader);
+
+  // Return the usable reader:
+  return state.cursorCount != 0 ? reader : SharedReader;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readerMutex()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the mutex of a private reader.
+///\param   [in] reader: The requested reader.
+///\return  The mutex or 0 for the shared reader.
+///\remarks Private readers are private to a role, not to a document. As
+///         the play lists of several documents can refer to the same
+///         snippet, they need a lock as well. It's uncontended as long
+///         as only one document reads.
+////////////////////////////////////////////////////////////////////////////////
+QMutex* SndFileSnippet::readerMutex(Reader reader)
+{
+  // Parameter check:
+  if (reader <= SharedReader || reader >= ReaderCount)
+    return 0;
+
+  // Return the reader's mutex:
+  return &m_readers[reader].mutex;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::openReader()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Open a private file handle for a reader.
+///\param   [in] reader: The reader to open.
+////////////////////////////////////////////////////////////////////////////////
+void SndFileSnippet::openReader(Reader reader)
+{
+  // Already open?
+  ReaderState& state = m_readers[reader];
+  if (state.cursorCount != 0 || state.openFailed)
+    return;
+
+  // Open the file again:
+  void* handle = openFile();
+
+  // Update state:
+  state.cursors[0].handle   = handle;
+  state.cursors[0].position = 0;
+  state.cursorCount         = handle != 0 ? 1 : 0;
+  state.ownsHandle          = handle != 0;
+  state.openFailed          = handle == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::closeReader()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Close the files and free the buffers of a read state.
+///\param   [in,out] state: The read state to reset.
+///\remarks The caller must own the read state.
+////////////////////////////////////////////////////////////////////////////////
+void SndFileSnippet::closeReader(ReaderState& state)
+{
+  // Close files:
+  for (int j = 0; j < state.cursorCount; j++)
+  {
+    if (j > 0 || state.ownsHandle)
+      sf_close(static_cast<SNDFILE*>(state.cursors[j].handle));
+    state.cursors[j].handle = 0;
+  }
+  state.cursorCount = 0;
+  state.ownsHandle  = false;
+  state.openFailed  = false;
 
+  // Clear temp buffers:
+  if (state.tempBuffer != 0)
+    delete [] state.tempBuffer;
+  if (state.floatTempBuffer != 0)
+    delete [] state.floatTempBuffer;
+  if (state.skipBuffer != 0)
+    delete [] state.skipBuffer;
+  state.tempBuffer      = 0;
+  state.tempSize        = 0;
+  state.floatTempBuffer = 0;
+  state.floatTempSize   = 0;
+  state.skipBuffer      = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::openFile()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Open the file of this snippet once more.
+///\return  The new SNDFILE handle or 0 on failure.
+///\remarks Fails if the file isn't the one the snippet was made from (its
+///         size, time stamp or format changed in the meantime).
+////////////////////////////////////////////////////////////////////////////////
+void* SndFileSnippet::openFile() const
+{
+  // Sanity check (the name changes if the file is kept aside by a save):
+  const QString name = fileName();
+  if (name.isEmpty())
+    return 0;
+
+  // Refuse a file that was rewritten:
+  QFileInfo file(name);
+  if (file.size() != m_fileSize || file.lastModified() != m_fileTime)
+    return 0;
+
+  // Open the file again:
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  QByteArray fn = name.toLocal8Bit();
+  SNDFILE* handle = sf_open(fn, SFM_READ, &info);
+
+  // Make sure that it is still the same file:
+  if (handle != 0 && (info.channels != channelCount() || info.frames != sampleCount() || info.format != m_format))
+  {
+    sf_close(handle);
+    handle = 0;
+  }
+
+  // Return the handle:
+  return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::pickCursor()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Select the cursor of a reader that serves a read best.
+///\param   [in,out] state:  The read state to pick from.
+///\param   [in]     offset: Position where the read starts.
+///\return  Index of the cursor to use.
+///\remarks Prefers a cursor that is parked at or shortly before the offset.
+///         For slow seeking files another cursor is opened if there is
+///         none, otherwise the least recently used one is recycled. A
+///         recycled cursor pays a full sf_seek(): libsndfile has no
+///         decoder state or byte offsets that a seek index could restore.
+////////////////////////////////////////////////////////////////////////////////
+int SndFileSnippet::pickCursor(ReaderState& state, const qint64 offset)
+{
+  // Find the closest cursor in front of the offset (only exact matches
+  // count if seeking is cheap):
+  int best = -1;
+  qint64 bestDistance = m_slowSeek ? SkipWindow : 0;
+  for (int i = 0; i < state.cursorCount; i++)
+  {
+    const qint64 position = state.cursors[i].position;
+    if (position >= 0 && position <= offset && offset - position <= bestDistance)
+    {
+      best = i;
+      bestDistance = offset - position;
+    }
+  }
+  if (best >= 0)
+    return best;
+
+  // Park another decoder at the new position instead of moving away one
+  // that might be needed again:
+  if (m_slowSeek && state.cursorCount < CursorCount)
+  {
+    void* handle = openFile();
+    if (handle != 0)
+    {
+      Cursor& cursor = state.cursors[state.cursorCount];
+      cursor.handle   = handle;
+      cursor.position = 0;
+      cursor.lastUse  = 0;
+      return state.cursorCount++;
+    }
+  }
+
+  // Recycle the least recently used cursor:
+  int oldest = 0;
+  for (int i = 1; i < state.cursorCount; i++)
+  {
+    if (state.cursors[i].lastUse < state.cursors[oldest].lastUse)
+      oldest = i;
+  }
+  return oldest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::skipFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move a cursor forward by decoding and dropping frames.
+///\param   [in,out] cursor: The cursor to move.
+///\param   [in]     offset: The target position.
+///\param   [in,out] state:  The read state that owns the cursor.
+///\remarks Stops early at the end of the file, the caller has to check
+///         the resulting position.
+////////////////////////////////////////////////////////////////////////////////
+void SndFileSnippet::skipFrames(Cursor& cursor, const qint64 offset, ReaderState& state)
+{
+  // Create scratch buffer on first use:
+  if (state.skipBuffer == 0)
+    state.skipBuffer = new float[SkipChunk * channelCount()];
+
+  // Decode until we're there:
+  SNDFILE* handle = static_cast<SNDFILE*>(cursor.handle);
+  while (cursor.position < offset)
+  {
+    sf_count_t numRead = sf_readf_float(handle, state.skipBuffer, qMin(offset - cursor.position, qint64(SkipChunk)));
+    if (numRead <= 0)
+      break;
+    cursor.position += numRead;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readFileFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief  Read interleaved frames in the matching libsndfile format.
+///\param  [in]  handle: The file to read from.
+///\param  [out] ptr:    Target buffer.
+///\param  [in]  frames: Number of frames to read.
+///\return The number of frames read.
+////////////////////////////////////////////////////////////////////////////////
+static inline sf_count_t readFileFrames(SNDFILE* handle, double* ptr, sf_count_t frames)
+{
+  return sf_readf_double(handle, ptr, frames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readFileFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief  Read interleaved frames in the matching libsndfile format.
+///\param  [in]  handle: The file to read from.
+///\param  [out] ptr:    Target buffer.
+///\param  [in]  frames: Number of frames to read.
+///\return The number of frames read.
+////////////////////////////////////////////////////////////////////////////////
+static inline sf_count_t readFileFrames(SNDFILE* handle, float* ptr, sf_count_t frames)
+{
+  return sf_readf_float(handle, ptr, frames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readFileFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief  Read interleaved frames in the matching libsndfile format.
+///\param  [in]  handle: The file to read from.
+///\param  [out] ptr:    Target buffer.
+///\param  [in]  frames: Number of frames to read.
+///\return The number of frames read.
+////////////////////////////////////////////////////////////////////////////////
+static inline sf_count_t readFileFrames(SNDFILE* handle, qint16* ptr, sf_count_t frames)
+{
+  return sf_readf_short(handle, ptr, frames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readFileFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief  Read interleaved frames in the matching libsndfile format.
+///\param  [in]  handle: The file to read from.
+///\param  [out] ptr:    Target buffer.
+///\param  [in]  frames: Number of frames to read.
+///\return The number of frames read.
+////////////////////////////////////////////////////////////////////////////////
+static inline sf_count_t readFileFrames(SNDFILE* handle, qint32* ptr, sf_count_t frames)
+{
+  return sf_readf_int(handle, ptr, frames);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readFrames()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Seek if needed and read interleaved frames with a read state.
+///\param   [in]     offset: Position where to start reading.
+///\param   [in]     count:  Number of sample frames to read.
+///\param   [out]    frames: Target for count * channelCount() samples.
+///\param   [in,out] state:  The read state to use.
+///\return  The number of samples frames read.
+///\remarks The caller must own the read state. On FLAC and Ogg files a seek
+///         decodes from far back, so short jumps ahead are decoded instead
+///         and every reader keeps a few cursors parked at the positions it
+///         visits. A random read then costs at most SkipWindow frames of
+///         decoding as long as it lands close behind one of them.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+qint64 SndFileSnippet::readFrames(const qint64 offset, const qint64 count, T* frames, ReaderState& state)
+{
+  // Sanity check:
+  if (state.cursorCount == 0 || count <= 0)
+    return 0;
+
+  // Get the decoder to use:
+  Cursor& cursor = state.cursors[pickCursor(state, offset)];
+  cursor.lastUse = ++state.useCounter;
+  SNDFILE* handle = static_cast<SNDFILE*>(cursor.handle);
+
+  // Decode forward on short jumps if seeking is expensive:
+  if (m_slowSeek && cursor.position >= 0 && cursor.position < offset && offset - cursor.position <= SkipWindow)
+    skipFrames(cursor, offset, state);
+
+  // Seek to position (sequential reads don't need to):
+  if (cursor.position != offset)
+    cursor.position = sf_seek(handle, offset, SEEK_SET);
+
+  // Read the samples:
+  qint64 numRead = readFileFrames(handle, frames, count);
+  cursor.position = (cursor.position >= 0 && numRead >= 0) ? cursor.position + numRead : -1;
+
+  // Return number of frames read:
+  return qMax(numRead, qint64(0));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readRawLocked()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Shared implementation of the readRaw() versions.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks Takes the mutex of the reader that is actually used.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+qint64 SndFileSnippet::readRawLocked(const qint64 offset, const qint64 count, T* frames, Reader reader)
+{
+  // Lock access:
+  QMutexLocker locker(readerMutex(reader));
+  reader = acquireReader(reader);
+  QMutexLocker sharedLocker(reader == SharedReader ? &m_mutex : 0);
+
+  // Read:
+  return readFrames(offset, count, frames, m_readers[reader]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SndFileSnippet::readInterleaved()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Shared implementation of both readSamples() versions.
+///\param   [in]     offset:     Position where to start reading.
+///\param   [in]     count:      Number of sample frames to read.
+///\param   [out]    buffer:     The target buffer for the samples.
+///\param   [in,out] state:      The read state to use.
+///\param   [in,out] tempBuffer: Interleaved temp buffer for this format.
+///\param   [in,out] tempSize:   Size of the temp buffer.
+///\return  The number of samples frames read.
+///\remarks The caller must own the read state.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+qint64 SndFileSnippet::readInterleaved(const qint64 offset, const qint64 count, SampleBufferT<T>& buffer, ReaderState& state, T*& tempBuffer, size_t& tempSize)
+{
   // Sanity check:
-  if (static_cast<SNDFILE*>(m_handle) == 0)
+  if (state.cursorCount == 0)
     return 0;
 
   // Calc required buffer size:
   size_t size = count * channelCount();
-  if (size > m_tempSize)
+  if (size > tempSize)
   {
     // Delete old buffer:
-    if (m_tempBuffer != 0)
-      delete [] m_tempBuffer;
+    if (tempBuffer != 0)
+      delete [] tempBuffer;
 
     // Create new temp buffer:
-    m_tempBuffer = new double[size];
-    m_tempSize = size;
+    tempBuffer = new T[size];
+    tempSize = size;
   }
 
-  // Seek to position:
-  sf_seek(static_cast<SNDFILE*>(m_handle), offset, SEEK_SET);
-
   // Read the samples:
-  qint64 readFrames = sf_readf_double(static_cast<SNDFILE*>(m_handle), m_tempBuffer, count);
+  qint64 numRead = readFrames(offset, count, tempBuffer, state);
 
-  // Deinterleave data:
+  // Deinterleave data straight into the channel buffers:
   int numChannels = channelCount();
-  double* buff = m_tempBuffer;
-  for (int i = 0; i < readFrames; i++)
-  {
-    for (int j = 0; j < numChannels; j++)
-    {
-      buffer.setSample(j, i, *buff);
-      buff++;
-    }
-  }
+  assert(buffer.channelCount() >= numChannels && buffer.sampleCount() >= numRead);
+  QVarLengthArray<T*, 8> channels(numChannels);
+  for (int j = 0; j < numChannels; j++)
+    channels[j] = buffer.sampleBuffer(j);
+  deinterleave(tempBuffer, channels.constData(), numChannels, numRead);
 
   // Return number of frames read:
-  return readFrames;
+  return numRead;
 }
 
 ///////////////////////////////// End of File //////////////////////////////////
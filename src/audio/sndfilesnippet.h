@@ -41,12 +41,17 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   // SndFileSnippet::SndFileSnippet()
   //////////////////////////////////////////////////////////////////////////////
-  ///\brief Initialization constructor of this class.
-  ///\param [in] handle:      The SNDFILE handle.
-  ///\param [in] numChannels: The number of channels of this snippet.
-  ///\param [in] numSamples:  The number of sample frames of this document.
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] fileName:    The name of the file (to open more readers).
+  ///\param   [in] handle:      The SNDFILE handle for the shared reader.
+  ///\param   [in] numChannels: The number of channels of this snippet.
+  ///\param   [in] numSamples:  The number of sample frames of this document.
+  ///\param   [in] format:      The libsndfile format of the file.
+  ///\remarks The snippet takes over the handle, so it stays valid as long as
+  ///         any piece refers to the snippet. The playback reader is opened
+  ///         right away so the audio thread never has to open files.
   //////////////////////////////////////////////////////////////////////////////
-  SndFileSnippet(void* handle, int numChannels, qint64 numSamples);
+  SndFileSnippet(const QString& fileName, void* handle, int numChannels, qint64 numSamples, int format);
 
   //////////////////////////////////////////////////////////////////////////////
   // SndFileSnippet::~SndFileSnippet()
@@ -63,19 +68,272 @@ public:
   ///\param   [in]  offset: Position where to start reading.
   ///\param   [in]  count:  Number of sample frames to read.
   ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads.
   ///\return  The number of samples frames read.
   ///\remarks If there are no more samples to read zero is returned.
   //////////////////////////////////////////////////////////////////////////////
-  virtual qint64 readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer);
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from this snippet, float version.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned. The samples
+  ///         are read with sf_readf_float(), no double conversion involved.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::nativeFormat()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the format that this snippet can read without conversion.
+  ///\return  The native sample format.
+  ///\remarks Derived from the subformat of the file.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual SampleFormat nativeFormat() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved 16 bit sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks Uses sf_readf_short() straight into the target.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, qint16* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved 32 bit sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks Uses sf_readf_int() straight into the target.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, qint32* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved float sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks Uses sf_readf_float() straight into the target.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, float* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved double sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks Uses sf_readf_double() straight into the target.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, double* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::releaseReader()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Close the files of a private reader.
+  ///\param   [in] reader: The reader to release.
+  ///\remarks Slow seeking files keep up to CursorCount handles per reader,
+  ///         so readers that are only used now and then (the peak workers)
+  ///         should give them back. The playback reader is never closed, the
+  ///         audio thread must not open files.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual void releaseReader(Reader reader);
 
 private:
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Constants:
+  static const int    CursorCount = 4;     ///> Max decoders per reader.
+  static const qint64 SkipWindow  = 65536; ///> Max frames to decode instead of seeking.
+  static const int    SkipChunk   = 4096;  ///> Frames per decode-and-discard step.
+
+  //////////////////////////////////////////////////////////////////////////////
+  // struct SndFileSnippet::Cursor
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief One open decoder and the position it is parked at.
+  //////////////////////////////////////////////////////////////////////////////
+  struct Cursor
+  {
+    void*   handle;   ///> The SND file handle of this cursor.
+    qint64  position; ///> Current file position (to skip seeks).
+    quint32 lastUse;  ///> Use stamp for recycling the oldest cursor.
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  // struct SndFileSnippet::ReaderState
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief The private read state of one reader.
+  //////////////////////////////////////////////////////////////////////////////
+  struct ReaderState
+  {
+    Cursor  cursors[CursorCount]; ///> The decoders of this reader.
+    int     cursorCount;          ///> Number of open cursors.
+    quint32 useCounter;           ///> Source of the cursor use stamps.
+    bool    ownsHandle;           ///> Do we have to close the first handle?
+    bool    openFailed;           ///> Opening failed, use the shared reader.
+    double* tempBuffer;           ///> Temporary buffer.
+    size_t  tempSize;             ///> Size of the temporary buffer.
+    float*  floatTempBuffer;      ///> Temporary buffer for float reads.
+    size_t  floatTempSize;        ///> Size of the float temporary buffer.
+    float*  skipBuffer;           ///> Scratch buffer for decoding forward.
+    QMutex  mutex;                ///> Access mutex of a private reader.
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::acquireReader()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Get the read state for a reader, opening its file if needed.
+  ///\param   [in] reader: The requested reader.
+  ///\return  The reader that can actually be used.
+  ///\remarks Falls back to the shared reader if the file can't be opened
+  ///         again. The caller must hold the mutex of the requested reader
+  ///         (see readerMutex()) and lock the shared reader if that one is
+  ///         returned.
+  //////////////////////////////////////////////////////////////////////////////
+  Reader acquireReader(Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readerMutex()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the mutex of a private reader.
+  ///\param   [in] reader: The requested reader.
+  ///\return  The mutex or 0 for the shared reader.
+  ///\remarks Private readers are private to a role, not to a document. As
+  ///         the play lists of several documents can refer to the same
+  ///         snippet, they need a lock as well. It's uncontended as long
+  ///         as only one document reads.
+  //////////////////////////////////////////////////////////////////////////////
+  QMutex* readerMutex(Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::openReader()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Open a private file handle for a reader.
+  ///\param   [in] reader: The reader to open.
+  //////////////////////////////////////////////////////////////////////////////
+  void openReader(Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::closeReader()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Close the files and free the buffers of a read state.
+  ///\param   [in,out] state: The read state to reset.
+  ///\remarks The caller must own the read state.
+  //////////////////////////////////////////////////////////////////////////////
+  void closeReader(ReaderState& state);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::openFile()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Open the file of this snippet once more.
+  ///\return  The new SNDFILE handle or 0 on failure.
+  ///\remarks Fails if the file isn't the one the snippet was made from (its
+  ///         size, time stamp or format changed in the meantime).
+  //////////////////////////////////////////////////////////////////////////////
+  void* openFile() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::pickCursor()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Select the cursor of a reader that serves a read best.
+  ///\param   [in,out] state:  The read state to pick from.
+  ///\param   [in]     offset: Position where the read starts.
+  ///\return  Index of the cursor to use.
+  ///\remarks Prefers a cursor that is parked at or shortly before the offset.
+  ///         For slow seeking files another cursor is opened if there is
+  ///         none, otherwise the least recently used one is recycled. A
+  ///         recycled cursor pays a full sf_seek(): libsndfile has no
+  ///         decoder state or byte offsets that a seek index could restore.
+  //////////////////////////////////////////////////////////////////////////////
+  int pickCursor(ReaderState& state, const qint64 offset);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::skipFrames()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move a cursor forward by decoding and dropping frames.
+  ///\param   [in,out] cursor: The cursor to move.
+  ///\param   [in]     offset: The target position.
+  ///\param   [in,out] state:  The read state that owns the cursor.
+  ///\remarks Stops early at the end of the file, the caller has to check
+  ///         the resulting position.
+  //////////////////////////////////////////////////////////////////////////////
+  void skipFrames(Cursor& cursor, const qint64 offset, ReaderState& state);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readFrames()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Seek if needed and read interleaved frames with a read state.
+  ///\param   [in]     offset: Position where to start reading.
+  ///\param   [in]     count:  Number of sample frames to read.
+  ///\param   [out]    frames: Target for count * channelCount() samples.
+  ///\param   [in,out] state:  The read state to use.
+  ///\return  The number of samples frames read.
+  ///\remarks The caller must own the read state.
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  qint64 readFrames(const qint64 offset, const qint64 count, T* frames, ReaderState& state);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readRawLocked()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Shared implementation of the readRaw() versions.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks Takes the mutex of the reader that is actually used.
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  qint64 readRawLocked(const qint64 offset, const qint64 count, T* frames, Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SndFileSnippet::readInterleaved()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Shared implementation of both readSamples() versions.
+  ///\param   [in]     offset:     Position where to start reading.
+  ///\param   [in]     count:      Number of sample frames to read.
+  ///\param   [out]    buffer:     The target buffer for the samples.
+  ///\param   [in,out] state:      The read state to use.
+  ///\param   [in,out] tempBuffer: Interleaved temp buffer for this format.
+  ///\param   [in,out] tempSize:   Size of the temp buffer.
+  ///\return  The number of samples frames read.
+  ///\remarks The caller must own the read state.
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  qint64 readInterleaved(const qint64 offset, const qint64 count, SampleBufferT<T>& buffer, ReaderState& state, T*& tempBuffer, size_t& tempSize);
+
   //////////////////////////////////////////////////////////////////////////////
   // Member:
-  void*   m_handle;     ///> The SND file handle.
-  double* m_tempBuffer; ///> Temporary buffer.
-  size_t  m_tempSize;   ///> Size of the temporary buffer.
-  QMutex  m_mutex;      ///> File access mutex.
+  qint64       m_fileSize;             ///> Size of the file when opened.
+  QDateTime    m_fileTime;             ///> Time stamp of the file then.
+  int          m_format;               ///> The libsndfile format of the file.
+  SampleFormat m_nativeFormat;         ///> Format of the file's samples.
+  bool         m_slowSeek;             ///> Is seeking expensive (FLAC, Ogg)?
+  ReaderState  m_readers[ReaderCount]; ///> Read state of every reader.
+  QMutex       m_mutex;                ///> Access mutex of the shared reader.
 };
 
 #endif // #ifndef __SNDFILESNIPPET_H_INCLUDED__
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    subsnippet.cpp
+///\ingroup bruo
+///\brief   A range of another snippet.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "subsnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::SubSnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] source: The snippet that holds the samples.
+///\param   [in] start:  First frame of the range in the source.
+///\param   [in] length: Number of frames of the range.
+///\remarks The range must be inside of the source.
+////////////////////////////////////////////////////////////////////////////////
+SubSnippet::SubSnippet(const QSharedPointer<AudioSnippet>& source, qint64 start, qint64 length) :
+  AudioSnippet(source->channelCount(), length),
+  m_source(source),
+  m_start(start)
+{
+  // Sanity check:
+  assert(start >= 0 && length >= 0 && start + length <= source->sampleCount());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::~SubSnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Releases the source.
+////////////////////////////////////////////////////////////////////////////////
+SubSnippet::~SubSnippet()
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::source()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the source of this piece.
+///\return  The snippet that holds the samples.
+////////////////////////////////////////////////////////////////////////////////
+const QSharedPointer<AudioSnippet>& SubSnippet::source() const
+{
+  // Return our source:
+  return m_source;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::start()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the start of this piece in the source.
+///\return  The first source frame of this piece.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SubSnippet::start() const
+{
+  // Return our start:
+  return m_start;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SubSnippet::readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader reader)
+{
+  // Forward to the source:
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+  return m_source->readSamples(m_start + offset, numFrames, buffer, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a number of samples frames from this snippet, float version.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] buffer: The target buffer for the samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SubSnippet::readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader reader)
+{
+  // Forward to the source:
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+  return m_source->readSamples(m_start + offset, numFrames, buffer, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::nativeFormat()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the format that this snippet can read without conversion.
+///\return  The native sample format.
+///\remarks Same as the source.
+////////////////////////////////////////////////////////////////////////////////
+AudioSnippet::SampleFormat SubSnippet::nativeFormat() const
+{
+  // Ask the source:
+  return m_source->nativeFormat();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved 16 bit sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SubSnippet::readRaw(const qint64 offset, const qint64 count, qint16* frames, Reader reader)
+{
+  // Forward to the source:
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+  return m_source->readRaw(m_start + offset, numFrames, frames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved 32 bit sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SubSnippet::readRaw(const qint64 offset, const qint64 count, qint32* frames, Reader reader)
+{
+  // Forward to the source:
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+  return m_source->readRaw(m_start + offset, numFrames, frames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved float sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SubSnippet::readRaw(const qint64 offset, const qint64 count, float* frames, Reader reader)
+{
+  // Forward to the source:
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+  return m_source->readRaw(m_start + offset, numFrames, frames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::readRaw()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read interleaved double sample frames from this snippet.
+///\param   [in]  offset: Position where to start reading.
+///\param   [in]  count:  Number of sample frames to read.
+///\param   [out] frames: Target for count * channelCount() samples.
+///\param   [in]  reader: The consumer that reads.
+///\return  The number of samples frames read.
+///\remarks If there are no more samples to read zero is returned.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SubSnippet::readRaw(const qint64 offset, const qint64 count, double* frames, Reader reader)
+{
+  // Forward to the source:
+  const qint64 numFrames = clipCount(offset, count);
+  if (numFrames <= 0)
+    return 0;
+  return m_source->readRaw(m_start + offset, numFrames, frames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SubSnippet::clipCount()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Limit a read to the range of this piece.
+///\param   [in] offset: Position where to start reading.
+///\param   [in] count:  Number of sample frames to read.
+///\return  The number of frames that can be read.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SubSnippet::clipCount(const qint64 offset, const qint64 count) const
+{
+  // Outside of our range?
+  if (offset < 0 || offset >= sampleCount())
+    return 0;
+
+  // Clip to the end:
+  return qMin(count, sampleCount() - offset);
+}
+
+///////////////////////////////// End of File //////////////////////////////////
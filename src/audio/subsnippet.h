@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    subsnippet.h
+///\ingroup bruo
+///\brief   A range of another snippet.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __SUBSNIPPET_H_INCLUDED__
+#define __SUBSNIPPET_H_INCLUDED__
+
+#include <QSharedPointer>
+#include "audiosnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   SubSnippet subsnippet.h
+///\brief   A piece of the document's play list that shows a range of a source.
+///\remarks Sub snippets never copy samples, they just forward all reads to
+///         their source with an offset. Many pieces can share the same source
+///         (the file or a memory snippet), so the sources are reference
+///         counted and live as long as any piece uses them.
+////////////////////////////////////////////////////////////////////////////////
+class SubSnippet :
+  public AudioSnippet
+{
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::SubSnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] source: The snippet that holds the samples.
+  ///\param   [in] start:  First frame of the range in the source.
+  ///\param   [in] length: Number of frames of the range.
+  ///\remarks The range must be inside of the source.
+  //////////////////////////////////////////////////////////////////////////////
+  SubSnippet(const QSharedPointer<AudioSnippet>& source, qint64 start, qint64 length);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::~SubSnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Releases the source.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~SubSnippet();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::source()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the source of this piece.
+  ///\return  The snippet that holds the samples.
+  //////////////////////////////////////////////////////////////////////////////
+  const QSharedPointer<AudioSnippet>& source() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::start()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the start of this piece in the source.
+  ///\return  The first source frame of this piece.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 start() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, SampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a number of samples frames from this snippet, float version.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] buffer: The target buffer for the samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readSamples(const qint64 offset, const qint64 count, FloatSampleBuffer& buffer, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::nativeFormat()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the format that this snippet can read without conversion.
+  ///\return  The native sample format.
+  ///\remarks Same as the source.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual SampleFormat nativeFormat() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved 16 bit sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, qint16* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved 32 bit sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, qint32* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved float sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, float* frames, Reader reader = SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::readRaw()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read interleaved double sample frames from this snippet.
+  ///\param   [in]  offset: Position where to start reading.
+  ///\param   [in]  count:  Number of sample frames to read.
+  ///\param   [out] frames: Target for count * channelCount() samples.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The number of samples frames read.
+  ///\remarks If there are no more samples to read zero is returned.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 readRaw(const qint64 offset, const qint64 count, double* frames, Reader reader = SharedReader);
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SubSnippet::clipCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Limit a read to the range of this piece.
+  ///\param   [in] offset: Position where to start reading.
+  ///\param   [in] count:  Number of sample frames to read.
+  ///\return  The number of frames that can be read.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 clipCount(const qint64 offset, const qint64 count) const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  QSharedPointer<AudioSnippet> m_source; ///> The snippet with the samples.
+  qint64                       m_start;  ///> Start of the range in the source.
+};
+
+#endif // #ifndef __SUBSNIPPET_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
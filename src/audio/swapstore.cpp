@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    swapstore.cpp
+///\ingroup bruo
+///\brief   Temporary file store implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "swapstore.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Alignment of the allocations (a memory page):
+static const qint64 s_pageSize = 4096;
+
+////////////////////////////////////////////////////////////////////////////////
+// SwapStore::SwapStore()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Default constructor of this class.
+///\remarks The file is created on the first allocation.
+////////////////////////////////////////////////////////////////////////////////
+SwapStore::SwapStore() :
+  m_file(QDir::temp().filePath("bruo_swap_XXXXXX.tmp")),
+  m_end(0),
+  m_used(0)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SwapStore::~SwapStore()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Unmaps everything and removes the file.
+////////////////////////////////////////////////////////////////////////////////
+SwapStore::~SwapStore()
+{
+  // Nothing to do here, QTemporaryFile unmaps and removes the file.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SwapStore::allocate()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Reserve space in the file.
+///\param   [in] size: Number of bytes to reserve.
+///\return  The offset of the space or -1 on error.
+///\remarks Allocations start at page boundaries, so every region can be
+///         mapped on its own. The smallest free region that fits is used,
+///         the file only grows if there is none.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SwapStore::allocate(qint64 size)
+{
+  // Sanity check:
+  if (size <= 0)
+    return -1;
+  const qint64 pages = ((size + s_pageSize - 1) / s_pageSize) * s_pageSize;
+
+  // Create the file on first use:
+  QMutexLocker locker(&m_mutex);
+  if (!m_file.isOpen() && !m_file.open())
+    return -1;
+
+  // Find the smallest free region that fits:
+  QMap<qint64, qint64>::iterator best = m_free.end();
+  for (QMap<qint64, qint64>::iterator it = m_free.begin(); it != m_free.end(); ++it)
+  {
+    if (it.value() >= pages && (best == m_free.end() || it.value() < best.value()))
+      best = it;
+  }
+  if (best != m_free.end())
+  {
+    // Take its start, the rest stays free:
+    const qint64 offset = best.key();
+    const qint64 rest = best.value() - pages;
+    m_free.erase(best);
+    if (rest > 0)
+      m_free.insert(offset + pages, rest);
+    m_used += size;
+    return offset;
+  }
+
+  // Grow the file (sparse on most systems):
+  const qint64 offset = m_end;
+  if (!m_file.resize(offset + pages))
+    return -1;
+  m_end   = offset + pages;
+  m_used += size;
+
+  // Return start of the new space:
+  return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SwapStore::write()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Write into allocated space.
+///\param   [in] offset: Where to write in the file.
+///\param   [in] data:   The bytes to write.
+///\param   [in] size:   Number of bytes to write.
+///\return  true if successful or false otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool SwapStore::write(qint64 offset, const void* data, qint64 size)
+{
+  // Write the bytes:
+  QMutexLocker locker(&m_mutex);
+  if (offset < 0 || offset + size > m_end || !m_file.seek(offset))
+    return false;
+  return m_file.write(static_cast<const char*>(data), size) == size && m_file.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SwapStore::map()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Map a written region for reading.
+///\param   [in] offset: Start of the region as returned by allocate().
+///\param   [in] size:   Size of the region.
+///\return  The address of the region or 0 on error.
+///\remarks Pass the address to release() when done.
+////////////////////////////////////////////////////////////////////////////////
+const uchar* SwapStore::map(qint64 offset, qint64 size)
+{
+  // Map the region:
+  QMutexLocker locker(&m_mutex);
+  if (offset < 0 || offset + size > m_end)
+    return 0;
+  return m_file.map(offset, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SwapStore::release()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Unmap a region that is not used anymore and free its space.
+///\param   [in] offset:  Start of the region as returned by allocate().
+///\param   [in] address: The address returned by map() or 0 if the region
+///                       was never mapped.
+///\param   [in] size:    Size of the region.
+///\remarks The space is merged with free neighbours.
+////////////////////////////////////////////////////////////////////////////////
+void SwapStore::release(qint64 offset, const uchar* address, qint64 size)
+{
+  // Unmap the region:
+  QMutexLocker locker(&m_mutex);
+  if (address != 0)
+    m_file.unmap(const_cast<uchar*>(address));
+  if (offset < 0 || size <= 0)
+    return;
+  m_used -= size;
+
+  // Merge with the free neighbours:
+  qint64 start = offset;
+  qint64 end = offset + ((size + s_pageSize - 1) / s_pageSize) * s_pageSize;
+  QMap<qint64, qint64>::iterator next = m_free.lowerBound(start);
+  if (next != m_free.end() && next.key() == end)
+  {
+    end += next.value();
+    next = m_free.erase(next);
+  }
+  if (next != m_free.begin())
+  {
+    QMap<qint64, qint64>::iterator prev = next - 1;
+    if (prev.key() + prev.value() == start)
+    {
+      start = prev.key();
+      m_free.erase(prev);
+    }
+  }
+
+  // Cut off a free end of the file, keep anything else for later:
+  if (end >= m_end)
+  {
+    m_end = start;
+    m_file.resize(m_end);
+  }
+  else
+    m_free.insert(start, end - start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SwapStore::usedSize()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the number of bytes that are still in use.
+///\return  The size in bytes.
+////////////////////////////////////////////////////////////////////////////////
+qint64 SwapStore::usedSize() const
+{
+  // Return the used size:
+  QMutexLocker locker(&m_mutex);
+  return m_used;
+}
+
+///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    swapstore.h
+///\ingroup bruo
+///\brief   Temporary file store for samples that don't fit into RAM.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __SWAPSTORE_H_INCLUDED__
+#define __SWAPSTORE_H_INCLUDED__
+
+#include "bruo.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   SwapStore swapstore.h
+///\brief   Temporary file for samples that are paged out of RAM.
+///\remarks Every document has one store. Space is allocated in pages and
+///         read back through memory maps, so paged out samples cost address
+///         space but no heap. Released regions go to a free list and are
+///         reused by later allocations, a free end of the file is cut off.
+///         The file is removed with the store.
+////////////////////////////////////////////////////////////////////////////////
+class SwapStore
+{
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SwapStore::SwapStore()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Default constructor of this class.
+  ///\remarks The file is created on the first allocation.
+  //////////////////////////////////////////////////////////////////////////////
+  SwapStore();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SwapStore::~SwapStore()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Unmaps everything and removes the file.
+  //////////////////////////////////////////////////////////////////////////////
+  ~SwapStore();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SwapStore::allocate()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Reserve space in the file.
+  ///\param   [in] size: Number of bytes to reserve.
+  ///\return  The offset of the space or -1 on error.
+  ///\remarks Allocations start at page boundaries, so every region can be
+  ///         mapped on its own. The smallest free region that fits is used,
+  ///         the file only grows if there is none.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 allocate(qint64 size);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SwapStore::write()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Write into allocated space.
+  ///\param   [in] offset: Where to write in the file.
+  ///\param   [in] data:   The bytes to write.
+  ///\param   [in] size:   Number of bytes to write.
+  ///\return  true if successful or false otherwise.
+  //////////////////////////////////////////////////////////////////////////////
+  bool write(qint64 offset, const void* data, qint64 size);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SwapStore::map()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Map a written region for reading.
+  ///\param   [in] offset: Start of the region as returned by allocate().
+  ///\param   [in] size:   Size of the region.
+  ///\return  The address of the region or 0 on error.
+  ///\remarks Pass the address to release() when done.
+  //////////////////////////////////////////////////////////////////////////////
+  const uchar* map(qint64 offset, qint64 size);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SwapStore::release()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Unmap a region that is not used anymore and free its space.
+  ///\param   [in] offset:  Start of the region as returned by allocate().
+  ///\param   [in] address: The address returned by map() or 0 if the region
+  ///                       was never mapped.
+  ///\param   [in] size:    Size of the region.
+  ///\remarks The space is merged with free neighbours.
+  //////////////////////////////////////////////////////////////////////////////
+  void release(qint64 offset, const uchar* address, qint64 size);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SwapStore::usedSize()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the number of bytes that are still in use.
+  ///\return  The size in bytes.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 usedSize() const;
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  mutable QMutex       m_mutex; ///> Guards the file against other threads.
+  QTemporaryFile       m_file;  ///> The swap file.
+  qint64               m_end;   ///> End of the allocated space.
+  qint64               m_used;  ///> Bytes of regions that are still in use.
+  QMap<qint64, qint64> m_free;  ///> Size of every free region by offset.
+};
+
+#endif // #ifndef __SWAPSTORE_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
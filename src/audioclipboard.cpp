@@ -0,0 +1,318 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    audioclipboard.cpp
+///\ingroup bruo
+///\brief   Internal clipboard for audio ranges.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "audioclipboard.h"
+#include "audiomimedata.h"
+#include "audio/memorysnippet.h"
+#include "audio/samplekernels.h"
+#include "audio/sndfileio.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// MIME type of our marker on the system clipboard:
+static const char* s_markerType = "application/x-bruo-audio";
+
+////////////////////////////////////////////////////////////////////////////////
+// Frames decoded at once when importing:
+static const int s_blockFrames = 65536;
+
+////////////////////////////////////////////////////////////////////////////////
+// decodeAudio()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Decode an audio file in memory into an in-memory source.
+///\param   [in]  data:       The file data.
+///\param   [out] sampleRate: Samples per second of the audio.
+///\return  The new source or a null pointer on error.
+///\remarks The frames are decoded block by block straight into the buffer of
+///         the source. Large sources are moved to the swap file of the
+///         document that they are pasted into (see pageOutSources()).
+////////////////////////////////////////////////////////////////////////////////
+static QSharedPointer<AudioSnippet> decodeAudio(const QByteArray& data, double& sampleRate)
+{
+  // Open a reader on the data:
+  QByteArray bytes(data);
+  QBuffer device(&bytes);
+  device.open(QIODevice::ReadOnly);
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  SNDFILE* handle = openSndFile(&device, SFM_READ, &info);
+  if (handle == 0)
+    return QSharedPointer<AudioSnippet>();
+
+  // Sample buffers are indexed by int:
+  FloatSampleBuffer samples;
+  if (info.channels > 0 && info.frames > 0 && info.frames <= INT_MAX)
+    samples.createBuffers(info.channels, static_cast<int>(info.frames), false);
+  if (samples.sampleCount() != info.frames || samples.channelCount() != info.channels)
+  {
+    sf_close(handle);
+    return QSharedPointer<AudioSnippet>();
+  }
+
+  // Decode, a truncated file is no result:
+  QVector<float> frames(s_blockFrames * info.channels);
+  QVector<float*> channels(info.channels);
+  qint64 position = 0;
+  while (position < info.frames)
+  {
+    const qint64 count = qMin(qint64(s_blockFrames), qint64(info.frames) - position);
+    const qint64 done = sf_readf_float(handle, frames.data(), count);
+    if (done <= 0)
+      break;
+    for (int i = 0; i < info.channels; i++)
+      channels[i] = samples.sampleBuffer(i) + position;
+    deinterleave(frames.constData(), channels.constData(), info.channels, done);
+    position += done;
+  }
+  sf_close(handle);
+  if (position != info.frames)
+    return QSharedPointer<AudioSnippet>();
+
+  // Return the source:
+  sampleRate = info.samplerate;
+  return QSharedPointer<AudioSnippet>(new MemorySnippet(std::move(samples)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::AudioClipboard()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] parent: Parent for this instance.
+////////////////////////////////////////////////////////////////////////////////
+AudioClipboard::AudioClipboard(QObject* parent) :
+  QObject(parent),
+  m_numChannels(0),
+  m_sampleRate(0.0),
+  m_sampleCount(0),
+  m_serial(0),
+  m_imported(false)
+{
+  // Watch the system clipboard:
+  connect(QApplication::clipboard(), SIGNAL(dataChanged()), this, SLOT(systemClipboardChanged()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::~AudioClipboard()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Releases the pieces.
+////////////////////////////////////////////////////////////////////////////////
+AudioClipboard::~AudioClipboard()
+{
+  // Release pieces:
+  clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::setContents()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Put new pieces on the clipboard.
+///\param   [in] snippets:    The pieces, the clipboard takes them over.
+///\param   [in] numChannels: Number of channels of the pieces.
+///\param   [in] sampleRate:  Samples per second of the pieces.
+///\remarks This also claims the system clipboard.
+////////////////////////////////////////////////////////////////////////////////
+void AudioClipboard::setContents(const QList<SubSnippet*>& snippets, int numChannels, double sampleRate)
+{
+  // Replace the old contents:
+  clear();
+  m_snippets    = snippets;
+  m_numChannels = numChannels;
+  m_sampleRate  = sampleRate;
+  for (int i = 0; i < m_snippets.size(); i++)
+    m_sampleCount += m_snippets[i]->sampleCount();
+  m_serial++;
+
+  // Claim the system clipboard, the audio data is rendered on request only:
+  QMimeData* mimeData = new AudioMimeData(copySnippets(), m_numChannels, m_sampleRate);
+  mimeData->setData(s_markerType, marker());
+  QApplication::clipboard()->setMimeData(mimeData);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::clear()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Release all pieces.
+////////////////////////////////////////////////////////////////////////////////
+void AudioClipboard::clear()
+{
+  // Delete pieces (the sources go away with their last piece):
+  qDeleteAll(m_snippets);
+  m_snippets.clear();
+  m_numChannels = 0;
+  m_sampleRate  = 0.0;
+  m_sampleCount = 0;
+  m_imported    = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::isCurrent()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Check if the system clipboard still holds our contents.
+///\return  true if there is something to paste from here.
+////////////////////////////////////////////////////////////////////////////////
+bool AudioClipboard::isCurrent() const
+{
+  // Anything on the clipboard?
+  if (m_snippets.isEmpty())
+    return false;
+
+  // Imported contents are cleared when the clipboard changes:
+  return m_imported || ownsSystemClipboard();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::importSystemClipboard()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Take audio data of another application as contents.
+///\return  true if successful or false otherwise.
+///\remarks The data is decoded into an in-memory source, which the document
+///         that it is pasted into pages out to its swap file if it's large.
+////////////////////////////////////////////////////////////////////////////////
+bool AudioClipboard::importSystemClipboard()
+{
+  // Find an audio format:
+  const QMimeData* mimeData = QApplication::clipboard()->mimeData();
+  if (mimeData == 0)
+    return false;
+  QString type;
+  if (mimeData->hasFormat("audio/wav"))
+    type = "audio/wav";
+  else if (mimeData->hasFormat("audio/x-wav"))
+    type = "audio/x-wav";
+  else if (mimeData->hasFormat("audio/x-aiff"))
+    type = "audio/x-aiff";
+  else
+    return false;
+
+  // Decode the data:
+  double sampleRate = 0.0;
+  QSharedPointer<AudioSnippet> source = decodeAudio(mimeData->data(type), sampleRate);
+  if (source.isNull())
+    return false;
+
+  // Take the audio as contents:
+  clear();
+  m_snippets.append(new SubSnippet(source, 0, source->sampleCount()));
+  m_numChannels = source->channelCount();
+  m_sampleRate  = sampleRate;
+  m_sampleCount = source->sampleCount();
+  m_imported    = true;
+
+  // Return success:
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::copySnippets()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Get the pieces of the clipboard for pasting.
+///\return  New pieces that refer to the same sources, owned by the caller.
+////////////////////////////////////////////////////////////////////////////////
+QList<SubSnippet*> AudioClipboard::copySnippets() const
+{
+  // Copy the references:
+  QList<SubSnippet*> result;
+  for (int i = 0; i < m_snippets.size(); i++)
+    result.append(new SubSnippet(m_snippets[i]->source(), m_snippets[i]->start(), m_snippets[i]->sampleCount()));
+
+  // Return the pieces:
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::channelCount()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the number of channels of the clipboard contents.
+///\return  The channel count.
+////////////////////////////////////////////////////////////////////////////////
+int AudioClipboard::channelCount() const
+{
+  // Return our channel count:
+  return m_numChannels;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::sampleRate()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the sample rate of the clipboard contents.
+///\return  The sample rate in samples/second.
+////////////////////////////////////////////////////////////////////////////////
+double AudioClipboard::sampleRate() const
+{
+  // Return our sample rate:
+  return m_sampleRate;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::sampleCount()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the length of the clipboard contents.
+///\return  The number of sample frames.
+////////////////////////////////////////////////////////////////////////////////
+qint64 AudioClipboard::sampleCount() const
+{
+  // Return our length:
+  return m_sampleCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::systemClipboardChanged()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Release our pieces if someone else took over the clipboard.
+////////////////////////////////////////////////////////////////////////////////
+void AudioClipboard::systemClipboardChanged()
+{
+  // Still ours?
+  if (!m_snippets.isEmpty() && !ownsSystemClipboard())
+    clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::marker()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Build the marker for the system clipboard.
+///\return  Process id and serial number of the current contents.
+////////////////////////////////////////////////////////////////////////////////
+QByteArray AudioClipboard::marker() const
+{
+  // Other instances of bruo must not paste our pieces:
+  return QByteArray::number(QCoreApplication::applicationPid()) + ":" + QByteArray::number(m_serial);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioClipboard::ownsSystemClipboard()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Check if the system clipboard still holds our marker.
+///\return  true if nobody else has put something on the clipboard.
+////////////////////////////////////////////////////////////////////////////////
+bool AudioClipboard::ownsSystemClipboard() const
+{
+  // Is it still our marker?
+  const QMimeData* mimeData = QApplication::clipboard()->mimeData();
+  return mimeData != 0 && mimeData->hasFormat(s_markerType) && mimeData->data(s_markerType) == marker();
+}
+
+///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    audioclipboard.h
+///\ingroup bruo
+///\brief   Internal clipboard for audio ranges.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __AUDIOCLIPBOARD_H_INCLUDED__
+#define __AUDIOCLIPBOARD_H_INCLUDED__
+
+#include "bruo.h"
+#include "audio/subsnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   AudioClipboard audioclipboard.h
+///\brief   The application's clipboard for audio.
+///\remarks The clipboard holds play list pieces, not samples. They keep their
+///         sources alive, so copying any range and pasting it into any open
+///         document is cheap even after the source document was closed. The
+///         system clipboard gets a marker and WAV data that is only rendered
+///         if another application asks for it (see AudioMimeData). As soon as
+///         something else is put on the system clipboard the pieces are
+///         released. Audio from other applications is decoded into memory,
+///         see importSystemClipboard().
+////////////////////////////////////////////////////////////////////////////////
+class AudioClipboard :
+  public QObject
+{
+  Q_OBJECT // Qt magic...
+
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::AudioClipboard()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] parent: Parent for this instance.
+  //////////////////////////////////////////////////////////////////////////////
+  AudioClipboard(QObject* parent = 0);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::~AudioClipboard()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Releases the pieces.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~AudioClipboard();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::setContents()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Put new pieces on the clipboard.
+  ///\param   [in] snippets:    The pieces, the clipboard takes them over.
+  ///\param   [in] numChannels: Number of channels of the pieces.
+  ///\param   [in] sampleRate:  Samples per second of the pieces.
+  ///\remarks This also claims the system clipboard.
+  //////////////////////////////////////////////////////////////////////////////
+  void setContents(const QList<SubSnippet*>& snippets, int numChannels, double sampleRate);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::clear()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Release all pieces.
+  //////////////////////////////////////////////////////////////////////////////
+  void clear();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::isCurrent()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check if the system clipboard still holds our contents.
+  ///\return  true if there is something to paste from here.
+  ///\remarks Imported contents stay current until the system clipboard
+  ///         changes.
+  //////////////////////////////////////////////////////////////////////////////
+  bool isCurrent() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::importSystemClipboard()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Take audio data of another application as contents.
+  ///\return  true if successful or false otherwise.
+  ///\remarks The data is decoded into an in-memory source, which the document
+  ///         that it is pasted into pages out to its swap file if it's large.
+  //////////////////////////////////////////////////////////////////////////////
+  bool importSystemClipboard();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::copySnippets()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Get the pieces of the clipboard for pasting.
+  ///\return  New pieces that refer to the same sources, owned by the caller.
+  //////////////////////////////////////////////////////////////////////////////
+  QList<SubSnippet*> copySnippets() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::channelCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the number of channels of the clipboard contents.
+  ///\return  The channel count.
+  //////////////////////////////////////////////////////////////////////////////
+  int channelCount() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::sampleRate()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the sample rate of the clipboard contents.
+  ///\return  The sample rate in samples/second.
+  //////////////////////////////////////////////////////////////////////////////
+  double sampleRate() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::sampleCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the length of the clipboard contents.
+  ///\return  The number of sample frames.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 sampleCount() const;
+
+private slots:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::systemClipboardChanged()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Release our pieces if someone else took over the clipboard.
+  //////////////////////////////////////////////////////////////////////////////
+  void systemClipboardChanged();
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::marker()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Build the marker for the system clipboard.
+  ///\return  Process id and serial number of the current contents.
+  //////////////////////////////////////////////////////////////////////////////
+  QByteArray marker() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioClipboard::ownsSystemClipboard()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check if the system clipboard still holds our marker.
+  ///\return  true if nobody else has put something on the clipboard.
+  //////////////////////////////////////////////////////////////////////////////
+  bool ownsSystemClipboard() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  QList<SubSnippet*> m_snippets;    ///> The pieces on the clipboard.
+  int                m_numChannels; ///> Channel count of the pieces.
+  double             m_sampleRate;  ///> Sample rate of the pieces.
+  qint64             m_sampleCount; ///> Total length of the pieces.
+  int                m_serial;      ///> Number of the current contents.
+  bool               m_imported;    ///> Contents from another application?
+};
+
+#endif // #ifndef __AUDIOCLIPBOARD_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    audiomimedata.cpp
+///\ingroup bruo
+///\brief   Clipboard data that renders audio on demand.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "audiomimedata.h"
+#include "audio/sndfileio.h"
+#include <climits>
+
+////////////////////////////////////////////////////////////////////////////////
+// Frames per rendered block:
+static const int s_blockFrames = 65536;
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioMimeData::AudioMimeData()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] snippets:    The pieces to render, this object takes them.
+///\param   [in] numChannels: Number of channels of the pieces.
+///\param   [in] sampleRate:  Samples per second of the pieces.
+////////////////////////////////////////////////////////////////////////////////
+AudioMimeData::AudioMimeData(const QList<SubSnippet*>& snippets, int numChannels, double sampleRate) :
+  QMimeData(),
+  m_snippets(snippets),
+  m_numChannels(numChannels),
+  m_sampleRate(sampleRate)
+{
+  // Nothing to do here.
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioMimeData::~AudioMimeData()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Releases the pieces.
+////////////////////////////////////////////////////////////////////////////////
+AudioMimeData::~AudioMimeData()
+{
+  // Delete pieces:
+  qDeleteAll(m_snippets);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioMimeData::formats()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Get the formats that this object can deliver.
+///\return  The list of MIME types.
+///\remarks The audio formats are only promised here, see retrieveData().
+////////////////////////////////////////////////////////////////////////////////
+QStringList AudioMimeData::formats() const
+{
+  // Add the audio formats to the eagerly set ones:
+  QStringList result = QMimeData::formats();
+  result << "audio/wav" << "audio/x-wav";
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioMimeData::retrieveData()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Deliver the data for a MIME type.
+///\param   [in] mimeType: The requested type.
+///\param   [in] type:     The preferred type of the result.
+///\return  The data for this MIME type.
+///\remarks The WAV data is rendered on the first request and kept for the
+///         following ones.
+////////////////////////////////////////////////////////////////////////////////
+QVariant AudioMimeData::retrieveData(const QString& mimeType, QVariant::Type type) const
+{
+  // Everything but audio was set eagerly:
+  if (mimeType != "audio/wav" && mimeType != "audio/x-wav")
+    return QMimeData::retrieveData(mimeType, type);
+
+  // Render on first use:
+  if (m_wave.isEmpty())
+    m_wave = renderWave();
+  return m_wave;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AudioMimeData::renderWave()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Render the pieces into a WAV file in memory.
+///\return  The file data or an empty array on error.
+///\remarks The pieces are read and written block by block, so only the
+///         result has to fit into memory.
+////////////////////////////////////////////////////////////////////////////////
+QByteArray AudioMimeData::renderWave() const
+{
+  // Get total length:
+  qint64 sampleCount = 0;
+  for (int i = 0; i < m_snippets.size(); i++)
+    sampleCount += m_snippets[i]->sampleCount();
+
+  // Sanity check (a byte array can't hold more than 2 GB):
+  const qint64 dataSize = sampleCount * m_numChannels * sizeof(qint16);
+  if (m_numChannels <= 0 || dataSize <= 0 || dataSize > INT_MAX - 1024)
+    return QByteArray();
+
+  // 16 bit PCM is what every other application understands:
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  info.channels   = m_numChannels;
+  info.samplerate = qRound(m_sampleRate);
+  info.format     = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+
+  // Open a writer on memory:
+  QByteArray wave;
+  wave.reserve(int(dataSize) + 1024);
+  QBuffer device(&wave);
+  device.open(QIODevice::ReadWrite);
+  SNDFILE* handle = openSndFile(&device, SFM_WRITE, &info);
+  if (handle == 0)
+    return QByteArray();
+  sf_command(handle, SFC_SET_CLIPPING, 0, SF_TRUE);
+
+  // Stream the pieces through, a truncated file is no result:
+  QVector<float> frames(s_blockFrames * m_numChannels);
+  bool ok = true;
+  for (int i = 0; i < m_snippets.size() && ok; i++)
+  {
+    SubSnippet* piece = m_snippets[i];
+    qint64 position = 0;
+    while (position < piece->sampleCount())
+    {
+      qint64 count = qMin(qint64(s_blockFrames), piece->sampleCount() - position);
+      qint64 done = piece->readRaw(position, count, frames.data());
+      if (done <= 0 || sf_writef_float(handle, frames.data(), done) != done)
+      {
+        ok = false;
+        break;
+      }
+      position += done;
+    }
+  }
+
+  // Finish the header:
+  sf_close(handle);
+  device.close();
+
+  // Return the file:
+  if (!ok)
+    return QByteArray();
+  return wave;
+}
+
+///////////////////////////////// End of File //////////////////////////////////
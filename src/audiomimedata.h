@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    audiomimedata.h
+///\ingroup bruo
+///\brief   Clipboard data that renders audio on demand.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __AUDIOMIMEDATA_H_INCLUDED__
+#define __AUDIOMIMEDATA_H_INCLUDED__
+
+#include "bruo.h"
+#include "audio/subsnippet.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   AudioMimeData audiomimedata.h
+///\brief   Clipboard data for audio ranges.
+///\remarks Other applications get the range as WAV data, but it is only
+///         rendered if one of them actually asks for it. Just copying
+///         inside bruo never touches a sample.
+////////////////////////////////////////////////////////////////////////////////
+class AudioMimeData :
+  public QMimeData
+{
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioMimeData::AudioMimeData()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] snippets:    The pieces to render, this object takes them.
+  ///\param   [in] numChannels: Number of channels of the pieces.
+  ///\param   [in] sampleRate:  Samples per second of the pieces.
+  //////////////////////////////////////////////////////////////////////////////
+  AudioMimeData(const QList<SubSnippet*>& snippets, int numChannels, double sampleRate);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioMimeData::~AudioMimeData()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Releases the pieces.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~AudioMimeData();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioMimeData::formats()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Get the formats that this object can deliver.
+  ///\return  The list of MIME types.
+  ///\remarks The audio formats are only promised here, see retrieveData().
+  //////////////////////////////////////////////////////////////////////////////
+  virtual QStringList formats() const;
+
+protected:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioMimeData::retrieveData()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Deliver the data for a MIME type.
+  ///\param   [in] mimeType: The requested type.
+  ///\param   [in] type:     The preferred type of the result.
+  ///\return  The data for this MIME type.
+  ///\remarks The WAV data is rendered on the first request and kept for the
+  ///         following ones.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual QVariant retrieveData(const QString& mimeType, QVariant::Type type) const;
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AudioMimeData::renderWave()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Render the pieces into a WAV file in memory.
+  ///\return  The file data or an empty array on error.
+  ///\remarks The pieces are read and written block by block, so only the
+  ///         result has to fit into memory.
+  //////////////////////////////////////////////////////////////////////////////
+  QByteArray renderWave() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  QList<SubSnippet*> m_snippets;    ///> The pieces to render.
+  int                m_numChannels; ///> Channel count of the pieces.
+  double             m_sampleRate;  ///> Sample rate of the pieces.
+  mutable QByteArray m_wave;        ///> The rendered WAV data.
+};
+
+#endif // #ifndef __AUDIOMIMEDATA_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
@@ -11,18 +11,35 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets multimedia
 TARGET = bruo
 TEMPLATE = app
 
+CONFIG += c++11
+
 SOURCES += \
     rtaudio/RtAudio.cpp \
     audio/audiosnippet.cpp \
     audio/audiosystem.cpp \
     audio/audiotools.cpp \
+    audio/blockcache.cpp \
+    audio/bouncethread.cpp \
+    audio/mappedsnippet.cpp \
+    audio/memorysnippet.cpp \
+    audio/openthread.cpp \
+    audio/peakcache.cpp \
     audio/peakdata.cpp \
     audio/peakthread.cpp \
+    audio/playbackstream.cpp \
     audio/samplebuffer.cpp \
+    audio/samplekernels.cpp \
+    audio/savethread.cpp \
+    audio/sndfileio.cpp \
     audio/sndfilesnippet.cpp \
+    audio/subsnippet.cpp \
+    audio/swapstore.cpp \
+    audioclipboard.cpp \
+    audiomimedata.cpp \
     bruo.cpp \
     commands/appundocommand.cpp \
     commands/clearselectioncommand.cpp \
+    commands/editcommand.cpp \
     commands/selectcommand.cpp \
     commands/selectingcommand.cpp \
     controls/bookmarkwidget.cpp \
@@ -101,6 +118,7 @@ SOURCES += \
     actions/printstatsaction.cpp \
     actions/printpreviewaction.cpp \
     actions/selectallaction.cpp \
+    actions/bounceaction.cpp \
     audio/audiosystemqt.cpp \
     controls/vectordial.cpp \
     controls/vectorled.cpp \
@@ -112,13 +130,28 @@ HEADERS += \
     audio/audiosnippet.h \
     audio/audiosystem.h \
     audio/audiotools.h \
+    audio/blockcache.h \
+    audio/bouncethread.h \
+    audio/mappedsnippet.h \
+    audio/memorysnippet.h \
+    audio/openthread.h \
+    audio/peakcache.h \
     audio/peakdata.h \
     audio/peakthread.h \
+    audio/playbackstream.h \
     audio/samplebuffer.h \
+    audio/samplekernels.h \
+    audio/savethread.h \
+    audio/sndfileio.h \
     audio/sndfilesnippet.h \
+    audio/subsnippet.h \
+    audio/swapstore.h \
+    audioclipboard.h \
+    audiomimedata.h \
     bruo.h \
     commands/appundocommand.h \
     commands/clearselectioncommand.h \
+    commands/editcommand.h \
     commands/selectcommand.h \
     commands/selectingcommand.h \
     controls/bookmarkwidget.h \
@@ -198,6 +231,7 @@ HEADERS += \
     actions/printstatsaction.h \
     actions/printpreviewaction.h \
     actions/selectallaction.h \
+    actions/bounceaction.h \
     audio/audiosystemqt.h \
     controls/vectordial.h \
     controls/vectorled.h \
@@ -50,6 +50,32 @@ AppUndoCommand::~AppUndoCommand()
   // Nothing to do here.
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// AppUndoCommand::payloadSize()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the amount of RAM that this command keeps alive.
+///\return  The size in bytes.
+///\remarks The document sums this up to keep the stack inside of its
+///         memory budget.
+////////////////////////////////////////////////////////////////////////////////
+qint64 AppUndoCommand::payloadSize() const
+{
+  // Most commands only store a few values:
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AppUndoCommand::spillPayload()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move the samples of this command out of RAM.
+///\remarks Called by the document for old commands when the stack is over
+///         budget. Undo and redo must still work afterwards.
+////////////////////////////////////////////////////////////////////////////////
+void AppUndoCommand::spillPayload()
+{
+  // Nothing to do here.
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // AppUndoCommand::newCommandID()
 ////////////////////////////////////////////////////////////////////////////////
@@ -54,6 +54,25 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   virtual ~AppUndoCommand();
 
+  //////////////////////////////////////////////////////////////////////////////
+  // AppUndoCommand::payloadSize()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the amount of RAM that this command keeps alive.
+  ///\return  The size in bytes.
+  ///\remarks The document sums this up to keep the stack inside of its
+  ///         memory budget.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 payloadSize() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // AppUndoCommand::spillPayload()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move the samples of this command out of RAM.
+  ///\remarks Called by the document for old commands when the stack is over
+  ///         budget. Undo and redo must still work afterwards.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual void spillPayload();
+
 protected:
 
   //////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    editcommand.cpp
+///\ingroup bruo
+///\brief   Undo/redo command for play list edits implementation.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#include "editcommand.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// copyPieces()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Copy a list of pieces.
+///\param   [in] pieces: The pieces to copy.
+///\return  New pieces that refer to the same sources, owned by the caller.
+////////////////////////////////////////////////////////////////////////////////
+static QList<SubSnippet*> copyPieces(const QList<SubSnippet*>& pieces)
+{
+  // Copy the references:
+  QList<SubSnippet*> result;
+  for (int i = 0; i < pieces.size(); i++)
+    result.append(new SubSnippet(pieces[i]->source(), pieces[i]->start(), pieces[i]->sampleCount()));
+
+  // Return the pieces:
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// memorySources()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Collect the in-memory sources of a list of pieces.
+///\param   [in]     pieces:  The pieces to check.
+///\param   [in,out] sources: The distinct sources by id.
+////////////////////////////////////////////////////////////////////////////////
+static void memorySources(const QList<SubSnippet*>& pieces, QMap<int, QSharedPointer<AudioSnippet> >& sources)
+{
+  // Add every source only once:
+  for (int i = 0; i < pieces.size(); i++)
+  {
+    const QSharedPointer<AudioSnippet>& source = pieces[i]->source();
+    if (source->memorySize() > 0)
+      sources.insert(source->id(), source);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EditCommand::EditCommand()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Initialization constructor of this class.
+///\param   [in] doc:      The target document.
+///\param   [in] text:     The description of this command.
+///\param   [in] start:    The first frame of the range to replace.
+///\param   [in] length:   The number of frames to replace.
+///\param   [in] snippets: The pieces to insert, the command takes them over.
+///\param   [in] parent:   Parent undo item.
+///\remarks Nothing is changed until the command is pushed to the stack.
+////////////////////////////////////////////////////////////////////////////////
+EditCommand::EditCommand(Document* doc, const QString& text, qint64 start, qint64 length, const QList<SubSnippet*>& snippets, QUndoCommand* parent) :
+  AppUndoCommand(doc, parent),
+  m_start(start),
+  m_removedLength(0),
+  m_insertedLength(0),
+  m_inserted(snippets)
+{
+  // Set description:
+  setText(text);
+
+  // Remember what is replaced (references only):
+  m_removed = document()->copySnippets(start, length);
+  for (int i = 0; i < m_removed.size(); i++)
+    m_removedLength += m_removed[i]->sampleCount();
+  for (int i = 0; i < m_inserted.size(); i++)
+    m_insertedLength += m_inserted[i]->sampleCount();
+
+  // Save current selection:
+  m_oldSelStart  = document()->selectionStart();
+  m_oldSelLength = document()->selectionLength();
+  m_oldSelChan   = document()->selectedChannel();
+  m_oldCursorPos = document()->cursorPosition();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EditCommand::~EditCommand()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Destructor of this class.
+///\remarks Releases the pieces (and with them unused sources).
+////////////////////////////////////////////////////////////////////////////////
+EditCommand::~EditCommand()
+{
+  // Delete pieces:
+  qDeleteAll(m_removed);
+  qDeleteAll(m_inserted);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EditCommand::undo()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Reverts a change to the document.
+////////////////////////////////////////////////////////////////////////////////
+void EditCommand::undo()
+{
+  // Put the removed pieces back:
+  replace(m_insertedLength, m_removed);
+
+  // Return to old selection:
+  document()->setSelection(m_oldSelStart, m_oldSelLength, m_oldSelChan);
+  document()->setCursorPosition(m_oldCursorPos);
+
+  // Update listeners:
+  document()->emitSelectionChanged();
+  document()->emitDirtyChanged();
+  document()->emitPeaksChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EditCommand::redo()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Applies a change to the document.
+////////////////////////////////////////////////////////////////////////////////
+void EditCommand::redo()
+{
+  // Replace the range:
+  replace(m_removedLength, m_inserted);
+
+  // Select the inserted range or collapse the selection:
+  document()->setSelection(m_start, m_insertedLength);
+  document()->setCursorPosition(m_start + m_insertedLength);
+
+  // Update listeners:
+  document()->emitSelectionChanged();
+  document()->emitDirtyChanged();
+  document()->emitPeaksChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EditCommand::payloadSize()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the amount of RAM that this command keeps alive.
+///\return  The size of the pieces and of all in-memory sources they use.
+////////////////////////////////////////////////////////////////////////////////
+qint64 EditCommand::payloadSize() const
+{
+  // The pieces themselves:
+  qint64 size = (m_removed.size() + m_inserted.size()) * qint64(sizeof(SubSnippet));
+
+  // Sources that are shared by several pieces count once:
+  QMap<int, QSharedPointer<AudioSnippet> > sources;
+  memorySources(m_removed, sources);
+  memorySources(m_inserted, sources);
+  for (QMap<int, QSharedPointer<AudioSnippet> >::const_iterator it = sources.constBegin(); it != sources.constEnd(); ++it)
+    size += it.value()->memorySize();
+
+  // Return total:
+  return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EditCommand::spillPayload()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Move the in-memory sources of this command to disk.
+///\remarks The sources are paged out to the swap file of the document, so
+///         the play list reads them from there, too.
+////////////////////////////////////////////////////////////////////////////////
+void EditCommand::spillPayload()
+{
+  // Find the sources in memory:
+  QMap<int, QSharedPointer<AudioSnippet> > sources;
+  memorySources(m_removed, sources);
+  memorySources(m_inserted, sources);
+
+  // Page them out to the document's swap file:
+  for (QMap<int, QSharedPointer<AudioSnippet> >::const_iterator it = sources.constBegin(); it != sources.constEnd(); ++it)
+    it.value()->pageOut(document()->swapStore());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EditCommand::replace()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Replace frames at the start of the range with copies of pieces.
+///\param [in] length:   The number of frames to remove.
+///\param [in] snippets: The pieces to insert copies of.
+////////////////////////////////////////////////////////////////////////////////
+void EditCommand::replace(qint64 length, const QList<SubSnippet*>& snippets)
+{
+  // Swap the ranges in one go, we keep our own references to the old one:
+  QList<SubSnippet*> copies = copyPieces(snippets);
+  QList<SubSnippet*> removed;
+  if (!document()->replaceSamples(m_start, length, copies, removed))
+    qDeleteAll(copies);
+  qDeleteAll(removed);
+
+  // Mark as changed:
+  document()->setDirty();
+}
+
+///////////////////////////////// End of File //////////////////////////////////
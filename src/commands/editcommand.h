@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// (c) 2013 Rolf Meyerhoff. All rights reserved.
+////////////////////////////////////////////////////////////////////////////////
+///\file    editcommand.h
+///\ingroup bruo
+///\brief   Undo/redo command for play list edits.
+///\author  Rolf Meyerhoff (badlantic@gmail.com)
+///\version 1.0
+/// This file is part of the bruo audio editor.
+////////////////////////////////////////////////////////////////////////////////
+///\par License:
+/// This program is free software: you can redistribute it and/or modify it
+/// under the terms of the GNU General Public License as published by the Free
+/// Software Foundation, either version 2 of the License, or (at your option)
+/// any later version.
+///\par
+/// This program is distributed in the hope that it will be useful, but WITHOUT
+/// ANY WARRANTY; without even  the implied warranty of MERCHANTABILITY or
+/// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+/// more details.
+///\par
+/// You should have received a copy of the GNU General Public License along with
+/// this program; see the file COPYING. If not, see http://www.gnu.org/licenses/
+/// or write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth
+/// Floor, Boston, MA 02110-1301, USA.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef __EDITCOMMAND_H_INCLUDED__
+#define __EDITCOMMAND_H_INCLUDED__
+
+#include "appundocommand.h"
+
+////////////////////////////////////////////////////////////////////////////////
+///\class   EditCommand editcommand.h
+///\brief   Undo/redo command that replaces a range of the play list.
+///\remarks Delete, cut and paste are all replacements (with nothing or of
+///         nothing). The command only stores references to the removed and
+///         inserted samples, so its size doesn't depend on the range.
+////////////////////////////////////////////////////////////////////////////////
+class EditCommand :
+  public AppUndoCommand
+{
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // EditCommand::EditCommand()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Initialization constructor of this class.
+  ///\param   [in] doc:      The target document.
+  ///\param   [in] text:     The description of this command.
+  ///\param   [in] start:    The first frame of the range to replace.
+  ///\param   [in] length:   The number of frames to replace.
+  ///\param   [in] snippets: The pieces to insert, the command takes them over.
+  ///\param   [in] parent:   Parent undo item.
+  ///\remarks Nothing is changed until the command is pushed to the stack.
+  //////////////////////////////////////////////////////////////////////////////
+  EditCommand(Document* doc, const QString& text, qint64 start, qint64 length, const QList<SubSnippet*>& snippets, QUndoCommand* parent = 0);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // EditCommand::~EditCommand()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Destructor of this class.
+  ///\remarks Releases the pieces (and with them unused sources).
+  //////////////////////////////////////////////////////////////////////////////
+  virtual ~EditCommand();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // EditCommand::undo()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief Reverts a change to the document.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual void undo();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // EditCommand::redo()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief Applies a change to the document.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual void redo();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // EditCommand::payloadSize()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the amount of RAM that this command keeps alive.
+  ///\return  The size of the pieces and of all in-memory sources they use.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual qint64 payloadSize() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // EditCommand::spillPayload()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Move the in-memory sources of this command to disk.
+  ///\remarks The sources are paged out to the swap file of the document, so
+  ///         the play list reads them from there, too.
+  //////////////////////////////////////////////////////////////////////////////
+  virtual void spillPayload();
+
+private:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // EditCommand::replace()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief Replace frames at the start of the range with copies of pieces.
+  ///\param [in] length:   The number of frames to remove.
+  ///\param [in] snippets: The pieces to insert copies of.
+  //////////////////////////////////////////////////////////////////////////////
+  void replace(qint64 length, const QList<SubSnippet*>& snippets);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Member:
+  qint64             m_start;          ///> The first frame of the range.
+  qint64             m_removedLength;  ///> Number of removed frames.
+  qint64             m_insertedLength; ///> Number of inserted frames.
+  QList<SubSnippet*> m_removed;        ///> The removed pieces.
+  QList<SubSnippet*> m_inserted;       ///> The inserted pieces.
+  qint64             m_oldSelStart;    ///> Old selection start.
+  qint64             m_oldSelLength;   ///> Old selection length.
+  int                m_oldSelChan;     ///> Old selection channel.
+  qint64             m_oldCursorPos;   ///> Old cursor position.
+};
+
+#endif // #ifndef __EDITCOMMAND_H_INCLUDED__
+///////////////////////////////// End of File //////////////////////////////////
@@ -581,6 +581,24 @@ void WaveEditView::onViewportChanged()
   update();
 }
 
+void WaveEditView::onPeakRangeChanged(qint64 start, qint64 length)
+{
+  // Anything to do?
+  if (m_backBuff == 0)
+    return;
+  QRect peaksRect(0, 0, m_waveArea.width(), m_waveArea.height());
+  QRect dirtyRect = peakColumns(peaksRect, start, length);
+  if (dirtyRect.isEmpty())
+    return;
+
+  // Redraw the affected columns:
+  QPainter wavePainter(m_backBuff);
+  drawPeaks(peaksRect, wavePainter, dirtyRect);
+
+  // Update view:
+  update(dirtyRect.translated(m_waveArea.topLeft()));
+}
+
 void WaveEditView::btnPlusHPressed()
 {
   // Get current center of view:
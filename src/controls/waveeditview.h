@@ -37,6 +37,7 @@ protected:
   virtual void focusOutEvent(QFocusEvent* event);
 
   virtual void onViewportChanged();
+  virtual void onPeakRangeChanged(qint64 start, qint64 length);
 
 public slots:
 
@@ -295,6 +295,24 @@ void WaveOverView::onViewportChanged()
   updateViewPort();
 }
 
+void WaveOverView::onPeakRangeChanged(qint64 start, qint64 length)
+{
+  // Anything to do?
+  if (m_backBuff == 0 || document() == 0)
+    return;
+  QRect waveRect(0, 0, width(), height());
+  QRect dirtyRect = peakColumns(waveRect, start, length);
+  if (dirtyRect.isEmpty())
+    return;
+
+  // Redraw the affected columns:
+  QPainter wavePainter(m_backBuff);
+  drawPeaks(waveRect, wavePainter, dirtyRect);
+
+  // Update view:
+  update(dirtyRect);
+}
+
 void WaveOverView::updateViewPort()
 {
   // Got a slave and a document?
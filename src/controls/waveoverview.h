@@ -36,6 +36,7 @@ protected:
   virtual void mouseReleaseEvent(QMouseEvent* event);
   virtual void mouseDoubleClickEvent(QMouseEvent* event);
   virtual void onViewportChanged();
+  virtual void onPeakRangeChanged(qint64 start, qint64 length);
 
 private:
 
@@ -6,6 +6,7 @@ WaveView::WaveView(Document* doc, QWidget* parent) :
   m_drawHalfLine(true),
   m_drawChannelDivider(true),
   m_drawBackGradients(true),
+  m_drawRms(true),
   m_zoomV(1.0),
   m_zoomVOverlap(0.9),
   m_posV(0.5),
@@ -15,6 +16,7 @@ WaveView::WaveView(Document* doc, QWidget* parent) :
   m_centerColor(192, 192, 192),
   m_halfColor(208, 208, 208),
   m_waveColor(103, 103, 103),
+  m_rmsColor(150, 150, 150),
   m_upperColor(255, 255, 255),
   m_lowerColor(208, 208, 208),
   m_dividerColor(35, 35, 35),
@@ -30,6 +32,7 @@ WaveView::WaveView(Document* doc, QWidget* parent) :
 
   // Attach event handlers to the document:
   connect(m_document, SIGNAL(peaksChanged()),     this, SLOT(peaksChanged()));
+  connect(m_document, SIGNAL(peakRangeChanged(qint64, qint64)), this, SLOT(peakRangeChanged(qint64, qint64)));
   connect(m_document, SIGNAL(selectionChanged()), this, SLOT(update()));
   connect(m_document, SIGNAL(selectionChanging()),this, SLOT(update()));
   connect(m_document, SIGNAL(cursorPosChanged()), this, SLOT(update()));
@@ -121,6 +124,25 @@ void WaveView::setDrawBackGradients(bool newState)
   update();
 }
 
+bool WaveView::drawRms() const
+{
+  // Return current state:
+  return m_drawRms;
+}
+
+void WaveView::setDrawRms(bool newState)
+{
+  // Anything to do?
+  if (m_drawRms == newState)
+    return;
+
+  // Update value:
+  m_drawRms = newState;
+
+  // Redraw control:
+  update();
+}
+
 double WaveView::zoomV() const
 {
   // Return current zoom:
@@ -366,6 +388,25 @@ void WaveView::setWaveColor(const QColor& newColor)
   update();
 }
 
+const QColor& WaveView::rmsColor() const
+{
+  // Return current color:
+  return m_rmsColor;
+}
+
+void WaveView::setRmsColor(const QColor& newColor)
+{
+  // Anything to do?
+  if (m_rmsColor == newColor)
+    return;
+
+  // Save value:
+  m_rmsColor = newColor;
+
+  // Redraw the client area:
+  update();
+}
+
 const QColor& WaveView::upperColor() const
 {
   // Return current color:
@@ -466,8 +507,19 @@ void WaveView::onViewportChanged()
   // Nothing to do here.
 }
 
-void WaveView::drawPeaks(QRect& waveRect, QPainter& painter)
+void WaveView::onPeakRangeChanged(qint64 start, qint64 length)
+{
+  // Redraw the affected columns:
+  QRect dirtyRect = peakColumns(rect(), start, length);
+  if (!dirtyRect.isEmpty())
+    update(dirtyRect);
+}
+
+void WaveView::drawPeaks(QRect& waveRect, QPainter& painter, const QRect& updateRect)
 {
+  // The peak thread must not swap the levels while they are drawn:
+  QReadLocker locker(m_document != 0 ? &m_document->peakDataLock() : 0);
+
   // Are we empty?
   if (m_document == 0 || !m_document->peakData().valid())
   {
@@ -478,6 +530,22 @@ void WaveView::drawPeaks(QRect& waveRect, QPainter& painter)
     return;
   }
 
+  // Select mip map:
+  int mip = selectMipmap(waveRect);
+
+  // Only some columns? Samples read directly never change with the peaks:
+  QRect columns(waveRect);
+  if (!updateRect.isNull())
+  {
+    if (mip < 0)
+      return;
+    columns = waveRect & updateRect;
+    if (columns.isEmpty())
+      return;
+  }
+  painter.setClipRect(columns);
+  painter.setClipping(true);
+
   // Get height of a single channel:
   double channelHeight = (double)waveRect.height() / m_document->channelCount();
 
@@ -524,14 +592,9 @@ void WaveView::drawPeaks(QRect& waveRect, QPainter& painter)
     painter.fillRect(waveRect, m_backColor);
   }
 
-  // Select mip map:
-  double factor = (double)m_viewLength / waveRect.width();
-  int mip = m_document->peakData().mipmapCount() - 1;
-  while (mip >= 0 && factor < m_document->peakData().mipmaps()[mip].divisionFactor())
-    mip--;
-
   // Read direct data if needed:
-  SampleBuffer buffer;
+  FloatSampleBuffer& buffer = m_rawBuffer;
+  buffer.createBuffers(m_document->channelCount(), 0, false);
   if (mip < 0)
   {
     // Calc number of samples to read:
@@ -539,11 +602,14 @@ void WaveView::drawPeaks(QRect& waveRect, QPainter& painter)
     if (numSamples > m_document->sampleCount())
       numSamples = m_document->sampleCount();
 
-    // Create buffer and read data:
+    // Size buffer (no need to clear it) and read data:
     if (numSamples > 0)
     {
-      buffer.createBuffers(m_document->channelCount(), numSamples);
-      m_document->readSamples(m_viewPosition, buffer, numSamples);
+      buffer.createBuffers(m_document->channelCount(), numSamples, false);
+      qint64 numRead = m_document->readSamples(m_viewPosition, buffer, numSamples, AudioSnippet::DisplayReader);
+
+      // Only draw what we actually got:
+      buffer.createBuffers(m_document->channelCount(), qMax(numRead, (qint64)0), false);
     }
   }
 
@@ -556,7 +622,7 @@ void WaveView::drawPeaks(QRect& waveRect, QPainter& painter)
     int ymax = destRect.bottom();
 
     // Set clip rect:
-    painter.setClipRect(destRect);
+    painter.setClipRect(destRect & columns);
     painter.setClipping(true);
 
     // Get center line position:
@@ -600,31 +666,47 @@ void WaveView::drawPeaks(QRect& waveRect, QPainter& painter)
         pos = 0;
       double maxpos = m_document->peakData().mipmaps()[mip].sampleCount();
 
+      // Skip the columns left of the update:
+      int left = qMax(destRect.left(), columns.left());
+      pos += inc * (left - destRect.left());
+      int right = qMin(destRect.right(), columns.right() + 1);
+
       // Draw peaks:
       const PeakSample* samples = m_document->peakData().mipmaps()[mip].samples()[channel];
-      for (int x = destRect.left(); x < destRect.right() && pos < maxpos; x++, pos += inc)
+      for (int x = left; x < right && pos < maxpos; x++, pos += inc)
       {
         // Find min and max in the current sample range:
         int ipos = (int)floor(pos);
         int ipos2 = (int)floor(pos + inc) ;
         if (ipos2 >= maxpos)
           ipos2 = maxpos - 1;
-        double minVal = samples[ipos].minVal;
-        double maxVal = samples[ipos].maxVal;
+        int minVal = samples[ipos].minVal;
+        int maxVal = samples[ipos].maxVal;
+        double energy = peakValue(samples[ipos].rmsVal) * peakValue(samples[ipos].rmsVal);
         for (int sub = ipos + 1; sub < ipos2; sub++)
         {
           if (samples[sub].minVal < minVal)
             minVal = samples[sub].minVal;
           if (samples[sub].maxVal > maxVal)
             maxVal = samples[sub].maxVal;
+          energy += peakValue(samples[sub].rmsVal) * peakValue(samples[sub].rmsVal);
         }
 
         // Move into window:
-        int y1 = (int)(y + (minVal * yscale) - 0.5);
-        int y2 = (int)(y + (maxVal * yscale) + 0.5);
+        int y1 = (int)(y + (peakValue(minVal) * yscale) - 0.5);
+        int y2 = (int)(y + (peakValue(maxVal) * yscale) + 0.5);
 
         // Draw the actual line:
         painter.drawLine(x, y1, x, y2);
+
+        // Draw the RMS on top of it:
+        if (m_drawRms)
+        {
+          double rms = sqrt(energy / qMax(ipos2 - ipos, 1));
+          painter.setPen(m_rmsColor);
+          painter.drawLine(x, (int)(y - (rms * yscale) + 0.5), x, (int)(y + (rms * yscale) + 0.5));
+          painter.setPen(m_waveColor);
+        }
       }
     }
 
@@ -633,7 +715,7 @@ void WaveView::drawPeaks(QRect& waveRect, QPainter& painter)
     {
       // Calc stepping:
       int numSamples = buffer.sampleCount();
-      const double* samples = buffer.sampleBuffer(channel);
+      const float* samples = buffer.sampleBuffer(channel);
       double inc = (double)m_viewLength / destRect.width();
 
       // Draw peaks as min/max pairs?
@@ -812,6 +894,40 @@ int WaveView::sampleToClient(const QRect& rc, qint64 s) const
   return rc.left() + (int)(((double)(s - m_viewPosition) / zoom) + 0.5);
 }
 
+int WaveView::selectMipmap(const QRect& waveRect) const
+{
+  // Use the coarsest level that still has a value per column (or -1 for the
+  // samples themselves, the caller holds the peak data lock):
+  double factor = (double)m_viewLength / waveRect.width();
+  int mip = m_document->peakData().mipmapCount() - 1;
+  while (mip >= 0 && factor < m_document->peakData().mipmaps()[mip].divisionFactor())
+    mip--;
+  return mip;
+}
+
+QRect WaveView::peakColumns(const QRect& waveRect, qint64 start, qint64 length) const
+{
+  // Anything drawn from the peaks (the levels must not be swapped meanwhile)?
+  QReadLocker locker(m_document != 0 ? &m_document->peakDataLock() : 0);
+  if (m_document == 0 || !m_document->peakData().valid() || length <= 0)
+    return QRect();
+  int mip = selectMipmap(waveRect);
+  if (mip < 0)
+    return QRect();
+
+  // Whole peak values changed:
+  qint64 factor = m_document->peakData().mipmaps()[mip].divisionFactor();
+  qint64 first = (start / factor) * factor;
+  qint64 last = ((start + length + factor - 1) / factor) * factor;
+
+  // Columns that show them (a column may start inside of a value):
+  int x1 = qMax(sampleToClient(waveRect, first) - 1, waveRect.left());
+  int x2 = qMin(sampleToClient(waveRect, last) + 1, waveRect.right());
+  if (x2 < x1)
+    return QRect();
+  return QRect(x1, waveRect.top(), x2 - x1 + 1, waveRect.height());
+}
+
 void WaveView::emitViewportChanged()
 {
   // Notify listeners:
@@ -824,7 +940,16 @@ void WaveView::emitViewportChanged()
 
 void WaveView::peaksChanged()
 {
+  // The document may have shrunk:
+  setViewport(m_viewPosition, m_viewLength);
+
   // Update viewport:
   emitViewportChanged();
   update();
 }
+
+void WaveView::peakRangeChanged(qint64 start, qint64 length)
+{
+  // Only some columns have new peaks:
+  onPeakRangeChanged(start, length);
+}
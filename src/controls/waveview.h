@@ -22,6 +22,8 @@ public:
   void setDrawChannelDivider(bool newState);
   bool drawBackGradients() const;
   void setDrawBackGradients(bool newState);
+  bool drawRms() const;
+  void setDrawRms(bool newState);
   double zoomV() const;
   void setZoomV(double newZoom);
   double posV() const;
@@ -41,6 +43,8 @@ public:
   void setHalfColor(const QColor& newColor);
   const QColor& waveColor() const;
   void setWaveColor(const QColor& newColor);
+  const QColor& rmsColor() const;
+  void setRmsColor(const QColor& newColor);
   const QColor& upperColor() const;
   void setUpperColor(const QColor& newColor);
   const QColor& lowerColor() const;
@@ -59,19 +63,23 @@ signals:
 protected:
 
   virtual void onViewportChanged();
+  virtual void onPeakRangeChanged(qint64 start, qint64 length);
 
-  void drawPeaks(QRect& waveRect, QPainter& painter);
+  void drawPeaks(QRect& waveRect, QPainter& painter, const QRect& updateRect = QRect());
   void drawSelection(QRect& waveRect, QPainter& painter);
   void drawPlayCursor(QRect& waveRect, QPainter& painter);
   void drawUpdateState(QRect& waveRect, QPainter& painter);
 
   qint64 clientToSample(const QRect& rc, const int x) const;
   int sampleToClient(const QRect& rc, qint64 s) const;
+  int selectMipmap(const QRect& waveRect) const;
+  QRect peakColumns(const QRect& waveRect, qint64 start, qint64 length) const;
   void emitViewportChanged();
 
 private slots:
 
   void peaksChanged();
+  void peakRangeChanged(qint64 start, qint64 length);
 
 private:
 
@@ -79,6 +87,7 @@ private:
   bool m_drawHalfLine;
   bool m_drawChannelDivider;
   bool m_drawBackGradients;
+  bool m_drawRms;
   double m_zoomV;
   double m_zoomVOverlap;
   double m_posV;
@@ -88,11 +97,13 @@ private:
   QColor m_centerColor;
   QColor m_halfColor;
   QColor m_waveColor;
+  QColor m_rmsColor;
   QColor m_upperColor;
   QColor m_lowerColor;
   QColor m_dividerColor;
   QColor m_selectionBackColor;
   QColor m_selectionBorderColor;
+  FloatSampleBuffer m_rawBuffer;
 };
 
 #endif // WAVEVIEW_H
@@ -25,10 +25,74 @@
 /// Floor, Boston, MA 02110-1301, USA.
 ////////////////////////////////////////////////////////////////////////////////
 #include "document.h"
+#include "documentmanager.h"
 #include "audio/samplebuffer.h"
 #include "audio/sndfilesnippet.h"
+#include "audio/mappedsnippet.h"
 #include "audio/audiosystemqt.h"
+#include "audio/memorysnippet.h"
+#include "audio/peakcache.h"
+#include "commands/appundocommand.h"
 #include <sndfile.h>
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+// Peak building: frames per chunk that a worker scans at once, frames per read
+// and the max. number of workers (each one needs its own reader):
+static const int s_peakChunkFrames = 1048576;
+static const int s_peakBlockFrames = 16384;
+static const int s_maxPeakWorkers  = AudioSnippet::ReaderCount - AudioSnippet::PeakWorkerReader + 1;
+
+////////////////////////////////////////////////////////////////////////////////
+// Milliseconds between two progress notifications of the peak build (so views
+// repaint at most 30 times per second):
+static const int s_peakNotifyInterval = 33;
+
+////////////////////////////////////////////////////////////////////////////////
+///\brief Deleter for sources that live in a temporary file.
+struct SpillFileDeleter
+{
+  QString fileName; ///> The file to remove.
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SpillFileDeleter::SpillFileDeleter()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief Initialization constructor of this class.
+  ///\param [in] name: The file to remove.
+  //////////////////////////////////////////////////////////////////////////////
+  SpillFileDeleter(const QString& name) :
+    fileName(name)
+  {
+    // Nothing to do here.
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // SpillFileDeleter::operator ()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief Delete the source and its file.
+  ///\param [in] source: The source to delete.
+  //////////////////////////////////////////////////////////////////////////////
+  void operator () (AudioSnippet* source) const
+  {
+    // Close the file before removing it:
+    delete source;
+    QFile::remove(fileName);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// largerSource()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Sort helper for the largest in-memory sources first.
+///\param   [in] a: The first source.
+///\param   [in] b: The second source.
+///\return  true if a takes more RAM than b.
+////////////////////////////////////////////////////////////////////////////////
+static bool largerSource(const QSharedPointer<AudioSnippet>& a, const QSharedPointer<AudioSnippet>& b)
+{
+  // Compare sizes:
+  return a->memorySize() > b->memorySize();
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // Document::Document()
@@ -49,13 +113,28 @@ Document::Document(DocumentManager* manager, QObject* parent) :
   m_looping(false),
   m_undoStack(0),
   m_manager(manager),
-  m_fileHandle(0),
   m_sampleRate(0.0),
   m_numChannels(0),
   m_sampleCount(0),
   m_format(0),
   m_updatingPeaks(false),
   m_peakThread(this),
+  m_playbackStream(this),
+  m_openThread(0),
+  m_opening(false),
+  m_editCount(0),
+  m_saveEditCount(0),
+  m_undoBudget(256 * 1024 * 1024),
+  m_swapStore(new SwapStore()),
+  m_ramThreshold(1024 * 1024 * 1024),
+  m_peakCacheSize(512 * 1024 * 1024),
+  m_peakWorkers(QThread::idealThreadCount()),
+  m_peakBaseFactor(128),
+  m_peakLevelRatio(4),
+  m_peakChunkLevels(0),
+  m_peaksComplete(false),
+  m_peakDirtyStart(0),
+  m_peakDirtyEnd(0),
   m_fps(30),
   m_dropFrame(false),
   m_timeSigNum(4),
@@ -67,8 +146,12 @@ Document::Document(DocumentManager* manager, QObject* parent) :
   m_timeMode(Time),
   m_rack(this)
 {
+  // Progress notifications cross threads:
+  qRegisterMetaType<qint64>("qint64");
+
   // Create undo stack:
   m_undoStack = new QUndoStack(this);
+  connect(m_undoStack, SIGNAL(indexChanged(int)), this, SLOT(trimUndoPayload()));
 
   // Get default time values:
   QSettings settings;
@@ -90,6 +173,37 @@ Document::Document(DocumentManager* manager, QObject* parent) :
   // Get default peak values:
   if (settings.contains("scaleDefaults/mode"))
     m_scaleMode = (ScaleMode)settings.value("scaleDefaults/mode").toInt();
+
+  // Get the undo memory budget (in MB):
+  if (settings.contains("undo/memoryBudget"))
+    m_undoBudget = settings.value("undo/memoryBudget").toLongLong() * 1024 * 1024;
+
+  // Get the RAM threshold for sources (in MB):
+  if (settings.contains("swap/memoryThreshold"))
+    m_ramThreshold = settings.value("swap/memoryThreshold").toLongLong() * 1024 * 1024;
+
+  // Get the size limit of the peak cache (in MB, zero disables it):
+  if (settings.contains("peaks/cacheSize"))
+    m_peakCacheSize = settings.value("peaks/cacheSize").toLongLong() * 1024 * 1024;
+
+  // Get the number of peak building threads (one per core by default):
+  if (settings.contains("peaks/workerCount"))
+    m_peakWorkers = settings.value("peaks/workerCount").toInt();
+
+  // Get the peak pyramid layout (samples per value of the finest level and
+  // the factor between two levels):
+  if (settings.contains("peaks/baseFactor"))
+    m_peakBaseFactor = qMax(1, settings.value("peaks/baseFactor").toInt());
+  if (settings.contains("peaks/levelRatio"))
+    m_peakLevelRatio = qMax(2, settings.value("peaks/levelRatio").toInt());
+
+  // Forward save events:
+  connect(&m_saveThread, SIGNAL(progress(int)), this, SIGNAL(saveProgress(int)));
+  connect(&m_saveThread, SIGNAL(finished()), this, SLOT(saveThreadFinished()));
+
+  // Forward bounce events:
+  connect(&m_bounceThread, SIGNAL(progress(int)), this, SIGNAL(bounceProgress(int)));
+  connect(&m_bounceThread, SIGNAL(finished()), this, SLOT(bounceThreadFinished()));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -100,12 +214,18 @@ Document::Document(DocumentManager* manager, QObject* parent) :
 ////////////////////////////////////////////////////////////////////////////////
 Document::~Document()
 {
-  // Close the source file:
-  if (m_fileHandle != 0)
-    sf_close(static_cast<SNDFILE*>(m_fileHandle));
-  m_fileHandle = 0;
+  // Stop saving:
+  m_saveThread.cancel();
+  m_saveThread.wait();
 
-  // Clear play list:
+  // Stop rendering (it uses the rack):
+  m_bounceThread.cancel();
+  m_bounceThread.wait();
+
+  // Stop streaming:
+  m_playbackStream.stopStreaming();
+
+  // Clear play list (this closes the files that nobody else uses):
   for (int i = 0; i < m_playList.size(); i++)
     delete m_playList[i];
   m_playList.clear();
@@ -493,6 +613,20 @@ const PeakData& Document::peakData() const
   return m_peakData;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Document::peakDataLock()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the lock of the peak data.
+///\return  The lock.
+///\remarks The peak thread swaps in new mip maps when the layout changes,
+///         so the views hold this lock for reading while they use the
+///         levels of peakData().
+////////////////////////////////////////////////////////////////////////////////
+QReadWriteLock& Document::peakDataLock()
+{
+  return m_peakDataLock;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Document::lastError()
 ////////////////////////////////////////////////////////////////////////////////
@@ -789,6 +923,42 @@ const Rack& Document::rack() const
   return m_rack;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Document::playbackStream()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the playback stream of this document.
+///\return  The stream that reads ahead for the audio thread.
+////////////////////////////////////////////////////////////////////////////////
+PlaybackStream& Document::playbackStream()
+{
+  // Return the stream:
+  return m_playbackStream;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::playbackStream()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the playback stream of this document, const version.
+///\return  The stream that reads ahead for the audio thread.
+////////////////////////////////////////////////////////////////////////////////
+const PlaybackStream& Document::playbackStream() const
+{
+  // Return the stream:
+  return m_playbackStream;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::swapStore()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the swap file of this document.
+///\return  The store for samples that are paged out of RAM.
+////////////////////////////////////////////////////////////////////////////////
+const QSharedPointer<SwapStore>& Document::swapStore() const
+{
+  // Return the store:
+  return m_swapStore;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Document::composeTitle()
 ////////////////////////////////////////////////////////////////////////////////
@@ -821,10 +991,10 @@ bool Document::loadFile(const QString& fileName)
   close();
 
   // Open the file:
-  SF_INFO info;
-  QByteArray fn = fileName.toLocal8Bit();
-  m_fileHandle = sf_open(fn, SFM_READ, &info);
-  if (m_fileHandle == 0)
+  double sampleRate = 0.0;
+  int format = 0;
+  AudioSnippet* source = openSource(fileName, sampleRate, format);
+  if (source == 0)
   {
     // Save failure reason:
     m_lastError = QString(sf_strerror(0));
@@ -833,283 +1003,1852 @@ bool Document::loadFile(const QString& fileName)
     return false;
   }
 
-  // Create playlist entry:
-  m_playList.append(new SndFileSnippet(m_fileHandle, info.channels, info.frames));
+  // Take it as contents:
+  installSource(source, fileName, sampleRate, format);
 
-  // Save file name:
+  // Return success:
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::open()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Start loading a file in the background.
+///\param   [in] fileName: Name of the file to load.
+///\return  true if the open was started or false otherwise.
+///\remarks The document stays empty (but has its file name) until the
+///         header was parsed, so a view can be shown right away.
+///         openFinished() is emitted when done, see lastError() on failure.
+////////////////////////////////////////////////////////////////////////////////
+bool Document::open(const QString& fileName)
+{
+  // Close the previous file:
+  close();
+
+  // Parse the header on a worker of its own, it deletes itself when done
+  // (so nobody has to wait for it if the document is closed meanwhile):
+  OpenThread* thread = new OpenThread();
+  connect(thread, SIGNAL(finished()), this, SLOT(openThreadFinished()));
+  connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+  if (!thread->startOpen(fileName))
+  {
+    delete thread;
+    m_lastError = tr("The document can't be opened.");
+    return false;
+  }
+  m_openThread = thread;
+  m_opening = true;
+
+  // The title shows the file already:
   m_fileName = fileName;
 
+  // Return success:
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::opening()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Check if a background open is running.
+///\return  true until the file is loaded or failed to load.
+////////////////////////////////////////////////////////////////////////////////
+bool Document::opening() const
+{
+  // Return state:
+  return m_opening;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::create()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Set this document up as a new empty file.
+///\param   [in] numChannels: Number of channels of the new document.
+///\param   [in] sampleRate:  Samples per second of a channel.
+///\remarks Use insertSnippets() to fill the document afterwards.
+////////////////////////////////////////////////////////////////////////////////
+void Document::create(int numChannels, double sampleRate)
+{
+  // Close the previous file:
+  close();
+
   // Save properties:
-  m_format      = info.format;
-  m_numChannels = info.channels;
-  m_sampleRate  = info.samplerate;
-  m_sampleCount = info.frames;
+  m_format      = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+  m_numChannels = numChannels;
+  m_sampleRate  = sampleRate;
+  m_sampleCount = 0;
 
-  // Update peak data:
-  m_peakThread.start();
+  // Start reading ahead for playback:
+  m_playbackStream.startStreaming(m_numChannels, m_sampleRate);
 
   // Start rack:
   m_rack.setBlockSize(AudioSystemQt::blockSize());
   m_rack.setSampleRate(AudioSystemQt::sampleRate());
   m_rack.resume();
-
-  // Return success:
-  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::readSamples()
+// Document::openSource()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief   Read a group of samples from the current file.
-///\param   [in] offset:       Starting sample to read.
-///\param   [in] buffer:       The buffer to fill.
-///\param   [in] sampleFrames: The number of frames to read.
-///\return  The actual number of samples read.
-///\remarks Samples are only counted for a single channel here so for the
-///         count it doesn't matter how many channels there are.
+///\brief   Open an audio file as a play list source.
+///\param   [in]  fileName:   Name of the file to open.
+///\param   [out] sampleRate: Samples per second of the file.
+///\param   [out] format:     Id of the file format.
+///\return  The new source or 0 on error (see sf_strerror(0) then).
+///\remarks Uncompressed files are mapped, everything else is decoded by
+///         libsndfile. The caller owns the source.
 ////////////////////////////////////////////////////////////////////////////////
-qint64 Document::readSamples(qint64 offset, SampleBuffer& buffer, unsigned int sampleFrames)
+AudioSnippet* Document::openSource(const QString& fileName, double& sampleRate, int& format)
 {
-  // Anything to do?
-  if (m_fileHandle == 0 || m_playList.empty())
+  // Open the file:
+  SF_INFO info;
+  QByteArray fn = fileName.toLocal8Bit();
+  SNDFILE* handle = sf_open(fn, SFM_READ, &info);
+  if (handle == 0)
     return 0;
 
-  // Loop through play list items:
-  for (int i = 0; i < m_playList.size(); i++)
-  {
-    if (offset > m_playList[i]->sampleCount())
-    {
-      offset -= m_playList[i]->sampleCount();
-      continue;
-    }
+  // Save properties:
+  sampleRate = info.samplerate;
+  format     = info.format;
 
-    // Read first buffer:
-    return m_playList[i]->readSamples(offset, sampleFrames, buffer);
-//    while (samplesRead > 0 && m_updatingPeaks)
-//    {
-//      // Add to mipmaps:
-//      for (int j = 0; j < m_peakData.mipmapCount() && m_updatingPeaks; j++)
-//        m_peakData.mipmaps()[j].addSamples(samplesRead, buffer);
-
-//      // Read next bunch of samples:
-//      offset += samplesRead;
-//      samplesRead = m_playList[i]->readSamples(offset, bufferSize, buffer);
-
-//      // Need update?
-//      updateCounter++;
-//      if (updateCounter > 100)
-//      {
-//        updateCounter = 0;
-//        emitPeaksChanged();
-//      }
-//    }
+  // Uncompressed files are mapped directly:
+  MappedSnippet* mapped = new MappedSnippet(info.channels, info.frames);
+  if (mapped->open(fileName, info.format))
+  {
+    sf_close(handle);
+    return mapped;
   }
+  delete mapped;
 
-  return 0;
+  // Decode everything else (the snippet takes over the handle):
+  return new SndFileSnippet(fileName, handle, info.channels, info.frames, info.format);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::close()
+// Document::openSpillFile()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief   Close this document.
-///\remarks This will cleanup the used resources.
+///\brief   Open a temporary audio file as a play list source.
+///\param   [in]  fileName:   Name of the file to open.
+///\param   [out] sampleRate: Samples per second of the file.
+///\return  The new source or a null pointer on error.
+///\remarks The file is removed with the last reference to the source, or
+///         right away if it can't be opened.
 ////////////////////////////////////////////////////////////////////////////////
-void Document::close()
+QSharedPointer<AudioSnippet> Document::openSpillFile(const QString& fileName, double& sampleRate)
 {
-  // Stop peak thread:
-  if (m_updatingPeaks)
+  // Open it like any other file:
+  int format = 0;
+  AudioSnippet* source = openSource(fileName, sampleRate, format);
+  if (source == 0)
   {
-    m_updatingPeaks = false;
-    m_peakThread.wait();
+    QFile::remove(fileName);
+    return QSharedPointer<AudioSnippet>();
   }
 
-  // Stop rack:
-  m_rack.suspend();
+  // Remove the file with the source:
+  return QSharedPointer<AudioSnippet>(source, SpillFileDeleter(fileName));
+}
 
-  // Close the source file:
-  if (m_fileHandle != 0)
-    sf_close(static_cast<SNDFILE*>(m_fileHandle));
-  m_fileHandle = 0;
+////////////////////////////////////////////////////////////////////////////////
+// Document::save()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Start saving this document in the background.
+///\param   [in] fileName: Name of the target file.
+///\return  true if the save was started or false otherwise.
+///\remarks The current play list is saved, edits made meanwhile are not part
+///         of the file. The file is written with the format of the document.
+///         saveFinished() is emitted when done, see lastError() on failure.
+////////////////////////////////////////////////////////////////////////////////
+bool Document::save(const QString& fileName)
+{
+  // Save a snapshot of the play list:
+  QList<SubSnippet*> snapshot = copySnippets(0, m_sampleCount);
+  if (!m_saveThread.startSave(snapshot, fileName, m_format, m_numChannels, m_sampleRate))
+  {
+    qDeleteAll(snapshot);
+    m_lastError = tr("The document is already being saved.");
+    return false;
+  }
 
-  // Clear play list:
-  for (int i = 0; i < m_playList.size(); i++)
-    delete m_playList[i];
-  m_playList.clear();
+  // Remember the state that is being saved:
+  m_saveEditCount = m_editCount;
 
-  // Reset properties:
-  m_fileName    = "";
-  m_format      = 0;
-  m_numChannels = 0;
-  m_sampleRate  = 0.0;
-  m_sampleCount = 0;
+  // Return success:
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::emitSelectionChanged()
+// Document::saving()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the selectionChanged() event.
+///\brief   Check if a background save is running.
+///\return  true while saving.
 ////////////////////////////////////////////////////////////////////////////////
-void Document::emitSelectionChanged()
+bool Document::saving() const
 {
-  // Notify listeners:
-  if (!signalsBlocked())
-    emit selectionChanged();
+  // Ask the thread:
+  return m_saveThread.isRunning();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::emitSelectionChanging()
+// Document::saveThread()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the selectionChanging() event.
+///\brief   Access the background save of this document.
+///\return  The save thread (target file, result of the last save).
 ////////////////////////////////////////////////////////////////////////////////
-void Document::emitSelectionChanging()
+const SaveThread& Document::saveThread() const
 {
-  // Notify listeners:
-  if (!signalsBlocked())
-    emit selectionChanging();
+  // Return the thread:
+  return m_saveThread;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::emitClosed()
+// Document::cancelSave()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the closed() event.
+///\brief   Abort the running background save.
+///\remarks The target file stays untouched.
 ////////////////////////////////////////////////////////////////////////////////
-void Document::emitClosed()
+void Document::cancelSave()
 {
-  // Notify listeners:
-  if (!signalsBlocked())
-    emit closed();
+  // Stop the thread:
+  m_saveThread.cancel();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::emitDirtyChanged()
+// Document::bounce()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the dirtyChanged() event.
+///\brief   Start rendering a range through the rack into a file.
+///\param   [in] fileName: Name of the target file.
+///\param   [in] format:   Id of the file format.
+///\param   [in] start:    First frame of the range.
+///\param   [in] length:   Number of frames of the range.
+///\return  true if the render was started or false otherwise.
+///\remarks The render runs in the background as fast as possible, the
+///         realtime output of the rack is silent meanwhile. bounceFinished()
+///         is emitted when done, see lastError() on failure.
 ////////////////////////////////////////////////////////////////////////////////
-void Document::emitDirtyChanged()
+bool Document::bounce(const QString& fileName, int format, qint64 start, qint64 length)
 {
-  // Notify listeners:
-  if (!signalsBlocked())
-    emit dirtyChanged();
+  // Check range:
+  if (start < 0 || length <= 0 || start + length > m_sampleCount)
+  {
+    m_lastError = tr("There is nothing to render.");
+    return false;
+  }
+
+  // Render a snapshot of the play list:
+  QList<SubSnippet*> snapshot = copySnippets(start, length);
+  if (!m_bounceThread.startBounce(&m_rack, snapshot, fileName, format, m_numChannels, m_sampleRate))
+  {
+    qDeleteAll(snapshot);
+    m_lastError = tr("The rack is already being rendered.");
+    return false;
+  }
+
+  // Return success:
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::emitPeaksChanged()
+// Document::bouncing()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the peaksChanged() event.
+///\brief   Check if an offline render is running.
+///\return  true while rendering.
 ////////////////////////////////////////////////////////////////////////////////
-void Document::emitPeaksChanged()
+bool Document::bouncing() const
 {
-  // Notify listeners:
-  if (!signalsBlocked())
-    emit peaksChanged();
+  // Ask the thread:
+  return m_bounceThread.isRunning();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::emitCursorPosChanged()
+// Document::bounceThread()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the cursorPosChanged() event.
+///\brief   Access the offline render of this document.
+///\return  The render thread (target file, speed of the last render).
 ////////////////////////////////////////////////////////////////////////////////
-void Document::emitCursorPosChanged()
+const BounceThread& Document::bounceThread() const
 {
-  // Notify listeners:
-  if (!signalsBlocked())
-    emit cursorPosChanged();
+  // Return the thread:
+  return m_bounceThread;
 }
 
-//////////////////////////////////////////////////////////////////////////////
-// Document::emitTimeFormatChanged()
-//////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the timeFormatChanged() event.
-//////////////////////////////////////////////////////////////////////////////
-void Document::emitTimeFormatChanged()
+////////////////////////////////////////////////////////////////////////////////
+// Document::cancelBounce()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Abort the running offline render.
+///\remarks The target file stays untouched.
+////////////////////////////////////////////////////////////////////////////////
+void Document::cancelBounce()
 {
-  // Notify listeners:
-  if (!signalsBlocked())
-    emit timeFormatChanged();
+  // Stop the thread:
+  m_bounceThread.cancel();
 }
 
-//////////////////////////////////////////////////////////////////////////////
-// Document::emitScaleFormatChanged()
-//////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the scaleFormatChanged() event.
-//////////////////////////////////////////////////////////////////////////////
-void Document::emitScaleFormatChanged()
+////////////////////////////////////////////////////////////////////////////////
+// Document::saveThreadFinished()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Handler for the end of a background save.
+///\remarks If the document wasn't changed meanwhile it reads from the new
+///         file from now on and is clean again.
+////////////////////////////////////////////////////////////////////////////////
+void Document::saveThreadFinished()
 {
-  // Notify listeners:
-  if (!signalsBlocked())
-    emit scaleFormatChanged();
+  // Failed?
+  if (!m_saveThread.succeeded())
+  {
+    m_lastError = m_saveThread.lastError();
+    emit saveFinished(false);
+    return;
+  }
+
+  // The document belongs to the new file now:
+  m_fileName = m_saveThread.fileName();
+
+  // Anything changed while saving?
+  if (m_editCount == m_saveEditCount)
+  {
+    // Read from the new file, so the old pieces and files can go:
+    double sampleRate = 0.0;
+    int format = 0;
+    AudioSnippet* source = openSource(m_fileName, sampleRate, format);
+    if (source != 0 && source->sampleCount() == m_sampleCount && source->channelCount() == m_numChannels)
+    {
+      // The samples are the same, so the peaks stay valid:
+      const bool updatingPeaks = m_updatingPeaks;
+      beginEdit();
+      m_playListLock.lockForWrite();
+      clearPlayList();
+      m_playList.append(new SubSnippet(QSharedPointer<AudioSnippet>(source), 0, m_sampleCount));
+      updateSnippetStarts();
+      m_playListLock.unlock();
+      m_playbackStream.invalidate();
+      if (updatingPeaks)
+        startPeakThread();
+    }
+    else
+      delete source;
+
+    // Clean again:
+    m_dirty = false;
+  }
+
+  // Notify listeners (this also updates the titles):
+  emitDirtyChanged();
+  emit saveFinished(true);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::emitMarkerChanged()
+// Document::bounceThreadFinished()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief Helper function to fire the markerChanged() event.
+///\brief   Handler for the end of an offline render.
 ////////////////////////////////////////////////////////////////////////////////
-void Document::emitMarkerChanged()
+void Document::bounceThreadFinished()
 {
+  // Failed?
+  if (!m_bounceThread.succeeded())
+  {
+    m_lastError = m_bounceThread.lastError();
+    emit bounceFinished(false);
+    return;
+  }
+
   // Notify listeners:
-  if (!signalsBlocked())
-    emit markerChanged();
+  emit bounceFinished(true);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Document::updatePeakData()
+// Document::openThreadFinished()
 ////////////////////////////////////////////////////////////////////////////////
-///\brief   Update the peak data of this document.
+///\brief   Handler for the end of a background open.
+///\remarks Fills the document with the new source, unless it was closed
+///         meanwhile. The thread deletes itself afterwards.
 ////////////////////////////////////////////////////////////////////////////////
-void Document::updatePeakData()
+void Document::openThreadFinished()
 {
-  // Already in loop?
-  if (m_updatingPeaks)
+  // Closed meanwhile (the thread drops its result then)?
+  OpenThread* thread = qobject_cast<OpenThread*>(sender());
+  if (thread == 0 || thread != m_openThread || !m_opening)
     return;
+  m_openThread = 0;
+  m_opening = false;
+
+  // Failed?
+  double sampleRate = 0.0;
+  int format = 0;
+  AudioSnippet* source = thread->takeSource(sampleRate, format);
+  if (source == 0)
+  {
+    m_lastError = thread->lastError();
+    emit openFinished(false);
+    return;
+  }
 
-  // Flag update:
-  m_updatingPeaks = true;
-
-  // Calc number of mip maps:
-  int numMips = 3;
-  if ((m_sampleCount / m_sampleRate) > 1000)
-    numMips++;
-
-  // Create the mip maps:
-  m_peakData.allocateMipMaps(numMips, m_numChannels, m_sampleRate, m_sampleCount);
+  // Take it as contents:
+  installSource(source, thread->fileName(), sampleRate, format);
 
-  // Create sample buffer:
-  const int bufferSize = 4096;
-  SampleBuffer buffer(m_numChannels, bufferSize);
+  // Notify listeners (the views were empty until now):
+  emit openFinished(true);
+  emitPeaksChanged();
+}
 
-  // Loop through play list items:
-  for (int i = 0; i < m_playList.size() && m_updatingPeaks; i++)
+////////////////////////////////////////////////////////////////////////////////
+// Document::trimUndoPayload()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Keep the memory of the undo stack inside of the budget.
+///\remarks Called whenever the stack changes. The newest commands keep
+///         their samples in memory, older ones are moved to disk until the
+///         total fits the budget again.
+////////////////////////////////////////////////////////////////////////////////
+void Document::trimUndoPayload()
+{
+  // Sum up the payload from the newest command down to the oldest:
+  qint64 total = 0;
+  for (int i = m_undoStack->count() - 1; i >= 0; i--)
   {
-    // Read first buffer:
-    int updateCounter = 0;
-    qint64 offset = 0;
-    int samplesRead = m_playList[i]->readSamples(offset, bufferSize, buffer);
-    while (samplesRead > 0 && m_updatingPeaks)
-    {
-      // Add to mipmaps:
-      for (int j = 0; j < m_peakData.mipmapCount() && m_updatingPeaks; j++)
-        m_peakData.mipmaps()[j].addSamples(samplesRead, buffer);
-
-      // Read next bunch of samples:
-      offset += samplesRead;
-      samplesRead = m_playList[i]->readSamples(offset, bufferSize, buffer);
+    // Only our own commands carry samples:
+    AppUndoCommand* cmd = dynamic_cast<AppUndoCommand*>(const_cast<QUndoCommand*>(m_undoStack->command(i)));
+    if (cmd == 0)
+      continue;
+    total += cmd->payloadSize();
 
-      // Need update?
-      updateCounter++;
-      if (updateCounter > 100)
-      {
-        updateCounter = 0;
-        emitPeaksChanged();
-      }
+    // Spill everything that doesn't fit anymore:
+    if (total > m_undoBudget)
+    {
+      const qint64 before = cmd->payloadSize();
+      cmd->spillPayload();
+      total -= before - cmd->payloadSize();
     }
   }
+}
 
-  // Flag update:
+////////////////////////////////////////////////////////////////////////////////
+// Document::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a group of samples from the current file.
+///\param   [in] offset:       Starting sample to read.
+///\param   [in] buffer:       The buffer to fill.
+///\param   [in] sampleFrames: The number of frames to read.
+///\param   [in] reader:       The consumer that reads (see AudioSnippet).
+///\return  The actual number of samples read.
+///\remarks Samples are only counted for a single channel here so for the
+///         count it doesn't matter how many channels there are. Reads that
+///         cross the border of a play list item continue in the next one.
+////////////////////////////////////////////////////////////////////////////////
+qint64 Document::readSamples(qint64 offset, SampleBuffer& buffer, unsigned int sampleFrames, AudioSnippet::Reader reader)
+{
+  // Lock the play list against edits:
+  QReadLocker locker(&m_playListLock);
+
+  // Read across all pieces in range:
+  return readPieces(offset, buffer, sampleFrames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::readSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a group of samples from the current file, float version.
+///\param   [in] offset:       Starting sample to read.
+///\param   [in] buffer:       The buffer to fill.
+///\param   [in] sampleFrames: The number of frames to read.
+///\param   [in] reader:       The consumer that reads (see AudioSnippet).
+///\return  The actual number of samples read.
+///\remarks Use this version if single precision is enough (eg. display).
+///         Display and shared reads are served from the block cache of the
+///         document manager. Reads that cross the border of a play list
+///         item continue in the next one.
+////////////////////////////////////////////////////////////////////////////////
+qint64 Document::readSamples(qint64 offset, FloatSampleBuffer& buffer, unsigned int sampleFrames, AudioSnippet::Reader reader)
+{
+  // Lock the play list against edits:
+  QReadLocker locker(&m_playListLock);
+
+  // Read across all pieces in range:
+  return readPieces(offset, buffer, sampleFrames, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::snippetCount()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the number of pieces in the play list.
+///\return  The number of play list items.
+///\remarks Every edit adds at most two pieces.
+////////////////////////////////////////////////////////////////////////////////
+int Document::snippetCount() const
+{
+  // Return play list size:
+  return m_playList.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::copySnippets()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Get the pieces that make up a range of this document.
+///\param   [in] start:  The first frame of the range.
+///\param   [in] length: The number of frames of the range.
+///\return  New pieces that refer to the same sources, owned by the caller.
+///\remarks No samples are copied, so this is cheap for any range.
+////////////////////////////////////////////////////////////////////////////////
+QList<SubSnippet*> Document::copySnippets(qint64 start, qint64 length)
+{
+  // Lock the play list against edits:
+  QReadLocker locker(&m_playListLock);
+
+  // Collect the parts of all pieces inside of the range:
+  QList<SubSnippet*> result;
+  const qint64 end = start + length;
+  for (int i = qMax(findSnippet(start), 0); i < m_playList.size() && m_snippetStarts[i] < end; i++)
+  {
+    SubSnippet* piece = m_playList[i];
+    const qint64 pos   = m_snippetStarts[i];
+    const qint64 first = qMax(start, pos);
+    const qint64 last  = qMin(end, pos + piece->sampleCount());
+    if (first < last)
+      result.append(new SubSnippet(piece->source(), piece->start() + first - pos, last - first));
+  }
+
+  // Return the pieces:
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::insertSnippets()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Insert pieces into the play list of this document.
+///\param   [in] position: The frame where to insert.
+///\param   [in] snippets: The pieces to insert.
+///\return  true if successful or false otherwise.
+///\remarks The document takes over the pieces on success. The insertion
+///         fails if the channel count of a piece doesn't match. The dirty
+///         state and the selection are not touched.
+////////////////////////////////////////////////////////////////////////////////
+bool Document::insertSnippets(qint64 position, const QList<SubSnippet*>& snippets)
+{
+  // Insert without removing anything:
+  QList<SubSnippet*> removed;
+  return replaceSamples(position, 0, snippets, removed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::removeSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Remove a range from the play list of this document.
+///\param   [in] start:  The first frame to remove.
+///\param   [in] length: The number of frames to remove.
+///\return  The removed pieces, owned by the caller.
+///\remarks Only the pieces at the borders are split, no samples are copied
+///         or moved. The dirty state and the selection are not touched.
+////////////////////////////////////////////////////////////////////////////////
+QList<SubSnippet*> Document::removeSamples(qint64 start, qint64 length)
+{
+  // Remove without inserting anything:
+  QList<SubSnippet*> removed;
+  replaceSamples(start, length, QList<SubSnippet*>(), removed);
+  return removed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::replaceSamples()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Replace a range of the play list of this document with pieces.
+///\param   [in]  start:    The first frame to replace.
+///\param   [in]  length:   The number of frames to replace.
+///\param   [in]  snippets: The pieces to insert at start.
+///\param   [out] removed:  The removed pieces, owned by the caller.
+///\return  true if successful or false otherwise.
+///\remarks The document takes over the pieces on success. Nothing changes
+///         if the channel count of a piece doesn't match. Both parts are
+///         done in a single edit, so the peaks and the playback buffer are
+///         only rebuilt once. The dirty state and the selection are not
+///         touched.
+////////////////////////////////////////////////////////////////////////////////
+bool Document::replaceSamples(qint64 start, qint64 length, const QList<SubSnippet*>& snippets, QList<SubSnippet*>& removed)
+{
+  // Check format:
+  removed.clear();
+  qint64 insertLength = 0;
+  for (int i = 0; i < snippets.size(); i++)
+  {
+    if (snippets[i]->channelCount() != m_numChannels)
+      return false;
+    insertLength += snippets[i]->sampleCount();
+  }
+
+  // Clip range:
+  if (start < 0)
+  {
+    length += start;
+    start = 0;
+  }
+  start = qMin(start, m_sampleCount);
+  length = qBound(qint64(0), length, m_sampleCount - start);
+
+  // Anything to do?
+  if (length == 0 && snippets.isEmpty())
+    return true;
+
+  // Cut the old pieces out and put the new ones in:
+  beginEdit();
+  m_playListLock.lockForWrite();
+  const int first = splitPlayList(start);
+  const int last  = splitPlayList(start + length);
+  removed = m_playList.mid(first, last - first);
+  m_playList.erase(m_playList.begin() + first, m_playList.begin() + last);
+  for (int i = 0; i < snippets.size(); i++)
+    m_playList.insert(first + i, snippets[i]);
+  updateSnippetStarts();
+  m_sampleCount += insertLength - length;
+  m_playListLock.unlock();
+  endEdit();
+
+  // Return success:
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::close()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Close this document.
+///\remarks This will cleanup the used resources.
+////////////////////////////////////////////////////////////////////////////////
+void Document::close()
+{
+  // Stop saving:
+  m_saveThread.cancel();
+  m_saveThread.wait();
+
+  // Stop rendering (it uses the rack):
+  m_bounceThread.cancel();
+  m_bounceThread.wait();
+
+  // Forget a running open, don't wait for the file system (the thread
+  // drops its result and deletes itself):
+  if (m_openThread != 0)
+    disconnect(m_openThread, SIGNAL(finished()), this, SLOT(openThreadFinished()));
+  m_openThread = 0;
+  m_opening = false;
+
+  // Stop peak thread:
+  stopPeakThread();
+
+  // Stop rack:
+  m_rack.suspend();
+
+  // Stop streaming:
+  m_playbackStream.stopStreaming();
+
+  // Clear play list:
+  m_playListLock.lockForWrite();
+  clearPlayList();
+  m_playListLock.unlock();
+
+  // Reset properties:
+  m_fileName    = "";
+  m_format      = 0;
+  m_numChannels = 0;
+  m_sampleRate  = 0.0;
+  m_sampleCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::emitSelectionChanged()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the selectionChanged() event.
+////////////////////////////////////////////////////////////////////////////////
+void Document::emitSelectionChanged()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit selectionChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::emitSelectionChanging()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the selectionChanging() event.
+////////////////////////////////////////////////////////////////////////////////
+void Document::emitSelectionChanging()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit selectionChanging();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::emitClosed()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the closed() event.
+////////////////////////////////////////////////////////////////////////////////
+void Document::emitClosed()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit closed();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::emitDirtyChanged()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the dirtyChanged() event.
+////////////////////////////////////////////////////////////////////////////////
+void Document::emitDirtyChanged()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit dirtyChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::emitPeaksChanged()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the peaksChanged() event.
+////////////////////////////////////////////////////////////////////////////////
+void Document::emitPeaksChanged()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit peaksChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::emitPeakRangeChanged()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Helper function to fire the peakRangeChanged() event.
+///\remarks Reports the frames whose peaks were finished since the last call,
+///         nothing is fired if there are none.
+////////////////////////////////////////////////////////////////////////////////
+void Document::emitPeakRangeChanged()
+{
+  // Take the finished range:
+  QMutexLocker locker(&m_peakEdgeMutex);
+  const qint64 start = m_peakDirtyStart;
+  const qint64 end = m_peakDirtyEnd;
+  m_peakDirtyStart = 0;
+  m_peakDirtyEnd = 0;
+  locker.unlock();
+
+  // Notify listeners:
+  if (end > start && !signalsBlocked())
+    emit peakRangeChanged(start, end - start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::emitCursorPosChanged()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the cursorPosChanged() event.
+////////////////////////////////////////////////////////////////////////////////
+void Document::emitCursorPosChanged()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit cursorPosChanged();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Document::emitTimeFormatChanged()
+//////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the timeFormatChanged() event.
+//////////////////////////////////////////////////////////////////////////////
+void Document::emitTimeFormatChanged()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit timeFormatChanged();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Document::emitScaleFormatChanged()
+//////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the scaleFormatChanged() event.
+//////////////////////////////////////////////////////////////////////////////
+void Document::emitScaleFormatChanged()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit scaleFormatChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::emitMarkerChanged()
+////////////////////////////////////////////////////////////////////////////////
+///\brief Helper function to fire the markerChanged() event.
+////////////////////////////////////////////////////////////////////////////////
+void Document::emitMarkerChanged()
+{
+  // Notify listeners:
+  if (!signalsBlocked())
+    emit markerChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::updatePeakData()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Update the peak data of this document.
+///\remarks Unchanged files take their peaks from the peak cache, the peaks
+///         of other files are put there after the scan. Edited documents
+///         keep the peaks of the last update where the play list didn't
+///         change (see shiftPeaks()), the rest is put together from the
+///         peaks of their sources (see composePeaks()), only the edges of
+///         the pieces are scanned and patched into the coarser levels
+///         afterwards.
+////////////////////////////////////////////////////////////////////////////////
+void Document::updatePeakData()
+{
+  // Not complete until the end (m_updatingPeaks was set by the starter):
+  m_peaksComplete = false;
+
+  // The play list that the peaks will show:
+  const QVector<PeakPiece> pieces = peakPieces();
+
+  // An unchanged file may have its peaks in the cache already:
+  const bool cacheable = m_peakCacheSize > 0 && !m_dirty && !m_fileName.isEmpty() && m_playList.size() == 1 &&
+                         m_playList[0]->start() == 0 && m_playList[0]->sampleCount() == m_playList[0]->source()->sampleCount();
+  PeakData next;
+  if (cacheable && PeakCache::load(m_fileName, m_numChannels, m_sampleRate, m_sampleCount, next))
+  {
+    swapPeakData(next);
+    m_peakPieces = pieces;
+    m_peaksComplete = true;
+    m_updatingPeaks = false;
+    emitPeaksChanged();
+    return;
+  }
+
+  // A complete file is scanned as a whole, anything else reuses the peaks of
+  // the last update and of its sources:
+  QVector<QPair<qint64, qint64> > ranges;
+  QVector<qint64> tails;
+  qint64 changeStart = 0;
+  qint64 changeEnd = m_sampleCount;
+  const bool complete = m_playList.size() == 1 && m_playList[0]->start() == 0 &&
+                        m_playList[0]->sampleCount() == m_playList[0]->source()->sampleCount() &&
+                        !m_sourcePeaks.contains(m_playList[0]->source()->id());
+  if (complete || !shiftPeaks(pieces, changeStart, changeEnd, tails))
+  {
+    // Create the mip maps (aside, the views may be drawing the old ones):
+    next.allocateMipMaps(m_numChannels, m_sampleRate, m_sampleCount, m_peakBaseFactor, m_peakLevelRatio);
+    swapPeakData(next);
+    next.clear();
+    tails.fill(m_sampleCount, m_peakData.mipmapCount());
+  }
+  m_peakPieces.clear();
+  const bool incremental = m_peakData.mipmapCount() > 0 && !complete;
+  if (incremental)
+  {
+    for (int i = 0; i < m_peakData.mipmapCount(); i++)
+      m_peakData.mipmaps()[i].setFrameCount(m_sampleCount);
+    m_peakChunkLevels = 1;
+    composePeaks(changeStart, changeEnd, ranges);
+  }
+  else
+  {
+    m_peakChunkLevels = m_peakData.mipmapCount();
+    ranges.append(qMakePair(qint64(0), m_sampleCount));
+  }
+
+  // Show the new layout, the workers' results follow as they come in:
+  emitPeaksChanged();
+
+  // Split the ranges into chunks, the workers take them one by one:
+  m_peakChunks.clear();
+  for (int i = 0; i < ranges.size(); i++)
+  {
+    for (qint64 start = ranges[i].first; start < ranges[i].second; start += s_peakChunkFrames)
+      m_peakChunks.append(qMakePair(start, qMin(start + s_peakChunkFrames, ranges[i].second)));
+  }
+  m_nextPeakChunk.store(0);
+  m_peakDirtyStart = 0;
+  m_peakDirtyEnd = 0;
+  m_peakEdges = QVector<QHash<qint64, qint64> >(m_peakData.mipmapCount());
+  QList<PeakWorker*> workers;
+  const int numWorkers = qBound(1, m_peakWorkers, s_maxPeakWorkers);
+  for (int i = 0; i < numWorkers && i < m_peakChunks.size(); i++)
+  {
+    workers.append(new PeakWorker(this, i));
+    workers.last()->start();
+  }
+
+  // Wait for them, the views show the progress meanwhile:
+  for (int i = 0; i < workers.size(); i++)
+  {
+    while (!workers[i]->wait(s_peakNotifyInterval))
+      emitPeakRangeChanged();
+  }
+  qDeleteAll(workers);
+  m_peakEdges.clear();
+  m_peakChunks.clear();
+
+  // Only the finest level was scanned, patch the others where it changed:
+  for (int i = 0; incremental && i < ranges.size() && m_updatingPeaks; i++)
+    reducePeakRange(ranges[i].first, ranges[i].second);
+
+  // Coarser levels that couldn't be shifted are rebuilt behind the change:
+  for (int i = 1; incremental && i < tails.size() && m_updatingPeaks; i++)
+    m_peakData.mipmaps()[i].reduceRange(m_peakData.mipmaps()[i - 1], tails[i], m_sampleCount);
+
+  // Keep complete peaks for the next time the file is opened:
+  if (cacheable && m_updatingPeaks)
+    PeakCache::store(m_fileName, m_peakData, m_peakCacheSize);
+
+  // Give the files of the peak readers back:
+  releasePeakReaders();
+
+  // Flag update (an interrupted update leaves nothing to reuse):
+  if (m_updatingPeaks)
+    m_peakPieces = pieces;
+  m_peaksComplete = m_updatingPeaks;
   m_updatingPeaks = false;
 
   // Final update:
   emitPeaksChanged();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Document::peakPieces()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Describe the play list for the comparison of peak updates.
+///\return  Source id and range of every play list item.
+////////////////////////////////////////////////////////////////////////////////
+QVector<Document::PeakPiece> Document::peakPieces() const
+{
+  QVector<PeakPiece> pieces(m_playList.size());
+  for (int i = 0; i < m_playList.size(); i++)
+  {
+    pieces[i].source = m_playList[i]->source()->id();
+    pieces[i].start  = m_playList[i]->start();
+    pieces[i].count  = m_playList[i]->sampleCount();
+  }
+  return pieces;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::shiftPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Keep the peaks of the last update where the play list is the same.
+///\param   [in]  pieces: The current play list (see peakPieces()).
+///\param   [out] start:  First frame of the range that must be composed.
+///\param   [out] end:    Frame after that range.
+///\param   [out] tails:  Per level, the frame from where it must be reduced
+///                       again up to the end of the document.
+///\return  true if the peaks were kept, false if they must be built anew.
+///\remarks Frames before the first and after the last changed piece keep
+///         their peaks. If the length is the same, the levels stay as they
+///         are, so the views keep showing them. Otherwise new levels are
+///         made with the head copied and the tail shifted by the length
+///         difference. The tail values of a level only move as a whole if
+///         the difference is a multiple of its division factor, the others
+///         are composed (finest level) or reduced (see tails) again.
+////////////////////////////////////////////////////////////////////////////////
+bool Document::shiftPeaks(const QVector<PeakPiece>& pieces, qint64& start, qint64& end, QVector<qint64>& tails)
+{
+  // Complete peaks of the last update on the same grid?
+  const int numMips = m_peakData.mipmapCount();
+  if (m_peakPieces.isEmpty() || !m_peakData.valid() || m_peakData.channelCount() != m_numChannels ||
+      m_peakData.sampleRate() != m_sampleRate || m_peakData.mipmaps()[0].divisionFactor() != m_peakBaseFactor ||
+      (numMips > 1 && m_peakData.mipmaps()[1].divisionFactor() != m_peakBaseFactor * m_peakLevelRatio))
+    return false;
+
+  // Frames at the start that didn't change (the same piece may have become
+  // shorter or longer at its end):
+  const QVector<PeakPiece>& last = m_peakPieces;
+  qint64 head = 0;
+  for (int i = 0; i < pieces.size() && i < last.size(); i++)
+  {
+    if (pieces[i].source != last[i].source || pieces[i].start != last[i].start)
+      break;
+    head += qMin(pieces[i].count, last[i].count);
+    if (pieces[i].count != last[i].count)
+      break;
+  }
+
+  // Frames at the end that didn't change (the same for the piece starts):
+  const qint64 oldCount = m_peakData.sampleCount();
+  qint64 tail = 0;
+  for (int i = pieces.size() - 1, j = last.size() - 1; i >= 0 && j >= 0; i--, j--)
+  {
+    if (pieces[i].source != last[j].source || pieces[i].start + pieces[i].count != last[j].start + last[j].count)
+      break;
+    tail += qMin(pieces[i].count, last[j].count);
+    if (pieces[i].count != last[j].count)
+      break;
+  }
+  tail = qMin(tail, qMin(oldCount, m_sampleCount) - head);
+
+  // The range to compose on the finest level:
+  const qint64 delta = m_sampleCount - oldCount;
+  const qint64 factor = m_peakBaseFactor;
+  start = (head / factor) * factor;
+  end = delta % factor == 0 ? qMin(((m_sampleCount - tail + factor - 1) / factor) * factor, m_sampleCount) : m_sampleCount;
+  if (end < start)
+    end = start;
+
+  // Same length, the levels stay:
+  if (delta == 0)
+  {
+    tails.fill(m_sampleCount, numMips);
+    return true;
+  }
+
+  // New levels:
+  PeakData next;
+  next.allocateMipMaps(m_numChannels, m_sampleRate, m_sampleCount, m_peakBaseFactor, m_peakLevelRatio);
+  if (!next.valid())
+    return false;
+  tails.fill(m_sampleCount, next.mipmapCount());
+  for (int i = 0; i < next.mipmapCount(); i++)
+  {
+    // Levels that didn't exist are reduced completely:
+    MipmapLevel& target = next.mipmaps()[i];
+    if (i >= numMips)
+    {
+      tails[i] = 0;
+      continue;
+    }
+    const MipmapLevel& source = m_peakData.mipmaps()[i];
+    const qint64 levelFactor = target.divisionFactor();
+
+    // Copy the values before the change:
+    const qint64 headValues = qMin(head / levelFactor, qMin(target.sampleCount(), source.sampleCount()));
+    for (int c = 0; c < m_numChannels; c++)
+      memcpy(target.samples()[c], source.samples()[c], headValues * sizeof(PeakSample));
+
+    // Shift the values after the change, if they stay whole:
+    if (delta % levelFactor != 0)
+    {
+      tails[i] = end;
+      continue;
+    }
+    const qint64 first = (m_sampleCount - tail + levelFactor - 1) / levelFactor;
+    const qint64 shift = delta / levelFactor;
+    const qint64 count = qMin(target.sampleCount() - first, source.sampleCount() - (first - shift));
+    for (int c = 0; count > 0 && c < m_numChannels; c++)
+      memcpy(target.samples()[c] + first, source.samples()[c] + first - shift, count * sizeof(PeakSample));
+  }
+
+  // Show them (the old ones are freed with next):
+  swapPeakData(next);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::swapPeakData()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Replace the peak data with peaks built aside.
+///\param   [in,out] peaks: The new peaks, gets the old ones.
+///\remarks The views can't use the old levels anymore once the lock is
+///         released, so the caller may free them afterwards.
+////////////////////////////////////////////////////////////////////////////////
+void Document::swapPeakData(PeakData& peaks)
+{
+  QWriteLocker locker(&m_peakDataLock);
+  m_peakData.swap(peaks);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::releasePeakReaders()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Release the readers of the peak build in all sources.
+///\remarks Each worker opens its own files, compressed files even several
+///         per worker, so they are closed as soon as the build is done.
+////////////////////////////////////////////////////////////////////////////////
+void Document::releasePeakReaders()
+{
+  // Collect the distinct sources:
+  QMap<int, QSharedPointer<AudioSnippet> > sources;
+  for (int i = 0; i < m_playList.size(); i++)
+    sources.insert(m_playList[i]->source()->id(), m_playList[i]->source());
+
+  // Release the readers of all workers:
+  for (QMap<int, QSharedPointer<AudioSnippet> >::const_iterator it = sources.constBegin(); it != sources.constEnd(); ++it)
+  {
+    it.value()->releaseReader(AudioSnippet::PeakReader);
+    for (int i = 1; i < s_maxPeakWorkers; i++)
+      it.value()->releaseReader(static_cast<AudioSnippet::Reader>(AudioSnippet::PeakWorkerReader + i - 1));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::scanPeakChunks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   The work of a peak worker.
+///\param   [in] worker: Number of the worker.
+///\remarks Scans chunks until all of them are taken or the update stops.
+////////////////////////////////////////////////////////////////////////////////
+void Document::scanPeakChunks(int worker)
+{
+  // Every worker has its own reader, so they never wait for each other:
+  const AudioSnippet::Reader reader = worker == 0 ? AudioSnippet::PeakReader : static_cast<AudioSnippet::Reader>(AudioSnippet::PeakWorkerReader + worker - 1);
+
+  // Take the next chunk:
+  while (m_updatingPeaks)
+  {
+    const int chunk = m_nextPeakChunk.fetchAndAddRelaxed(1);
+    if (chunk >= m_peakChunks.size())
+      return;
+    scanPeakChunk(m_peakChunks[chunk].first, m_peakChunks[chunk].second, reader);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::scanPeakChunk()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Build the peaks of a chunk of this document.
+///\param   [in] start:  First frame of the chunk.
+///\param   [in] end:    Frame after the chunk.
+///\param   [in] reader: The reader of the calling worker.
+///\remarks The peaks are built in levels that only cover the chunk and copied
+///         into the document's peaks at the end. Only the finest level reads
+///         samples, the others are reduced from it. Incremental updates only
+///         build the finest level.
+////////////////////////////////////////////////////////////////////////////////
+void Document::scanPeakChunk(qint64 start, qint64 end, AudioSnippet::Reader reader)
+{
+  // Create levels that start with the chunk (its first and last peak value
+  // may be partial):
+  const int numMips = m_peakChunkLevels;
+  MipmapLevel* parts = new MipmapLevel[numMips];
+  for (int i = 0; i < numMips; i++)
+  {
+    const int factor = m_peakData.mipmaps()[i].divisionFactor();
+    parts[i].setChannelCount(m_numChannels);
+    parts[i].setDivisionFactor(factor);
+    parts[i].setSampleCount((end - 1) / factor - start / factor + 1);
+    parts[i].createSamples();
+    parts[i].seek(static_cast<int>(start % factor));
+  }
+
+  // Loop through the play list items of the chunk:
+  qint64 position = start;
+  for (int i = findSnippet(start); i >= 0 && i < m_playList.size() && position < end && m_updatingPeaks; i++)
+  {
+    SubSnippet* piece = m_playList[i];
+    const qint64 offset = position - m_snippetStarts[i];
+    const qint64 count = qMin(end - position, piece->sampleCount() - offset);
+    scanSnippet(piece, offset, count, parts[0], reader);
+    position += count;
+  }
+
+  // Build the coarser levels:
+  for (int i = 1; i < numMips && m_updatingPeaks; i++)
+  {
+    const int factor = parts[i].divisionFactor();
+    const int ratio = factor / parts[i - 1].divisionFactor();
+    parts[i].reduce(parts[i - 1], static_cast<int>(start / parts[i - 1].divisionFactor() - (start / factor) * ratio));
+  }
+
+  // Hand the result over:
+  if (m_updatingPeaks)
+    mergePeakChunk(start, end, parts);
+  delete [] parts;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::scanSnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Add the samples of a part of a snippet to a peak level.
+///\param   [in] snippet: The play list item or source.
+///\param   [in] offset:  First frame of the snippet to scan.
+///\param   [in] count:   Number of frames to scan.
+///\param   [in] level:   The level to update.
+///\param   [in] reader:  The reader to use.
+///\remarks Integer files are scanned as integers.
+////////////////////////////////////////////////////////////////////////////////
+void Document::scanSnippet(AudioSnippet* snippet, qint64 offset, qint64 count, MipmapLevel& level, AudioSnippet::Reader reader)
+{
+  switch (snippet->nativeFormat())
+  {
+  case AudioSnippet::Int16Samples:
+    scanPeaks<qint16>(snippet, offset, count, 1.0f / 32768.0f, level, reader);
+    break;
+  case AudioSnippet::Int32Samples:
+    scanPeaks<qint32>(snippet, offset, count, 1.0f / 2147483648.0f, level, reader);
+    break;
+  default:
+    scanPeaks<float>(snippet, offset, count, 1.0f, level, reader);
+    break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::scanPeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Add the samples of a part of a play list item to a peak level.
+///\param   [in] snippet: The play list item.
+///\param   [in] offset:  First frame of the item to scan.
+///\param   [in] count:   Number of frames to scan.
+///\param   [in] scale:   Factor to normalize a sample to -1..1.
+///\param   [in] level:   The level to update (the finest one).
+///\param   [in] reader:  The reader to use.
+///\remarks The samples are read in the given native format of the item.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void Document::scanPeaks(AudioSnippet* snippet, qint64 offset, qint64 count, float scale, MipmapLevel& level, AudioSnippet::Reader reader)
+{
+  // Create interleaved sample buffer:
+  QVector<T> buffer(s_peakBlockFrames * m_numChannels);
+
+  // Read until the part is done:
+  const qint64 end = offset + count;
+  while (offset < end && m_updatingPeaks)
+  {
+    // Read next bunch of samples:
+    const qint64 samplesRead = snippet->readRaw(offset, qMin(qint64(s_peakBlockFrames), end - offset), buffer.data(), reader);
+    if (samplesRead <= 0)
+      return;
+
+    // Add to the mipmap:
+    level.addFrames(static_cast<int>(samplesRead), buffer.constData(), scale);
+    offset += samplesRead;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::mergePeakChunk()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Copy the peaks of a chunk into the document's peaks.
+///\param   [in] start: First frame of the chunk.
+///\param   [in] end:   Frame after the chunk.
+///\param   [in] parts: The levels of the chunk.
+///\remarks Values that lie completely inside of the chunk belong to this
+///         worker only and are copied as they are. Values that cross the
+///         chunk's edges are shared with the neighbours: the first worker
+///         that gets there sets them, the others merge into them (the RMS
+///         weighted by the number of frames that each one has seen). The
+///         chunk is reported by the next progress notification.
+////////////////////////////////////////////////////////////////////////////////
+void Document::mergePeakChunk(qint64 start, qint64 end, const MipmapLevel* parts)
+{
+  for (int i = 0; i < m_peakChunkLevels; i++)
+  {
+    MipmapLevel& level = m_peakData.mipmaps()[i];
+    const qint64 factor = level.divisionFactor();
+    const qint64 first = start / factor;
+    for (qint64 j = 0; j < parts[i].sampleCount(); j++)
+    {
+      // Inside of the chunk?
+      const qint64 index = first + j;
+      const qint64 valueStart = index * factor;
+      const qint64 valueEnd = qMin(valueStart + factor, m_sampleCount);
+      if (valueStart >= start && valueEnd <= end)
+      {
+        for (int k = 0; k < m_numChannels; k++)
+          level.samples()[k][index] = parts[i].samples()[k][j];
+        continue;
+      }
+
+      // Shared with a neighbour:
+      QMutexLocker locker(&m_peakEdgeMutex);
+      const qint64 frames = qMin(valueEnd, end) - qMax(valueStart, start);
+      const qint64 merged = m_peakEdges[i].value(index, 0);
+      m_peakEdges[i].insert(index, merged + frames);
+      for (int k = 0; k < m_numChannels; k++)
+      {
+        PeakSample& target = level.samples()[k][index];
+        const PeakSample& value = parts[i].samples()[k][j];
+        if (merged == 0)
+          target = value;
+        else
+        {
+          if (value.minVal < target.minVal)
+            target.minVal = value.minVal;
+          if (value.maxVal > target.maxVal)
+            target.maxVal = value.maxVal;
+          const double rms1 = peakValue(target.rmsVal);
+          const double rms2 = peakValue(value.rmsVal);
+          target.rmsVal = quantizePeak(static_cast<float>(sqrt((rms1 * rms1 * merged + rms2 * rms2 * frames) / (merged + frames))));
+        }
+      }
+    }
+  }
+
+  // Add the chunk to the range of the next progress notification:
+  QMutexLocker locker(&m_peakEdgeMutex);
+  if (m_peakDirtyEnd <= m_peakDirtyStart)
+  {
+    m_peakDirtyStart = start;
+    m_peakDirtyEnd = end;
+  }
+  else
+  {
+    m_peakDirtyStart = qMin(m_peakDirtyStart, start);
+    m_peakDirtyEnd = qMax(m_peakDirtyEnd, end);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::composePeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Fill the finest peak level from the peaks of the sources.
+///\param   [in]  start:  First frame of the range to fill (on a value).
+///\param   [in]  end:    Frame after the range (on a value or the end).
+///\param   [out] ranges: The ranges that must be scanned, sorted.
+///\remarks Peak values that lie inside of a piece are taken from the peaks of
+///         its source. If the piece doesn't start on a peak value of its
+///         source, each value merges the two source values that it touches
+///         (so it may show up to one value more of the same piece, which is
+///         less than a pixel in any view that uses this level). Values that
+///         contain piece edges would show samples that are not part of the
+///         document anymore, they are returned for an exact scan. The
+///         coarser levels are reduced piece by piece, so all levels show
+///         the composed peaks as soon as they are there.
+////////////////////////////////////////////////////////////////////////////////
+void Document::composePeaks(qint64 start, qint64 end, QVector<QPair<qint64, qint64> >& ranges)
+{
+  // Forget the peaks of sources that are gone:
+  QHash<int, SourcePeaks>::iterator it = m_sourcePeaks.begin();
+  while (it != m_sourcePeaks.end())
+  {
+    if (it.value().source.isNull())
+      it = m_sourcePeaks.erase(it);
+    else
+      ++it;
+  }
+
+  MipmapLevel& target = m_peakData.mipmaps()[0];
+  const qint64 factor = target.divisionFactor();
+  for (int i = qMax(findSnippet(start), 0); start < end && i < m_playList.size() && m_updatingPeaks; i++)
+  {
+    // Values of the piece in the range:
+    SubSnippet* piece = m_playList[i];
+    const qint64 docStart = m_snippetStarts[i];
+    const qint64 docEnd = docStart + piece->sampleCount();
+    if (docStart >= end)
+      break;
+    const qint64 first = qMax(docStart, start) / factor;
+    const qint64 last = (qMin(docEnd, end) + factor - 1) / factor;
+
+    // Get the peaks of the source:
+    const MipmapLevel* source = sourcePeaks(piece);
+    if (source == 0)
+    {
+      addPeakRange(ranges, first * factor, qMin(last * factor, m_sampleCount));
+      continue;
+    }
+
+    // Take every value from the source values that it covers:
+    const qint64 srcStart = piece->start();
+    const qint64 srcEnd = srcStart + piece->sampleCount();
+    const qint64 srcCount = piece->source()->sampleCount();
+    for (qint64 j = first; j < last; j++)
+    {
+      // Source range of this value:
+      const qint64 valueStart = j * factor;
+      const qint64 valueEnd = qMin(valueStart + factor, m_sampleCount);
+      if (valueStart < docStart || valueEnd > docEnd)
+      {
+        addPeakRange(ranges, valueStart, valueEnd);
+        continue;
+      }
+      const qint64 a = valueStart - docStart + srcStart;
+      const qint64 b = valueEnd - docStart + srcStart;
+      const qint64 k1 = a / factor;
+      const qint64 k2 = (b - 1) / factor;
+
+      // Source values must not reach beyond the piece:
+      if (k1 * factor < srcStart || qMin((k2 + 1) * factor, srcCount) > srcEnd)
+      {
+        addPeakRange(ranges, valueStart, valueEnd);
+        continue;
+      }
+
+      // Copy or merge:
+      for (int c = 0; c < m_numChannels; c++)
+      {
+        PeakSample& value = target.samples()[c][j];
+        value = source->samples()[c][k1];
+        if (k2 != k1)
+        {
+          const PeakSample& next = source->samples()[c][k2];
+          if (next.minVal < value.minVal)
+            value.minVal = next.minVal;
+          if (next.maxVal > value.maxVal)
+            value.maxVal = next.maxVal;
+          const double rms1 = peakValue(value.rmsVal);
+          const double rms2 = peakValue(next.rmsVal);
+          const double w1 = (k1 + 1) * factor - a;
+          const double w2 = b - k2 * factor;
+          value.rmsVal = quantizePeak(static_cast<float>(sqrt((rms1 * rms1 * w1 + rms2 * rms2 * w2) / (w1 + w2))));
+        }
+      }
+    }
+
+    // Build the coarser values of the piece:
+    reducePeakRange(first * factor, qMin(last * factor, m_sampleCount));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::reducePeakRange()
+////////////////////////////////////////////////////////////////////////////////
+///rief   Build the coarser peak levels of a range from the finest one.
+///\param   [in] start: First frame of the range.
+///\param   [in] end:   Frame after the range.
+////////////////////////////////////////////////////////////////////////////////
+void Document::reducePeakRange(qint64 start, qint64 end)
+{
+  for (int i = 1; i < m_peakData.mipmapCount(); i++)
+    m_peakData.mipmaps()[i].reduceRange(m_peakData.mipmaps()[i - 1], start, end);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::addPeakRange()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Add a range to the ranges that must be scanned.
+///\param   [in,out] ranges: The ranges so far, sorted.
+///\param   [in]     start:  First frame of the range.
+///\param   [in]     end:    Frame after the range.
+///\remarks Ranges must be added in order, neighbours are merged.
+////////////////////////////////////////////////////////////////////////////////
+void Document::addPeakRange(QVector<QPair<qint64, qint64> >& ranges, qint64 start, qint64 end)
+{
+  if (!ranges.isEmpty() && ranges.last().second >= start)
+    ranges.last().second = qMax(ranges.last().second, end);
+  else
+    ranges.append(qMakePair(start, end));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::sourcePeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Get the finest peak level of the source of a piece.
+///\param   [in] piece: The play list item.
+///\return  The peaks of the whole source or 0 if the piece should be scanned
+///         directly.
+///\remarks Sources are scanned the first time that they are needed, unless
+///         the piece only uses a small part of it. The peaks stay as long as
+///         the source lives (undo keeps it alive). The pieces composed so far
+///         are shown before a scan, so the views don't wait for all of it.
+////////////////////////////////////////////////////////////////////////////////
+const MipmapLevel* Document::sourcePeaks(SubSnippet* piece)
+{
+  // Known source?
+  const QSharedPointer<AudioSnippet>& source = piece->source();
+  const int factor = m_peakData.mipmaps()[0].divisionFactor();
+  QHash<int, SourcePeaks>::const_iterator it = m_sourcePeaks.constFind(source->id());
+  if (it != m_sourcePeaks.constEnd() && it.value().peaks->divisionFactor() == factor)
+    return it.value().peaks.data();
+
+  // Not worth it?
+  if (piece->sampleCount() * 4 < source->sampleCount())
+    return 0;
+
+  // Show what is done, the scan takes a while:
+  emitPeaksChanged();
+
+  // Scan it:
+  QSharedPointer<MipmapLevel> peaks(new MipmapLevel());
+  peaks->setChannelCount(source->channelCount());
+  peaks->setDivisionFactor(factor);
+  peaks->setSampleCount((source->sampleCount() + factor - 1) / factor);
+  if (!peaks->createSamples())
+    return 0;
+  scanSnippet(source.data(), 0, source->sampleCount(), *peaks, AudioSnippet::PeakReader);
+  if (!m_updatingPeaks)
+    return 0;
+
+  // Keep it:
+  SourcePeaks entry;
+  entry.source = source.toWeakRef();
+  entry.peaks  = peaks;
+  m_sourcePeaks.insert(source->id(), entry);
+  return peaks.data();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::keepSourcePeaks()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Remember the peaks of an unedited file for later edits.
+///\remarks If the document is a single complete file, its finest peak level
+///         is the peak level of the file, so the file never needs to be
+///         scanned again when pieces of it are moved around.
+////////////////////////////////////////////////////////////////////////////////
+void Document::keepSourcePeaks()
+{
+  // Complete peaks of a complete file?
+  if (!m_peaksComplete || m_peakData.mipmapCount() == 0 || m_playList.size() != 1)
+    return;
+  SubSnippet* piece = m_playList[0];
+  const QSharedPointer<AudioSnippet>& source = piece->source();
+  if (piece->start() != 0 || piece->sampleCount() != source->sampleCount() || m_sourcePeaks.contains(source->id()))
+    return;
+
+  // Copy the finest level:
+  const MipmapLevel& finest = m_peakData.mipmaps()[0];
+  QSharedPointer<MipmapLevel> peaks(new MipmapLevel());
+  peaks->setChannelCount(finest.channelCount());
+  peaks->setDivisionFactor(finest.divisionFactor());
+  peaks->setSampleCount(finest.sampleCount());
+  if (!peaks->createSamples())
+    return;
+  for (int i = 0; i < finest.channelCount(); i++)
+    memcpy(peaks->samples()[i], finest.samples()[i], finest.sampleCount() * sizeof(PeakSample));
+
+  // Keep it:
+  SourcePeaks entry;
+  entry.source = source.toWeakRef();
+  entry.peaks  = peaks;
+  m_sourcePeaks.insert(source->id(), entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::splitPlayList()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Make sure that a play list item starts at a position.
+///\param   [in] position: The frame where an item should start.
+///\return  The index of the item that starts at the position.
+///\remarks The piece that contains the position is split into two. If the
+///         position is the end of the document the item count is returned.
+///         The caller must hold the write lock of the play list.
+////////////////////////////////////////////////////////////////////////////////
+int Document::splitPlayList(qint64 position)
+{
+  // Find the piece that contains the position:
+  const int index = findSnippet(position);
+  if (index < 0)
+    return m_playList.size();
+
+  // Starts right here?
+  const qint64 split = position - m_snippetStarts[index];
+  if (split == 0)
+    return index;
+
+  // Replace it by its two halves:
+  SubSnippet* piece = m_playList[index];
+  m_playList[index] = new SubSnippet(piece->source(), piece->start(), split);
+  m_playList.insert(index + 1, new SubSnippet(piece->source(), piece->start() + split, piece->sampleCount() - split));
+  delete piece;
+  updateSnippetStarts();
+  return index + 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::findSnippet()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Find the play list item that contains a position.
+///\param   [in] position: The frame to look for.
+///\return  The index of the item or -1 if the position is out of range.
+///\remarks Binary search over the item start positions, O(log n).
+////////////////////////////////////////////////////////////////////////////////
+int Document::findSnippet(qint64 position) const
+{
+  // Out of range?
+  if (position < 0 || m_snippetStarts.isEmpty() || position >= m_snippetStarts.last())
+    return -1;
+
+  // Find the last item that starts at or before the position (the last
+  // entry is the end of the document, so it never matches):
+  QVector<qint64>::const_iterator it = std::upper_bound(m_snippetStarts.constBegin(), m_snippetStarts.constEnd(), position);
+  return static_cast<int>(it - m_snippetStarts.constBegin()) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::updateSnippetStarts()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Rebuild the start positions of the play list items.
+///\remarks Must be called after every play list change. The caller must hold
+///         the write lock of the play list.
+////////////////////////////////////////////////////////////////////////////////
+void Document::updateSnippetStarts()
+{
+  // Sum up the lengths, the extra entry at the end is the total length:
+  m_snippetStarts.resize(m_playList.size() + 1);
+  qint64 pos = 0;
+  for (int i = 0; i < m_playList.size(); i++)
+  {
+    m_snippetStarts[i] = pos;
+    pos += m_playList[i]->sampleCount();
+  }
+  m_snippetStarts[m_playList.size()] = pos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::scratchBuffer()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the temp buffer of a reader.
+///\param   [in] buffer: The buffer that is filled (selects the type).
+///\param   [in] reader: The consumer that reads.
+///\return  The temp buffer of the reader.
+////////////////////////////////////////////////////////////////////////////////
+SampleBuffer& Document::scratchBuffer(const SampleBuffer& /* buffer */, AudioSnippet::Reader reader)
+{
+  // Return the buffer:
+  return m_scratch[reader];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::scratchBuffer()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the temp buffer of a reader, float version.
+///\param   [in] buffer: The buffer that is filled (selects the type).
+///\param   [in] reader: The consumer that reads.
+///\return  The float temp buffer of the reader.
+////////////////////////////////////////////////////////////////////////////////
+FloatSampleBuffer& Document::scratchBuffer(const FloatSampleBuffer& /* buffer */, AudioSnippet::Reader reader)
+{
+  // Return the buffer:
+  return m_floatScratch[reader];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::readPieces()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read a range of frames across play list items.
+///\param   [in]  offset: Starting frame to read.
+///\param   [out] buffer: The buffer to fill.
+///\param   [in]  count:  The number of frames to read.
+///\param   [in]  reader: The consumer that reads.
+///\return  The actual number of frames read.
+///\remarks The caller must hold the read lock of the play list. Stops early
+///         at the end of the document or if a piece delivers less frames.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+qint64 Document::readPieces(qint64 offset, SampleBufferT<T>& buffer, qint64 count, AudioSnippet::Reader reader)
+{
+  // Find the first piece:
+  int index = findSnippet(offset);
+  if (index < 0 || count <= 0)
+    return 0;
+
+  // Read piece by piece:
+  qint64 done = 0;
+  while (done < count && index < m_playList.size())
+  {
+    SubSnippet* piece = m_playList[index];
+    const qint64 inPiece   = offset + done - m_snippetStarts[index];
+    const qint64 numFrames = qMin(count - done, piece->sampleCount() - inPiece);
+    const qint64 numRead   = readPiece(piece, inPiece, numFrames, buffer, done, reader);
+    if (numRead > 0)
+      done += numRead;
+    if (numRead < numFrames)
+      break;
+    index++;
+  }
+
+  // Return number of frames read:
+  return done;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::readPiece()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read frames of a single play list item.
+///\param   [in]  piece:  The item to read from.
+///\param   [in]  offset: Starting frame in the item.
+///\param   [in]  count:  The number of frames to read.
+///\param   [out] buffer: The buffer to fill.
+///\param   [in]  target: First frame of the buffer to write to.
+///\param   [in]  reader: The consumer that reads.
+///\return  The actual number of frames read.
+///\remarks Snippets always write to the start of a buffer, so everything but
+///         the first piece of a read goes through a temp buffer. Each
+///         reader keeps its temp buffer, so reads don't allocate once it
+///         is large enough (shared reads use a temp buffer of their own,
+///         they may come from several threads at once).
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+qint64 Document::readPiece(SubSnippet* piece, qint64 offset, qint64 count, SampleBufferT<T>& buffer, qint64 target, AudioSnippet::Reader reader)
+{
+  // First piece goes straight into the target:
+  if (target == 0)
+    return piece->readSamples(offset, count, buffer, reader);
+
+  // Read the rest into the temp buffer of the reader:
+  const int numChannels = qMin(buffer.channelCount(), piece->channelCount());
+  SampleBufferT<T> shared;
+  SampleBufferT<T>& temp = reader == AudioSnippet::SharedReader ? shared : scratchBuffer(buffer, reader);
+  temp.createBuffers(piece->channelCount(), static_cast<int>(count), false);
+  if (temp.channelCount() != piece->channelCount())
+    return 0;
+  const qint64 numRead = piece->readSamples(offset, count, temp, reader);
+  for (int i = 0; numRead > 0 && i < numChannels; i++)
+    memcpy(buffer.sampleBuffer(i) + target, temp.sampleBuffer(i), numRead * sizeof(T));
+  return numRead;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::readPiece()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Read frames of a single play list item, float version.
+///\param   [in]  piece:  The item to read from.
+///\param   [in]  offset: Starting frame in the item.
+///\param   [in]  count:  The number of frames to read.
+///\param   [out] buffer: The buffer to fill.
+///\param   [in]  target: First frame of the buffer to write to.
+///\param   [in]  reader: The consumer that reads.
+///\return  The actual number of frames read.
+///\remarks Display and shared reads go through the shared cache. It caches by
+///         source, so the blocks survive edits.
+////////////////////////////////////////////////////////////////////////////////
+qint64 Document::readPiece(SubSnippet* piece, qint64 offset, qint64 count, FloatSampleBuffer& buffer, qint64 target, AudioSnippet::Reader reader)
+{
+  // Read through the cache:
+  if (m_manager != 0 && (reader == AudioSnippet::DisplayReader || reader == AudioSnippet::SharedReader))
+    return m_manager->blockCache().readSamples(piece->source().data(), piece->start() + offset, count, buffer, reader, target);
+
+  // Read directly:
+  return readPiece<float>(piece, offset, count, buffer, target, reader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::clearPlayList()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Delete all pieces of the play list.
+///\remarks The caller must hold the write lock of the play list. Sources
+///         that no other piece refers to are closed.
+////////////////////////////////////////////////////////////////////////////////
+void Document::clearPlayList()
+{
+  // Delete pieces and their cached samples:
+  for (int i = 0; i < m_playList.size(); i++)
+  {
+    if (m_manager != 0)
+      m_manager->blockCache().purge(m_playList[i]->source().data());
+    delete m_playList[i];
+  }
+  m_playList.clear();
+  updateSnippetStarts();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::installSource()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Make a freshly opened file the contents of this document.
+///\param   [in] source:     The source of the file, the document owns it.
+///\param   [in] fileName:   Name of the file.
+///\param   [in] sampleRate: Samples per second of the file.
+///\param   [in] format:     Id of the file format.
+///\remarks Starts the peak update, read ahead and rack.
+////////////////////////////////////////////////////////////////////////////////
+void Document::installSource(AudioSnippet* source, const QString& fileName, double sampleRate, int format)
+{
+  // Create playlist entry that covers the whole file:
+  m_playListLock.lockForWrite();
+  m_playList.append(new SubSnippet(QSharedPointer<AudioSnippet>(source), 0, source->sampleCount()));
+  updateSnippetStarts();
+  m_playListLock.unlock();
+
+  // Save file name:
+  m_fileName = fileName;
+
+  // Save properties:
+  m_format      = format;
+  m_numChannels = source->channelCount();
+  m_sampleRate  = sampleRate;
+  m_sampleCount = source->sampleCount();
+
+  // Update peak data:
+  startPeakThread();
+
+  // Start reading ahead for playback:
+  m_playbackStream.startStreaming(m_numChannels, m_sampleRate);
+
+  // Start rack:
+  m_rack.setBlockSize(AudioSystemQt::blockSize());
+  m_rack.setSampleRate(AudioSystemQt::sampleRate());
+  m_rack.resume();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::beginEdit()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Prepare the document for a play list change.
+///\remarks Stops the peak thread because it walks the play list unlocked
+///         and keeps the peaks of the current file for the update.
+////////////////////////////////////////////////////////////////////////////////
+void Document::beginEdit()
+{
+  // Stop peak thread:
+  stopPeakThread();
+
+  // The peaks of an unedited file can be reused for its pieces:
+  keepSourcePeaks();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::endEdit()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Update everything that depends on the play list after a change.
+///\remarks Drops the samples that were read ahead for playback and rebuilds
+///         the peaks.
+////////////////////////////////////////////////////////////////////////////////
+void Document::endEdit()
+{
+  // Count the change:
+  m_editCount++;
+
+  // Move large new sources out of RAM:
+  pageOutSources();
+
+  // Refill the playback buffer:
+  m_playbackStream.invalidate();
+
+  // Update peak data:
+  startPeakThread();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::startPeakThread()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Rebuild the peaks in the background.
+///\remarks A running update is stopped first. The update is flagged before
+///         the thread runs, so a stop request can never get lost.
+////////////////////////////////////////////////////////////////////////////////
+void Document::startPeakThread()
+{
+  // Finish the last update:
+  stopPeakThread();
+
+  // Start a new one:
+  m_updatingPeaks = true;
+  m_peakThread.start();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::stopPeakThread()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Stop the peak update and wait for the thread.
+///\remarks Always waits, the thread may still be on its way in or out of
+///         updatePeakData().
+////////////////////////////////////////////////////////////////////////////////
+void Document::stopPeakThread()
+{
+  // Flag stop and wait:
+  m_updatingPeaks = false;
+  m_peakThread.wait();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Document::pageOutSources()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Keep the in-memory sources of the play list below the threshold.
+///\remarks The largest sources are paged out to the swap file first.
+////////////////////////////////////////////////////////////////////////////////
+void Document::pageOutSources()
+{
+  // Collect the distinct in-memory sources:
+  QMap<int, QSharedPointer<AudioSnippet> > sources;
+  m_playListLock.lockForRead();
+  for (int i = 0; i < m_playList.size(); i++)
+  {
+    if (m_playList[i]->source()->memorySize() > 0)
+      sources.insert(m_playList[i]->source()->id(), m_playList[i]->source());
+  }
+  m_playListLock.unlock();
+
+  // Below the threshold?
+  QList<QSharedPointer<AudioSnippet> > list = sources.values();
+  qint64 total = 0;
+  for (int i = 0; i < list.size(); i++)
+    total += list[i]->memorySize();
+  if (total <= m_ramThreshold)
+    return;
+
+  // Page out the largest ones first:
+  std::sort(list.begin(), list.end(), largerSource);
+  for (int i = 0; i < list.size() && total > m_ramThreshold; i++)
+  {
+    const qint64 size = list[i]->memorySize();
+    if (list[i]->pageOut(m_swapStore))
+      total -= size;
+  }
+}
+
 ///////////////////////////////// End of File //////////////////////////////////
@@ -30,7 +30,13 @@
 #include "bruo.h"
 #include "audio/peakdata.h"
 #include "audio/peakthread.h"
+#include "audio/playbackstream.h"
+#include "audio/savethread.h"
+#include "audio/bouncethread.h"
+#include "audio/openthread.h"
+#include "audio/swapstore.h"
 #include "audio/audiosnippet.h"
+#include "audio/subsnippet.h"
 #include "rack/rack.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -54,6 +60,7 @@ class Document :
   //////////////////////////////////////////////////////////////////////////////
   // Friends:
   friend class PeakThread; ///> The peak thread is allowed to see everything.
+  friend class PeakWorker; ///> So are its workers.
 
 public:
   //////////////////////////////////////////////////////////////////////////////
@@ -311,6 +318,17 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   const PeakData& peakData() const;
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::peakDataLock()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the lock of the peak data.
+  ///\return  The lock.
+  ///\remarks The peak thread swaps in new mip maps when the layout changes,
+  ///         so the views hold this lock for reading while they use the
+  ///         levels of peakData().
+  //////////////////////////////////////////////////////////////////////////////
+  QReadWriteLock& peakDataLock();
+
   //////////////////////////////////////////////////////////////////////////////
   // Document::lastError()
   //////////////////////////////////////////////////////////////////////////////
@@ -540,6 +558,30 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   const Rack& rack() const;
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::playbackStream()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the playback stream of this document.
+  ///\return  The stream that reads ahead for the audio thread.
+  //////////////////////////////////////////////////////////////////////////////
+  PlaybackStream& playbackStream();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::playbackStream()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the playback stream of this document, const version.
+  ///\return  The stream that reads ahead for the audio thread.
+  //////////////////////////////////////////////////////////////////////////////
+  const PlaybackStream& playbackStream() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::swapStore()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the swap file of this document.
+  ///\return  The store for samples that are paged out of RAM.
+  //////////////////////////////////////////////////////////////////////////////
+  const QSharedPointer<SwapStore>& swapStore() const;
+
   //////////////////////////////////////////////////////////////////////////////
   // Document::composeTitle()
   //////////////////////////////////////////////////////////////////////////////
@@ -559,6 +601,120 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   bool loadFile(const QString& fileName);
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::open()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Start loading a file in the background.
+  ///\param   [in] fileName: Name of the file to load.
+  ///\return  true if the open was started or false otherwise.
+  ///\remarks The document stays empty (but has its file name) until the
+  ///         header was parsed, so a view can be shown right away.
+  ///         openFinished() is emitted when done, see lastError() on failure.
+  //////////////////////////////////////////////////////////////////////////////
+  bool open(const QString& fileName);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::opening()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check if a background open is running.
+  ///\return  true until the file is loaded or failed to load.
+  //////////////////////////////////////////////////////////////////////////////
+  bool opening() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::create()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Set this document up as a new empty file.
+  ///\param   [in] numChannels: Number of channels of the new document.
+  ///\param   [in] sampleRate:  Samples per second of a channel.
+  ///\remarks Use insertSnippets() to fill the document afterwards.
+  //////////////////////////////////////////////////////////////////////////////
+  void create(int numChannels, double sampleRate);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::openSource()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Open an audio file as a play list source.
+  ///\param   [in]  fileName:   Name of the file to open.
+  ///\param   [out] sampleRate: Samples per second of the file.
+  ///\param   [out] format:     Id of the file format.
+  ///\return  The new source or 0 on error (see sf_strerror(0) then).
+  ///\remarks Uncompressed files are mapped, everything else is decoded by
+  ///         libsndfile. The caller owns the source.
+  //////////////////////////////////////////////////////////////////////////////
+  static AudioSnippet* openSource(const QString& fileName, double& sampleRate, int& format);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::openSpillFile()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Open a temporary audio file as a play list source.
+  ///\param   [in]  fileName:   Name of the file to open.
+  ///\param   [out] sampleRate: Samples per second of the file.
+  ///\return  The new source or a null pointer on error.
+  ///\remarks The file is removed with the last reference to the source, or
+  ///         right away if it can't be opened.
+  //////////////////////////////////////////////////////////////////////////////
+  static QSharedPointer<AudioSnippet> openSpillFile(const QString& fileName, double& sampleRate);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::save()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Start saving this document in the background.
+  ///\param   [in] fileName: Name of the target file.
+  ///\return  true if the save was started or false otherwise.
+  ///\remarks The current play list is saved, edits made meanwhile are not part
+  ///         of the file. The file is written with the format of the document.
+  ///         saveFinished() is emitted when done, see lastError() on failure.
+  //////////////////////////////////////////////////////////////////////////////
+  bool save(const QString& fileName);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::saving()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check if a background save is running.
+  ///\return  true while saving.
+  //////////////////////////////////////////////////////////////////////////////
+  bool saving() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::saveThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the background save of this document.
+  ///\return  The save thread (target file, result of the last save).
+  //////////////////////////////////////////////////////////////////////////////
+  const SaveThread& saveThread() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::bounce()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Start rendering a range through the rack into a file.
+  ///\param   [in] fileName: Name of the target file.
+  ///\param   [in] format:   Id of the file format.
+  ///\param   [in] start:    First frame of the range.
+  ///\param   [in] length:   Number of frames of the range.
+  ///\return  true if the render was started or false otherwise.
+  ///\remarks The render runs in the background as fast as possible, the
+  ///         realtime output of the rack is silent meanwhile. bounceFinished()
+  ///         is emitted when done, see lastError() on failure.
+  //////////////////////////////////////////////////////////////////////////////
+  bool bounce(const QString& fileName, int format, qint64 start, qint64 length);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::bouncing()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Check if an offline render is running.
+  ///\return  true while rendering.
+  //////////////////////////////////////////////////////////////////////////////
+  bool bouncing() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::bounceThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the offline render of this document.
+  ///\return  The render thread (target file, speed of the last render).
+  //////////////////////////////////////////////////////////////////////////////
+  const BounceThread& bounceThread() const;
+
   //////////////////////////////////////////////////////////////////////////////
   // Document::readSamples()
   //////////////////////////////////////////////////////////////////////////////
@@ -566,11 +722,89 @@ public:
   ///\param   [in] offset:       Starting sample to read.
   ///\param   [in] buffer:       The buffer to fill.
   ///\param   [in] sampleFrames: The number of frames to read.
+  ///\param   [in] reader:       The consumer that reads (see AudioSnippet).
   ///\return  The actual number of samples read.
   ///\remarks Samples are only counted for a single channel here so for the
   ///         count it doesn't matter how many channels there are.
   //////////////////////////////////////////////////////////////////////////////
-  qint64 readSamples(qint64 offset, SampleBuffer& buffer, unsigned int sampleFrames);
+  qint64 readSamples(qint64 offset, SampleBuffer& buffer, unsigned int sampleFrames, AudioSnippet::Reader reader = AudioSnippet::SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::readSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a group of samples from the current file, float version.
+  ///\param   [in] offset:       Starting sample to read.
+  ///\param   [in] buffer:       The buffer to fill.
+  ///\param   [in] sampleFrames: The number of frames to read.
+  ///\param   [in] reader:       The consumer that reads (see AudioSnippet).
+  ///\return  The actual number of samples read.
+  ///\remarks Use this version if single precision is enough (eg. display).
+  ///         Display and shared reads are served from the block cache of the
+  ///         document manager.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 readSamples(qint64 offset, FloatSampleBuffer& buffer, unsigned int sampleFrames, AudioSnippet::Reader reader = AudioSnippet::SharedReader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::snippetCount()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the number of pieces in the play list.
+  ///\return  The number of play list items.
+  ///\remarks Every edit adds at most two pieces.
+  //////////////////////////////////////////////////////////////////////////////
+  int snippetCount() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::copySnippets()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Get the pieces that make up a range of this document.
+  ///\param   [in] start:  The first frame of the range.
+  ///\param   [in] length: The number of frames of the range.
+  ///\return  New pieces that refer to the same sources, owned by the caller.
+  ///\remarks No samples are copied, so this is cheap for any range.
+  //////////////////////////////////////////////////////////////////////////////
+  QList<SubSnippet*> copySnippets(qint64 start, qint64 length);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::insertSnippets()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Insert pieces into the play list of this document.
+  ///\param   [in] position: The frame where to insert.
+  ///\param   [in] snippets: The pieces to insert.
+  ///\return  true if successful or false otherwise.
+  ///\remarks The document takes over the pieces on success. The insertion
+  ///         fails if the channel count of a piece doesn't match. The dirty
+  ///         state and the selection are not touched.
+  //////////////////////////////////////////////////////////////////////////////
+  bool insertSnippets(qint64 position, const QList<SubSnippet*>& snippets);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::removeSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Remove a range from the play list of this document.
+  ///\param   [in] start:  The first frame to remove.
+  ///\param   [in] length: The number of frames to remove.
+  ///\return  The removed pieces, owned by the caller.
+  ///\remarks Only the pieces at the borders are split, no samples are copied
+  ///         or moved. The dirty state and the selection are not touched.
+  //////////////////////////////////////////////////////////////////////////////
+  QList<SubSnippet*> removeSamples(qint64 start, qint64 length);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::replaceSamples()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Replace a range of the play list of this document with pieces.
+  ///\param   [in]  start:    The first frame to replace.
+  ///\param   [in]  length:   The number of frames to replace.
+  ///\param   [in]  snippets: The pieces to insert at start.
+  ///\param   [out] removed:  The removed pieces, owned by the caller.
+  ///\return  true if successful or false otherwise.
+  ///\remarks The document takes over the pieces on success. Nothing changes
+  ///         if the channel count of a piece doesn't match. Both parts are
+  ///         done in a single edit, so the peaks and the playback buffer are
+  ///         only rebuilt once. The dirty state and the selection are not
+  ///         touched.
+  //////////////////////////////////////////////////////////////////////////////
+  bool replaceSamples(qint64 start, qint64 length, const QList<SubSnippet*>& snippets, QList<SubSnippet*>& removed);
 
   //////////////////////////////////////////////////////////////////////////////
   // Document::close()
@@ -615,6 +849,15 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   void emitPeaksChanged();
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::emitPeakRangeChanged()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Helper function to fire the peakRangeChanged() event.
+  ///\remarks Reports the frames whose peaks were finished since the last call,
+  ///         nothing is fired if there are none.
+  //////////////////////////////////////////////////////////////////////////////
+  void emitPeakRangeChanged();
+
   //////////////////////////////////////////////////////////////////////////////
   // Document::emitCursorPosChanged()
   //////////////////////////////////////////////////////////////////////////////
@@ -643,6 +886,24 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   void emitMarkerChanged();
 
+public slots:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::cancelSave()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Abort the running background save.
+  ///\remarks The target file stays untouched.
+  //////////////////////////////////////////////////////////////////////////////
+  void cancelSave();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::cancelBounce()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Abort the running offline render.
+  ///\remarks The target file stays untouched.
+  //////////////////////////////////////////////////////////////////////////////
+  void cancelBounce();
+
 signals:
 
   //////////////////////////////////////////////////////////////////////////////
@@ -695,6 +956,18 @@ signals:
   //////////////////////////////////////////////////////////////////////////////
   void peaksChanged();
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::peakRangeChanged()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   This event is fired while the peaks are built.
+  ///\param   [in] start:  First frame with new peaks.
+  ///\param   [in] length: Number of frames with new peaks.
+  ///\remarks Fired at most 30 times per second from the peak thread, so views
+  ///         only need to repaint the columns of the range. peaksChanged() is
+  ///         fired before and after the build.
+  //////////////////////////////////////////////////////////////////////////////
+  void peakRangeChanged(qint64 start, qint64 length);
+
   //////////////////////////////////////////////////////////////////////////////
   // Document::cursorPosChanged()
   //////////////////////////////////////////////////////////////////////////////
@@ -735,15 +1008,468 @@ signals:
   //////////////////////////////////////////////////////////////////////////////
   void markerChanged();
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::saveProgress()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   This event is fired while the document is saved.
+  ///\param   [in] percent: The progress (0..100).
+  //////////////////////////////////////////////////////////////////////////////
+  void saveProgress(int percent);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::saveFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   This event is fired when a background save is done.
+  ///\param   [in] success: Was the file written?
+  ///\remarks Unlike the other events this one is fired by the document itself
+  ///         as nobody else knows when the save is done.
+  //////////////////////////////////////////////////////////////////////////////
+  void saveFinished(bool success);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::bounceProgress()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   This event is fired while the rack is rendered offline.
+  ///\param   [in] percent: The progress (0..100).
+  //////////////////////////////////////////////////////////////////////////////
+  void bounceProgress(int percent);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::bounceFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   This event is fired when an offline render is done.
+  ///\param   [in] success: true if the file was written.
+  //////////////////////////////////////////////////////////////////////////////
+  void bounceFinished(bool success);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::openFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   This event is fired when a background open is done.
+  ///\param   [in] success: true if the file was loaded.
+  //////////////////////////////////////////////////////////////////////////////
+  void openFinished(bool success);
+
+private slots:
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::saveThreadFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Handler for the end of a background save.
+  ///\remarks If the document wasn't changed meanwhile it reads from the new
+  ///         file from now on and is clean again.
+  //////////////////////////////////////////////////////////////////////////////
+  void saveThreadFinished();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::bounceThreadFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Handler for the end of an offline render.
+  //////////////////////////////////////////////////////////////////////////////
+  void bounceThreadFinished();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::openThreadFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Handler for the end of a background open.
+  ///\remarks Fills the document with the new source, unless it was closed
+  ///         meanwhile. The thread deletes itself afterwards.
+  //////////////////////////////////////////////////////////////////////////////
+  void openThreadFinished();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::trimUndoPayload()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Keep the memory of the undo stack inside of the budget.
+  ///\remarks Called whenever the stack changes. The newest commands keep
+  ///         their samples in memory, older ones are moved to disk until the
+  ///         total fits the budget again.
+  //////////////////////////////////////////////////////////////////////////////
+  void trimUndoPayload();
+
 private:
 
+  //////////////////////////////////////////////////////////////////////////////
+  // struct Document::SourcePeaks
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief The finest peak level of a source (see sourcePeaks()).
+  //////////////////////////////////////////////////////////////////////////////
+  struct SourcePeaks
+  {
+    QWeakPointer<AudioSnippet>  source; ///> The source, expires with it.
+    QSharedPointer<MipmapLevel> peaks;  ///> Its peaks on the document's grid.
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  // struct Document::PeakPiece
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief A play list item as seen by a peak update (see shiftPeaks()).
+  //////////////////////////////////////////////////////////////////////////////
+  struct PeakPiece
+  {
+    int    source; ///> Id of the source.
+    qint64 start;  ///> First frame of the source.
+    qint64 count;  ///> Number of frames.
+  };
+
   //////////////////////////////////////////////////////////////////////////////
   // Document::updatePeakData()
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Update the peak data of this document.
+  ///\remarks Unchanged files take their peaks from the peak cache, the peaks
+  ///         of other files are put there after the scan. Edited documents
+  ///         keep the peaks of the last update where the play list didn't
+  ///         change (see shiftPeaks()), the rest is put together from the
+  ///         peaks of their sources (see composePeaks()), only the edges of
+  ///         the pieces are scanned and patched into the coarser levels
+  ///         afterwards.
   //////////////////////////////////////////////////////////////////////////////
   void updatePeakData();
 
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::peakPieces()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Describe the play list for the comparison of peak updates.
+  ///\return  Source id and range of every play list item.
+  //////////////////////////////////////////////////////////////////////////////
+  QVector<PeakPiece> peakPieces() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::shiftPeaks()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Keep the peaks of the last update where the play list is the same.
+  ///\param   [in]  pieces: The current play list (see peakPieces()).
+  ///\param   [out] start:  First frame of the range that must be composed.
+  ///\param   [out] end:    Frame after that range.
+  ///\param   [out] tails:  Per level, the frame from where it must be reduced
+  ///                       again up to the end of the document.
+  ///\return  true if the peaks were kept, false if they must be built anew.
+  ///\remarks Frames before the first and after the last changed piece keep
+  ///         their peaks. If the length is the same, the levels stay as they
+  ///         are, so the views keep showing them. Otherwise new levels are
+  ///         made with the head copied and the tail shifted by the length
+  ///         difference. The tail values of a level only move as a whole if
+  ///         the difference is a multiple of its division factor, the others
+  ///         are composed (finest level) or reduced (see tails) again.
+  //////////////////////////////////////////////////////////////////////////////
+  bool shiftPeaks(const QVector<PeakPiece>& pieces, qint64& start, qint64& end, QVector<qint64>& tails);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::scanPeakChunks()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   The work of a peak worker.
+  ///\param   [in] worker: Number of the worker.
+  ///\remarks Scans chunks until all of them are taken or the update stops.
+  //////////////////////////////////////////////////////////////////////////////
+  void scanPeakChunks(int worker);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::swapPeakData()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Replace the peak data with peaks built aside.
+  ///\param   [in,out] peaks: The new peaks, gets the old ones.
+  ///\remarks The views can't use the old levels anymore once the lock is
+  ///         released, so the caller may free them afterwards.
+  //////////////////////////////////////////////////////////////////////////////
+  void swapPeakData(PeakData& peaks);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::releasePeakReaders()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Release the readers of the peak build in all sources.
+  ///\remarks Each worker opens its own files, compressed files even several
+  ///         per worker, so they are closed as soon as the build is done.
+  //////////////////////////////////////////////////////////////////////////////
+  void releasePeakReaders();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::scanPeakChunk()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Build the peaks of a chunk of this document.
+  ///\param   [in] start:  First frame of the chunk.
+  ///\param   [in] end:    Frame after the chunk.
+  ///\param   [in] reader: The reader of the calling worker.
+  ///\remarks The peaks are built in levels that only cover the chunk and copied
+  ///         into the document's peaks at the end. Only the finest level reads
+  ///         samples, the others are reduced from it. Incremental updates only
+  ///         build the finest level.
+  //////////////////////////////////////////////////////////////////////////////
+  void scanPeakChunk(qint64 start, qint64 end, AudioSnippet::Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::scanSnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Add the samples of a part of a snippet to a peak level.
+  ///\param   [in] snippet: The play list item or source.
+  ///\param   [in] offset:  First frame of the snippet to scan.
+  ///\param   [in] count:   Number of frames to scan.
+  ///\param   [in] level:   The level to update.
+  ///\param   [in] reader:  The reader to use.
+  ///\remarks Integer files are scanned as integers.
+  //////////////////////////////////////////////////////////////////////////////
+  void scanSnippet(AudioSnippet* snippet, qint64 offset, qint64 count, MipmapLevel& level, AudioSnippet::Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::scanPeaks()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Add the samples of a part of a play list item to a peak level.
+  ///\param   [in] snippet: The play list item.
+  ///\param   [in] offset:  First frame of the item to scan.
+  ///\param   [in] count:   Number of frames to scan.
+  ///\param   [in] scale:   Factor to normalize a sample to -1..1.
+  ///\param   [in] level:   The level to update (the finest one).
+  ///\param   [in] reader:  The reader to use.
+  ///\remarks The samples are read in the given native format of the item.
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  void scanPeaks(AudioSnippet* snippet, qint64 offset, qint64 count, float scale, MipmapLevel& level, AudioSnippet::Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::mergePeakChunk()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Copy the peaks of a chunk into the document's peaks.
+  ///\param   [in] start: First frame of the chunk.
+  ///\param   [in] end:   Frame after the chunk.
+  ///\param   [in] parts: The levels of the chunk.
+  ///\remarks Values that lie completely inside of the chunk belong to this
+  ///         worker only and are copied as they are. Values that cross the
+  ///         chunk's edges are shared with the neighbours: the first worker
+  ///         that gets there sets them, the others merge into them (the RMS
+  ///         weighted by the number of frames that each one has seen). The
+  ///         chunk is reported by the next progress notification.
+  //////////////////////////////////////////////////////////////////////////////
+  void mergePeakChunk(qint64 start, qint64 end, const MipmapLevel* parts);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::composePeaks()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Fill the finest peak level from the peaks of the sources.
+  ///\param   [in]  start:  First frame of the range to fill (on a value).
+  ///\param   [in]  end:    Frame after the range (on a value or the end).
+  ///\param   [out] ranges: The ranges that must be scanned, sorted.
+  ///\remarks Peak values that lie inside of a piece are taken from the peaks of
+  ///         its source. If the piece doesn't start on a peak value of its
+  ///         source, each value merges the two source values that it touches
+  ///         (so it may show up to one value more of the same piece, which is
+  ///         less than a pixel in any view that uses this level). Values that
+  ///         contain piece edges would show samples that are not part of the
+  ///         document anymore, they are returned for an exact scan. The
+  ///         coarser levels are reduced piece by piece, so all levels show
+  ///         the composed peaks as soon as they are there.
+  //////////////////////////////////////////////////////////////////////////////
+  void composePeaks(qint64 start, qint64 end, QVector<QPair<qint64, qint64> >& ranges);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::reducePeakRange()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Build the coarser peak levels of a range from the finest one.
+  ///\param   [in] start: First frame of the range.
+  ///\param   [in] end:   Frame after the range.
+  //////////////////////////////////////////////////////////////////////////////
+  void reducePeakRange(qint64 start, qint64 end);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::addPeakRange()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Add a range to the ranges that must be scanned.
+  ///\param   [in,out] ranges: The ranges so far, sorted.
+  ///\param   [in]     start:  First frame of the range.
+  ///\param   [in]     end:    Frame after the range.
+  ///\remarks Ranges must be added in order, neighbours are merged.
+  //////////////////////////////////////////////////////////////////////////////
+  static void addPeakRange(QVector<QPair<qint64, qint64> >& ranges, qint64 start, qint64 end);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::sourcePeaks()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Get the finest peak level of the source of a piece.
+  ///\param   [in] piece: The play list item.
+  ///\return  The peaks of the whole source or 0 if the piece should be scanned
+  ///         directly.
+  ///\remarks Sources are scanned the first time that they are needed, unless
+  ///         the piece only uses a small part of it. The peaks stay as long as
+  ///         the source lives (undo keeps it alive). The pieces composed so far
+  ///         are shown before a scan, so the views don't wait for all of it.
+  //////////////////////////////////////////////////////////////////////////////
+  const MipmapLevel* sourcePeaks(SubSnippet* piece);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::keepSourcePeaks()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Remember the peaks of an unedited file for later edits.
+  ///\remarks If the document is a single complete file, its finest peak level
+  ///         is the peak level of the file, so the file never needs to be
+  ///         scanned again when pieces of it are moved around.
+  //////////////////////////////////////////////////////////////////////////////
+  void keepSourcePeaks();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::splitPlayList()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Make sure that a play list item starts at a position.
+  ///\param   [in] position: The frame where an item should start.
+  ///\return  The index of the item that starts at the position.
+  ///\remarks The piece that contains the position is split into two. If the
+  ///         position is the end of the document the item count is returned.
+  ///         The caller must hold the write lock of the play list.
+  //////////////////////////////////////////////////////////////////////////////
+  int splitPlayList(qint64 position);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::findSnippet()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Find the play list item that contains a position.
+  ///\param   [in] position: The frame to look for.
+  ///\return  The index of the item or -1 if the position is out of range.
+  ///\remarks Binary search over the item start positions, O(log n).
+  //////////////////////////////////////////////////////////////////////////////
+  int findSnippet(qint64 position) const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::updateSnippetStarts()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Rebuild the start positions of the play list items.
+  ///\remarks Must be called after every play list change. The caller must hold
+  ///         the write lock of the play list.
+  //////////////////////////////////////////////////////////////////////////////
+  void updateSnippetStarts();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::clearPlayList()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Delete all pieces of the play list.
+  ///\remarks The caller must hold the write lock of the play list. Sources
+  ///         that no other piece refers to are closed.
+  //////////////////////////////////////////////////////////////////////////////
+  void clearPlayList();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::installSource()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Make a freshly opened file the contents of this document.
+  ///\param   [in] source:     The source of the file, the document owns it.
+  ///\param   [in] fileName:   Name of the file.
+  ///\param   [in] sampleRate: Samples per second of the file.
+  ///\param   [in] format:     Id of the file format.
+  ///\remarks Starts the peak update, read ahead and rack.
+  //////////////////////////////////////////////////////////////////////////////
+  void installSource(AudioSnippet* source, const QString& fileName, double sampleRate, int format);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::readPieces()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read a range of frames across play list items.
+  ///\param   [in]  offset: Starting frame to read.
+  ///\param   [out] buffer: The buffer to fill.
+  ///\param   [in]  count:  The number of frames to read.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The actual number of frames read.
+  ///\remarks The caller must hold the read lock of the play list. Stops early
+  ///         at the end of the document or if a piece delivers less frames.
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  qint64 readPieces(qint64 offset, SampleBufferT<T>& buffer, qint64 count, AudioSnippet::Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::readPiece()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read frames of a single play list item.
+  ///\param   [in]  piece:  The item to read from.
+  ///\param   [in]  offset: Starting frame in the item.
+  ///\param   [in]  count:  The number of frames to read.
+  ///\param   [out] buffer: The buffer to fill.
+  ///\param   [in]  target: First frame of the buffer to write to.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The actual number of frames read.
+  ///\remarks Snippets always write to the start of a buffer, so everything but
+  ///         the first piece of a read goes through a temp buffer. Each
+  ///         reader keeps its temp buffer, so reads don't allocate once it
+  ///         is large enough (shared reads use a temp buffer of their own,
+  ///         they may come from several threads at once).
+  //////////////////////////////////////////////////////////////////////////////
+  template <typename T>
+  qint64 readPiece(SubSnippet* piece, qint64 offset, qint64 count, SampleBufferT<T>& buffer, qint64 target, AudioSnippet::Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::readPiece()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Read frames of a single play list item, float version.
+  ///\param   [in]  piece:  The item to read from.
+  ///\param   [in]  offset: Starting frame in the item.
+  ///\param   [in]  count:  The number of frames to read.
+  ///\param   [out] buffer: The buffer to fill.
+  ///\param   [in]  target: First frame of the buffer to write to.
+  ///\param   [in]  reader: The consumer that reads.
+  ///\return  The actual number of frames read.
+  ///\remarks Display and shared reads go through the shared cache. It caches by
+  ///         source, so the blocks survive edits.
+  //////////////////////////////////////////////////////////////////////////////
+  qint64 readPiece(SubSnippet* piece, qint64 offset, qint64 count, FloatSampleBuffer& buffer, qint64 target, AudioSnippet::Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::scratchBuffer()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the temp buffer of a reader.
+  ///\param   [in] buffer: The buffer that is filled (selects the type).
+  ///\param   [in] reader: The consumer that reads.
+  ///\return  The temp buffer of the reader.
+  //////////////////////////////////////////////////////////////////////////////
+  SampleBuffer& scratchBuffer(const SampleBuffer& buffer, AudioSnippet::Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::scratchBuffer()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the temp buffer of a reader, float version.
+  ///\param   [in] buffer: The buffer that is filled (selects the type).
+  ///\param   [in] reader: The consumer that reads.
+  ///\return  The float temp buffer of the reader.
+  //////////////////////////////////////////////////////////////////////////////
+  FloatSampleBuffer& scratchBuffer(const FloatSampleBuffer& buffer, AudioSnippet::Reader reader);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::beginEdit()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Prepare the document for a play list change.
+  ///\remarks Stops the peak thread because it walks the play list unlocked
+  ///         and keeps the peaks of the current file for the update.
+  //////////////////////////////////////////////////////////////////////////////
+  void beginEdit();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::endEdit()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Update everything that depends on the play list after a change.
+  ///\remarks Drops the samples that were read ahead for playback and rebuilds
+  ///         the peaks.
+  //////////////////////////////////////////////////////////////////////////////
+  void endEdit();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::startPeakThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Rebuild the peaks in the background.
+  ///\remarks A running update is stopped first. The update is flagged before
+  ///         the thread runs, so a stop request can never get lost.
+  //////////////////////////////////////////////////////////////////////////////
+  void startPeakThread();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::stopPeakThread()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Stop the peak update and wait for the thread.
+  ///\remarks Always waits, the thread may still be on its way in or out of
+  ///         updatePeakData().
+  //////////////////////////////////////////////////////////////////////////////
+  void stopPeakThread();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Document::pageOutSources()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Keep the in-memory sources of the play list below the threshold.
+  ///\remarks The largest sources are paged out to the swap file first.
+  //////////////////////////////////////////////////////////////////////////////
+  void pageOutSources();
+
   //////////////////////////////////////////////////////////////////////////////
   // Member:
   bool                 m_dirty;         ///> Was this document modified?
@@ -756,16 +1482,44 @@ private:
   QUndoStack*          m_undoStack;     ///> Undo stack for this document.
   DocumentManager*     m_manager;       ///> Parent document manager.
   QString              m_fileName;      ///> File name of this document.
-  void*                m_fileHandle;    ///> The handle for the file.
   QString              m_lastError;     ///> The last error as string.
   PeakData             m_peakData;      ///> Current peak data.
+  QReadWriteLock       m_peakDataLock;  ///> Guards the swap of the peak data.
   double               m_sampleRate;    ///> Samples per second of a channel.
   int                  m_numChannels;   ///> Number of channels of this document.
   qint64               m_sampleCount;   ///> Total number of samples of a channel.
   int                  m_format;        ///> Id of the file format.
-  QList<AudioSnippet*> m_playList;      ///> The sample buffer playback list.
+  QList<SubSnippet*>   m_playList;      ///> The sample buffer playback list.
+  QVector<qint64>      m_snippetStarts; ///> Start frame of every play list item.
+  QReadWriteLock       m_playListLock;  ///> Guards the play list against edits.
   bool                 m_updatingPeaks; ///> Currently updating the peaks?
   PeakThread           m_peakThread;    ///> The peak update thread.
+  PlaybackStream       m_playbackStream; ///> Reads ahead for playback.
+  SaveThread           m_saveThread;    ///> The background save.
+  BounceThread         m_bounceThread;  ///> The offline rack render.
+  OpenThread*          m_openThread;    ///> The running background open.
+  bool                 m_opening;       ///> Waiting for the background open?
+  int                  m_editCount;     ///> Number of play list changes.
+  int                  m_saveEditCount; ///> Edit count of the running save.
+  qint64               m_undoBudget;    ///> Max. bytes of undo payload in RAM.
+  QSharedPointer<SwapStore> m_swapStore; ///> Swap file for in-memory sources.
+  qint64               m_ramThreshold;  ///> Max. bytes of sources in RAM.
+  qint64               m_peakCacheSize; ///> Max. bytes of the peak cache.
+  int                  m_peakWorkers;   ///> Number of peak building threads.
+  int                  m_peakBaseFactor; ///> Samples per value of the finest peaks.
+  int                  m_peakLevelRatio; ///> Factor between two peak levels.
+  QVector<QPair<qint64, qint64> > m_peakChunks; ///> Frame ranges of the peak build.
+  int                  m_peakChunkLevels; ///> Levels built by the chunks.
+  bool                 m_peaksComplete; ///> Are the peaks up to date?
+  QHash<int, SourcePeaks> m_sourcePeaks; ///> Finest peaks of the sources by id.
+  QVector<PeakPiece>   m_peakPieces;    ///> The play list the peaks show.
+  QAtomicInt           m_nextPeakChunk; ///> Next chunk that a worker takes.
+  QMutex               m_peakEdgeMutex; ///> Guards the shared peak values.
+  QVector<QHash<qint64, qint64> > m_peakEdges; ///> Frames merged into shared peaks.
+  qint64               m_peakDirtyStart; ///> First frame of the peaks to report.
+  qint64               m_peakDirtyEnd;  ///> Frame after the peaks to report.
+  SampleBuffer         m_scratch[AudioSnippet::ReaderCount];      ///> Temp buffers of readPiece().
+  FloatSampleBuffer    m_floatScratch[AudioSnippet::ReaderCount]; ///> Float temp buffers of readPiece().
   int                  m_fps;           ///> Frames per second.
   bool                 m_dropFrame;     ///> Do we have a drop frame time format?
   int                  m_timeSigNum;    ///> Time signature numerator (x/4).
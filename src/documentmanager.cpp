@@ -40,6 +40,9 @@ DocumentManager::DocumentManager(QObject* parent) :
   QSettings settings;
   if (settings.contains("document/recentFiles"))
     m_recentFiles = settings.value("document/recentFiles").toStringList();
+
+  // Set size of the sample cache (in MB):
+  m_blockCache.setBudget(settings.value("cache/blockCacheSize", 64).toLongLong() * 1024 * 1024);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -284,7 +287,8 @@ void DocumentManager::setActiveDocument(int index)
 ///\brief   Check if the clipboard content is an audio file.
 ///\param   [in] needDocument: Check for active document?
 ///\return  true if the contents of the clipboard can be pasted.
-///\remarks Usually only uncompressed PCM wave data can be pasted.
+///\remarks Usually only uncompressed PCM wave data can be pasted. Ranges
+///         copied inside this application can always be pasted.
 ////////////////////////////////////////////////////////////////////////////////
 bool DocumentManager::canPaste(bool needDocument) const
 {
@@ -293,6 +297,10 @@ bool DocumentManager::canPaste(bool needDocument) const
   if (doc == 0 && needDocument)
     return false;
 
+  // Our own ranges don't need any conversion:
+  if (m_clipboard.isCurrent())
+    return true;
+
   // Get clipboard contents:
   const QClipboard* clipboard = QApplication::clipboard();
   const QMimeData* mimeData = clipboard->mimeData();
@@ -367,6 +375,54 @@ void DocumentManager::clearRecentFiles()
   emitRecentFilesChanged();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// DocumentManager::blockCache()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the decoded sample cache.
+///\return  The block cache shared by all documents.
+////////////////////////////////////////////////////////////////////////////////
+BlockCache& DocumentManager::blockCache()
+{
+  // Return the cache:
+  return m_blockCache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DocumentManager::blockCache()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the decoded sample cache, const version.
+///\return  The block cache shared by all documents.
+////////////////////////////////////////////////////////////////////////////////
+const BlockCache& DocumentManager::blockCache() const
+{
+  // Return the cache:
+  return m_blockCache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DocumentManager::clipboard()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the audio clipboard.
+///\return  The clipboard shared by all documents.
+////////////////////////////////////////////////////////////////////////////////
+AudioClipboard& DocumentManager::clipboard()
+{
+  // Return the clipboard:
+  return m_clipboard;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DocumentManager::clipboard()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Access the audio clipboard, const version.
+///\return  The clipboard shared by all documents.
+////////////////////////////////////////////////////////////////////////////////
+const AudioClipboard& DocumentManager::clipboard() const
+{
+  // Return the clipboard:
+  return m_clipboard;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // DocumentManager::emitDocumentCreated()
 ////////////////////////////////////////////////////////////////////////////////
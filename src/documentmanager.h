@@ -28,6 +28,8 @@
 #define __DOCUMENTMANAGER_H_INCLUDED__
 
 #include "document.h"
+#include "audio/blockcache.h"
+#include "audioclipboard.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 ///\class DocumentManager documentmanager.h
@@ -148,7 +150,8 @@ public:
   ///\brief   Check if the clipboard content is an audio file.
   ///\param   [in] needDocument: Check for active document?
   ///\return  true if the contents of the clipboard can be pasted.
-  ///\remarks Usually only uncompressed PCM wave data can be pasted.
+  ///\remarks Usually only uncompressed PCM wave data can be pasted. Ranges
+  ///         copied inside this application can always be pasted.
   //////////////////////////////////////////////////////////////////////////////
   bool canPaste(bool needDocument) const;
 
@@ -185,6 +188,38 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   void clearRecentFiles();
 
+  //////////////////////////////////////////////////////////////////////////////
+  // DocumentManager::blockCache()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the decoded sample cache.
+  ///\return  The block cache shared by all documents.
+  //////////////////////////////////////////////////////////////////////////////
+  BlockCache& blockCache();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // DocumentManager::blockCache()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the decoded sample cache, const version.
+  ///\return  The block cache shared by all documents.
+  //////////////////////////////////////////////////////////////////////////////
+  const BlockCache& blockCache() const;
+
+  //////////////////////////////////////////////////////////////////////////////
+  // DocumentManager::clipboard()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the audio clipboard.
+  ///\return  The clipboard shared by all documents.
+  //////////////////////////////////////////////////////////////////////////////
+  AudioClipboard& clipboard();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // DocumentManager::clipboard()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Access the audio clipboard, const version.
+  ///\return  The clipboard shared by all documents.
+  //////////////////////////////////////////////////////////////////////////////
+  const AudioClipboard& clipboard() const;
+
   //////////////////////////////////////////////////////////////////////////////
   // DocumentManager::emitDocumentCreated()
   //////////////////////////////////////////////////////////////////////////////
@@ -238,6 +273,8 @@ private:
   // Member:
   QList<Document*> m_documents;   ///> The list of documents.
   QStringList      m_recentFiles; ///> The recently used files.
+  BlockCache       m_blockCache;  ///> Decoded samples of all documents.
+  AudioClipboard   m_clipboard;   ///> Copied ranges of all documents.
 };
 
 #endif // #ifndef __DOCUMENTMANAGER_H_INCLUDED__
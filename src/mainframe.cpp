@@ -212,6 +212,8 @@ WaveMDIWindow* MainFrame::findMDIWindow(Document* doc)
 ////////////////////////////////////////////////////////////////////////////////
 ///\brief   Create a new document and load a file into it.
 ///\param   [in] fileName: The file to load.
+///\remarks The file is opened in the background, its window is shown right
+///         away and filled when the header was read.
 ////////////////////////////////////////////////////////////////////////////////
 void MainFrame::loadFile(QString fileName)
 {
@@ -232,40 +234,88 @@ void MainFrame::loadFile(QString fileName)
   // Create new document:
   Document* doc = m_docManager->newDocument();
 
-  // Load the file:
-  if (doc->loadFile(fileName))
+  // Start loading the file:
+  if (!doc->open(fileName))
   {
-    // Create a new mdi view for this document:
-    WaveMDIWindow* subWindow = new WaveMDIWindow(doc);
-    m_mdiArea->addSubWindow(subWindow);
+    // Show the failure reason:
+    QMessageBox::critical(this, tr("File open error"), doc->lastError());
 
-    // Show it (this three calls are needed):
-    subWindow->show();
-    subWindow->activateWindow();
-    subWindow->raise();
+    // Cleanup document:
+    doc->close();
+    doc->emitClosed();
+    return;
+  }
 
-    // Set active:
-    m_docManager->setActiveDocument(doc);
+  // Show a placeholder view right away, the samples follow when the header
+  // was read:
+  connect(doc, SIGNAL(openFinished(bool)), this, SLOT(documentOpenFinished(bool)));
+  showDocument(doc);
+  statusBar()->showMessage(tr("Opening %1...").arg(fileName));
+}
 
-    // Force an activation event on the first document:
-    if (m_docManager->documents().length() == 1)
-      m_docManager->emitActiveDocumentChanged();
+////////////////////////////////////////////////////////////////////////////////
+// MainFrame::showDocument()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Create a view for a new document and activate it.
+///\param   [in] doc: The document to show.
+////////////////////////////////////////////////////////////////////////////////
+void MainFrame::showDocument(Document* doc)
+{
+  // Create a new mdi view for this document:
+  WaveMDIWindow* subWindow = new WaveMDIWindow(doc);
+  m_mdiArea->addSubWindow(subWindow);
 
-    // Move file to the top of the recent file list:
-    m_docManager->addRecentFile(fileName);
+  // Show it (this three calls are needed):
+  subWindow->show();
+  subWindow->activateWindow();
+  subWindow->raise();
 
-    // Activate rack:
-    doc->rack().resume();
-  }
-  else
+  // Set active:
+  m_docManager->setActiveDocument(doc);
+
+  // Force an activation event on the first document:
+  if (m_docManager->documents().length() == 1)
+    m_docManager->emitActiveDocumentChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MainFrame::documentOpenFinished()
+////////////////////////////////////////////////////////////////////////////////
+///\brief   Handler for the end of a background open.
+///\param   [in] success: Was the file loaded?
+///\remarks Shows the loaded samples in the placeholder view or removes it.
+////////////////////////////////////////////////////////////////////////////////
+void MainFrame::documentOpenFinished(bool success)
+{
+  // Get document:
+  Document* doc = qobject_cast<Document*>(sender());
+  if (doc == 0)
+    return;
+  disconnect(doc, SIGNAL(openFinished(bool)), this, SLOT(documentOpenFinished(bool)));
+  statusBar()->clearMessage();
+
+  // Failed?
+  if (!success)
   {
     // Show the failure reason:
     QMessageBox::critical(this, tr("File open error"), doc->lastError());
 
-    // Cleanup document:
+    // Cleanup document (this closes the placeholder):
     doc->close();
     doc->emitClosed();
+    return;
   }
+
+  // Show the whole file in the placeholder:
+  WaveMDIWindow* view = findMDIWindow(doc);
+  if (view != 0)
+    view->zoomAll();
+
+  // Move file to the top of the recent file list:
+  m_docManager->addRecentFile(doc->fileName());
+
+  // Activate rack:
+  doc->rack().resume();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -874,6 +924,7 @@ void MainFrame::createActions()
   m_actionMap["extendSelectionToAllChannels"] = new ExtendSelectionToAllChannelsAction(this);
   m_actionMap["extendSelectionDoubleLength"] = new ExtendSelectionDoubleLengthAction(this);
   m_actionMap["shrinkSelectionHalfLength"] = new ShrinkSelectionHalfLengthAction(this);
+  m_actionMap["bounce"] = new BounceAction(this);
 
   // Edit->select from start to cursor:
   action = new QAction(QIcon(":/images/edit-select-cursor-start.png"), tr("Select from start to cursor"), this);
@@ -1144,6 +1195,8 @@ void MainFrame::createMainMenu()
 
   // Tools menu:
   QMenu* toolsMenu = menuBar()->addMenu(tr("&Tools"));
+  toolsMenu->addAction(m_actionMap["bounce"]);
+  toolsMenu->addSeparator();
   toolsMenu->addAction(m_actionMap["configureShortcuts"]);
   toolsMenu->addAction(m_actionMap["configureToolbars"]);
 
@@ -91,9 +91,19 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   ///\brief   Create a new document and load a file into it.
   ///\param   [in] fileName: The file to load.
+  ///\remarks The file is opened in the background, its window is shown right
+  ///         away and filled when the header was read.
   //////////////////////////////////////////////////////////////////////////////
   void loadFile(QString fileName);
 
+  //////////////////////////////////////////////////////////////////////////////
+  // MainFrame::showDocument()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Create a view for a new document and activate it.
+  ///\param   [in] doc: The document to show.
+  //////////////////////////////////////////////////////////////////////////////
+  void showDocument(Document* doc);
+
 protected:
   //////////////////////////////////////////////////////////////////////////////
   // MainFrame::showEvent()
@@ -160,6 +170,15 @@ private slots:
   //////////////////////////////////////////////////////////////////////////////
   void documentDirtyChanged();
 
+  //////////////////////////////////////////////////////////////////////////////
+  // MainFrame::documentOpenFinished()
+  //////////////////////////////////////////////////////////////////////////////
+  ///\brief   Handler for the end of a background open.
+  ///\param   [in] success: Was the file loaded?
+  ///\remarks Shows the loaded samples in the placeholder view or removes it.
+  //////////////////////////////////////////////////////////////////////////////
+  void documentOpenFinished(bool success);
+
   //////////////////////////////////////////////////////////////////////////////
   // MainFrame::subWindowActivated()
   //////////////////////////////////////////////////////////////////////////////
@@ -11,7 +11,8 @@ Rack::Rack(Document* doc) :
   m_doc(doc),
   m_suspended(false),
   m_sampleRate(44100),
-  m_blockSize(4096)
+  m_blockSize(4096),
+  m_offline(false)
 {
   // Add input and output:
   m_devices.append(new RackInput(this));
@@ -53,6 +54,7 @@ bool Rack::suspended() const
 
 void Rack::suspend()
 {
+  QMutexLocker locker(&m_processMutex);
   if (m_suspended)
     return;
   m_suspended = true;
@@ -64,6 +66,7 @@ void Rack::suspend()
 
 void Rack::resume()
 {
+  QMutexLocker locker(&m_processMutex);
   if (!m_suspended)
     return;
   m_suspended = false;
@@ -80,6 +83,9 @@ double Rack::sampleRate() const
 
 void Rack::setSampleRate(const double rate)
 {
+  // Documents that are opened in the background are set up while the audio
+  // callback runs:
+  QMutexLocker locker(&m_processMutex);
   if (m_sampleRate == rate)
     return;
 
@@ -97,6 +103,7 @@ int Rack::blockSize() const
 
 void Rack::setBlockSize(const int size)
 {
+  QMutexLocker locker(&m_processMutex);
   if (m_blockSize == size)
     return;
 
@@ -112,11 +119,45 @@ void Rack::process(const SampleBuffer& inputs, SampleBuffer& outputs, int frameC
   // Start with empty buffer:
   outputs.makeSilence();
 
-  // Disabled?
-  if (m_suspended)
+  // Never wait in the audio callback, stay silent while the rack is busy:
+  if (!m_processMutex.tryLock())
     return;
 
-  // Process all devices:
+  // Disabled or busy with an offline render?
+  if (!m_suspended && !m_offline)
+  {
+    // Process all devices:
+    for (int i = 0; i < m_devices.count(); i++)
+      m_devices[i]->process(inputs, outputs, frameCount, streamTime);
+  }
+  m_processMutex.unlock();
+}
+
+bool Rack::offline() const
+{
+  return m_offline;
+}
+
+void Rack::beginOffline()
+{
+  // Wait for the audio callback to leave process(), from now on it's silent:
+  QMutexLocker locker(&m_processMutex);
+  m_offline = true;
+}
+
+void Rack::endOffline()
+{
+  QMutexLocker locker(&m_processMutex);
+  m_offline = false;
+}
+
+void Rack::processOffline(const SampleBuffer& inputs, SampleBuffer& outputs, int frameCount, double streamTime)
+{
+  // Start with empty buffer:
+  outputs.makeSilence();
+
+  // Process all devices, the input device passes the inputs on:
+  QMutexLocker locker(&m_processMutex);
   for (int i = 0; i < m_devices.count(); i++)
     m_devices[i]->process(inputs, outputs, frameCount, streamTime);
 }
@@ -22,12 +22,20 @@ public:
 
   void process(const SampleBuffer& inputs, SampleBuffer& outputs, int frameCount, double streamTime);
 
+  // Offline rendering (the realtime process() stays silent meanwhile):
+  bool offline() const;
+  void beginOffline();
+  void endOffline();
+  void processOffline(const SampleBuffer& inputs, SampleBuffer& outputs, int frameCount, double streamTime);
+
 private:
   class Document* m_doc;
   QList<class RackDevice*> m_devices;
   bool m_suspended;
   double m_sampleRate;
   int m_blockSize;
+  QMutex m_processMutex;
+  bool m_offline;
 };
 
 #endif // RACK_H
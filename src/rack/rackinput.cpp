@@ -14,22 +14,27 @@ RackInput::~RackInput()
 {
 }
 
-void RackInput::process(const SampleBuffer& /*inputs*/, SampleBuffer& outputs, int frameCount, double /*streamTime*/)
+void RackInput::process(const SampleBuffer& inputs, SampleBuffer& outputs, int frameCount, double /*streamTime*/)
 {
+  // Offline renders feed the document samples as inputs:
+  if (rack()->offline())
+  {
+    for (int i = 0; i < outputs.channelCount(); i++)
+      memcpy(outputs.sampleBuffer(i), inputs.sampleBuffer(qMin(i, inputs.channelCount() - 1)), frameCount * sizeof(double));
+    return;
+  }
+
   Document* doc = rack()->document();
   if (!doc || !doc->playing())
     return;
 
-  doc->readSamples(doc->cursorPosition(), outputs, frameCount);
+  // Only copy from the stream here, it does the disk access:
+  qint64 position = doc->cursorPosition();
+  doc->playbackStream().read(position, outputs, frameCount);
 
-  doc->setCursorPosition(doc->cursorPosition() + frameCount);
-  if (doc->cursorPosition() >= doc->sampleCount())
-  {
-    if (doc->looping())
-      doc->setCursorPosition(0);
-    else
-      rack()->document()->setPlaying(false);
-  }
+  doc->setCursorPosition(position);
+  if (!doc->looping() && doc->cursorPosition() >= doc->sampleCount())
+    rack()->document()->setPlaying(false);
 
   if (rack()->document()->channelCount() < outputs.channelCount())
   {